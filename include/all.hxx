@@ -31,7 +31,29 @@ using namespace std;
 #define FALSE 0
 #define ONE 1
 
-extern string verbosity;
+/* verbosity levels, set with the verbosity option ('none', 'low' or 'high') in the config file */
+enum lgar_verbosity {VERBOSITY_NONE = 0, VERBOSITY_LOW = 1, VERBOSITY_HIGH = 2};
+
+/* verbosity of the model instance whose BMI call is running on this thread. Each instance keeps its own verbosity
+   (model_state::verbosity) and installs it with a verbosity_scope at the start of its BMI calls, so instances with
+   different verbosities can run on different threads. */
+extern thread_local int verbosity;
+
+struct verbosity_scope
+{
+  int previous;
+  explicit verbosity_scope(int level) : previous(verbosity) { verbosity = level; }
+  ~verbosity_scope() { verbosity = previous; }
+};
+
+/* checks guarding the screen output: LGAR_LOG_LOW for summaries and warnings (verbosity 'low' or 'high'), LGAR_LOG_HIGH
+   for the debug output (verbosity 'high'). Building with LGAR_NO_DEBUG_LOG compiles the debug output out. */
+#define LGAR_LOG_LOW (__builtin_expect(verbosity >= VERBOSITY_LOW, 0))
+#ifdef LGAR_NO_DEBUG_LOG
+#define LGAR_LOG_HIGH (false)
+#else
+#define LGAR_LOG_HIGH (__builtin_expect(verbosity >= VERBOSITY_HIGH, 0))
+#endif
 
 #define use_bmi_flag FALSE       // TODO set to TRUE to run in BMI environment
 
@@ -55,6 +77,115 @@ struct wetting_front
   struct wetting_front *next;  // pointer to the next wetting front.
 };
 
+// Define a fixed-capacity, structure-of-arrays store for the wetting fronts. The arrays are indexed by
+// front number (1..num_fronts); entry 0 is unused, the same convention as the layer arrays. The store holds copies
+// of the linked list (snapshots, rollback, checkpoints); the model itself works on the list.
+struct wetting_front_store
+{
+  int    num_fronts;                                  // number of wetting fronts in the store
+  double depth_cm[MAX_NUM_WETTING_FRONTS+1];          // depth down from the land surface (absolute depth)
+  double theta[MAX_NUM_WETTING_FRONTS+1];             // water content of the soil moisture block
+  double psi_cm[MAX_NUM_WETTING_FRONTS+1];            // psi calculated at rhs of the wetting front
+  double K_cm_per_h[MAX_NUM_WETTING_FRONTS+1];        // the value of K(theta) associated with the wetting front
+  int    layer_num[MAX_NUM_WETTING_FRONTS+1];         // the layer containing the wetting front
+  bool   to_bottom[MAX_NUM_WETTING_FRONTS+1];         // TRUE iff the wetting front is in contact with the layer bottom
+  double dzdt_cm_per_h[MAX_NUM_WETTING_FRONTS+1];     // the calculated wetting front speed
+};
+
+// Define a double-buffered snapshot of the wetting fronts. A new snapshot is written into the buffer that does not
+// hold the latest snapshot and the buffers are then swapped, so taking a snapshot never allocates memory.
+struct wetting_front_snapshot
+{
+  struct wetting_front_store buffer[2];
+  int    latest = -1;                                 // buffer holding the latest snapshot, -1 if none has been taken
+};
+
+// Define a per-instance pool of wetting front nodes. The nodes of the linked list of a model instance are taken from
+// this preallocated block, so inserting and deleting fronts during a run does not call malloc/free.
+struct wetting_front_pool
+{
+  struct wetting_front  nodes[MAX_NUM_WETTING_FRONTS];
+  struct wetting_front *free_list = NULL;             // nodes that were returned to the pool
+  int    num_carved = 0;                              // nodes of the block that have been handed out at least once
+  int    num_in_use = 0;                              // nodes currently in a list
+  int    high_water_mark = 0;                         // largest num_in_use seen
+};
+
+// Define the quadrature rules for the numeric Geff integral (use_closed_form_G = false), selected by Geff_quadrature in
+// the config file, and counters of the work done by them.
+enum Geff_quadrature_rule
+{
+  GEFF_QUADRATURE_TRAPEZOID = 0,      // adaptive trapezoid rule in h (the original scheme)
+  GEFF_QUADRATURE_GAUSS_LEGENDRE,     // composite Gauss-Legendre in ln(h)
+  GEFF_QUADRATURE_TANH_SINH           // tanh-sinh (double exponential) in ln(h)
+};
+
+struct Geff_quadrature
+{
+  int    rule = GEFF_QUADRATURE_TRAPEZOID;
+  long   num_integrals = 0;           // number of numeric Geff integrals computed
+  long   num_evals = 0;               // number of evaluations of K(h) by these integrals
+};
+
+// Default flux caching policy, these are not relevant if flux caching is disabled in the config file. The defaults can be
+// changed at compile time, and the values at run time in the config file or through the BMI (see struct flux_caching_policy).
+// precip intensity above which flux caching does not occur
+#ifndef PRECIP_THRESHOLD_MM_PER_H
+#define PRECIP_THRESHOLD_MM_PER_H ((double)1.0e-6)
+#endif
+
+// Threshold for AET/PET ratio to indicate low enough AET for flux caching to start
+#ifndef AET_PET_RATIO_THRESHOLD
+#define AET_PET_RATIO_THRESHOLD ((double)0.75)
+#endif
+
+// while ponded head is greater than this, flux caching will not occur
+#ifndef VOLON_TIMESTEP_THRESHOLD_CM
+#define VOLON_TIMESTEP_THRESHOLD_CM ((double)1.0e-16)
+#endif
+
+// While the vadose zone lower boundary flux is greater than this, flux caching will not happen
+#ifndef BOTTOM_BDY_FLUX_THRESHOLD_CM
+#define BOTTOM_BDY_FLUX_THRESHOLD_CM ((double)1.0e-4)
+#endif
+
+// While the top most wetting front has a dzdt value greater than this, flux caching will not happen
+#ifndef THRESHOLD_DZDT_CM_PER_H
+#define THRESHOLD_DZDT_CM_PER_H ((double)1.0e0)
+#endif
+
+// Number of timesteps before flux cache reset
+#ifndef NUM_TIMESTEPS_BEFORE_RESET_CACHE
+#define NUM_TIMESTEPS_BEFORE_RESET_CACHE 24
+#endif
+
+// Define the flux caching policy (allow_flux_caching): the thresholds that decide whether a forcing step is dry enough for
+// its fluxes to be cached, the number of steps after which the cache is refreshed (horizon), optionally adapted from the
+// drift of the soil storage and of the top wetting front speed over each cache window, and counters of the cached and
+// computed steps.
+struct flux_caching_policy
+{
+  double precip_threshold_mm_per_h = PRECIP_THRESHOLD_MM_PER_H;       // precip intensity above which flux caching does not occur
+  double AET_PET_ratio_threshold   = AET_PET_RATIO_THRESHOLD;         // AET/PET ratio below which flux caching can start
+  double ponded_depth_threshold_cm = VOLON_TIMESTEP_THRESHOLD_CM;     // while ponded head is greater than this, flux caching will not occur
+  double bottom_flux_threshold_cm  = BOTTOM_BDY_FLUX_THRESHOLD_CM;    // while the lower boundary flux is greater than this, flux caching will not occur
+  double dzdt_threshold_cm_per_h   = THRESHOLD_DZDT_CM_PER_H;         // while the free drainage wetting front is faster than this, flux caching will not occur
+  int    horizon                   = NUM_TIMESTEPS_BEFORE_RESET_CACHE; // number of timesteps before the flux cache is refreshed
+
+  bool   adaptive_horizon          = false;  // if true, the horizon is halved or doubled after each cache window from the drifts below
+  int    min_horizon               = 2;      // bounds of the adaptive horizon
+  int    max_horizon               = 168;
+  double storage_drift_tol_cm      = 0.5;    // tolerated change of the soil storage over a cache window
+  double dzdt_drift_tol            = 0.5;    // tolerated relative change of the top wetting front speed over a cache window
+
+  int    window_steps              = 0;      // steps of the current cache window, 0 outside a window
+  double window_storage_cm         = 0.0;    // soil storage and top wetting front speed at the start of the current cache window
+  double window_dzdt_cm_per_h      = 0.0;
+
+  long   num_cached_steps          = 0;      // number of timesteps that used cached fluxes (or, fast-forwarding, cached wetting front speeds)
+  long   num_computed_steps        = 0;      // number of timesteps whose fluxes were computed
+};
+
 /* head is a GLOBALLY defined pointer to the first link in the wetting front list.
    Making it a local variable in main() makes all linked list operations
    in subroutines a pain of referencing.  Since it is just one thing,
@@ -62,6 +193,20 @@ struct wetting_front
 */
 
 
+// Define a lookup table of a van Genuchten relation y(x). x is a piecewise linear log2 coordinate (exact at powers of 2,
+// which are nodes); between the nodes a cubic Hermite polynomial is used. Outside [x_lo, x_hi] (or if
+// num_intervals == 0) the closed form is used (see soil_funcs.cxx).
+struct vG_table
+{
+  int    num_intervals = 0;           // 0 if the table has not been built
+  double x_lo = 0.0;                  // lower end of the tabulated range
+  double x_hi = 0.0;                  // upper end of the tabulated range
+  double dx_inv = 0.0;                // inverse of the node spacing
+  vector<double> y;                   // y at the nodes
+  vector<double> dydx_lo;             // dy/dx at the lower node of each interval times the node spacing
+  vector<double> dydx_hi;             // dy/dx at the upper node of each interval times the node spacing
+};
+
 // Define a data structure to hold properties and parameters for each soil type
 struct soil_properties_  /* note the trailing underscore on the name.  It is just part of the name */
 {
@@ -76,6 +221,15 @@ struct soil_properties_  /* note the trailing underscore on the name.  It is jus
   double h_min_cm;         // the minimum Geff calculated as per Morel-Seytoux and Khanji
   double Ksat_cm_per_h;    // saturated hydraulic conductivity cm/s
   double theta_wp;         // water content at wilting point [-]
+  double vg_m_inv;         // 1/vg_m, derived (see lgar_calc_soil_constants)
+  double vg_n_inv;         // 1/vg_n, derived
+  double vg_alpha_inv_cm;  // 1/vg_alpha_per_cm, derived
+  double bc_Geff_exponent; // exponent 3+1/bc_lambda of the Brooks & Corey closed form Geff, derived
+  double bc_H_c_cm;        // Green-Ampt capillary drive of the Brooks & Corey closed form Geff, derived
+  struct vG_table Se_from_h_table;     // Se(h) lookup table, only built if use_vG_tables is true
+  struct vG_table K_from_Se_table[2];  // K(Se)/Ksat lookup tables for Se <= 0.5 and Se > 0.5
+  struct vG_table h_from_Se_table[2];  // h(Se) lookup tables for Se <= 0.5 and Se > 0.5
+  struct vG_table Geff_F_table;        // cumulative integral F(h) of K/Ksat from 0 to h, only built if use_Geff_table is true
 };
 
 
@@ -121,9 +275,10 @@ struct lgar_bmi_parameters
 
   //double *soil_moisture_layers;    // 1D array of thetas (mean soil moisture content) per layer; output option to other models if needed
   double *soil_moisture_wetting_fronts; /* 1D array of thetas (soil moisture content) per wetting front;
-					   output to other models (e.g. soil freeze-thaw) */
+					   output to other models (e.g. soil freeze-thaw); capacity MAX_NUM_WETTING_FRONTS,
+					   the first num_wetting_fronts entries are valid */
   double *soil_depth_wetting_fronts;    /* 1D array of absolute depths of the wetting fronts [meters];
-					    output to other models (e.g. soil freeze-thaw) */
+					    output to other models (e.g. soil freeze-thaw); same capacity as above */
   double *soil_temperature;              // 1D array of soil temperature [K]; bmi input for coupling lasam to soil freeze thaw model
   double *soil_temperature_z;            /* 1D array of soil discretization associated with temperature profile [m];
 					    depth from the surface in meters */
@@ -132,8 +287,15 @@ struct lgar_bmi_parameters
   double  field_capacity_psi_cm;          // field capacity represented as a capillary head. Note that both wilting point and field capacity are specified for the whole model domain with single values
   bool   use_closed_form_G = false;      /* true if closed form of capillary drive calculation is desired, false if numeric integral
 					    for capillary drive calculation is desired */
+  bool   use_vG_tables = false;          // true if the van Genuchten relations are evaluated from per soil lookup tables rather than closed forms
+  double vG_table_tolerance = 1.E-10;    // interpolation error bound of the lookup tables (absolute for Se, relative for K and h)
+  bool   use_Geff_table = false;         // true if the numeric Geff is read off a precomputed per soil cumulative integral
   bool   PET_affects_precip = false;     // set to true in config file if you want PET to be taken from precip 
   bool   adaptive_timestep = false;      // if set to true, model uses adaptive timestep. In this case, the minimum timestep is the timestep specified in the config file. The maximum time step will be equal to the forcing resolution.
+  bool   adaptive_error_control = false; // if true (adaptive_timestep_method = error_control), the adaptive timestep is chosen from an estimate of the local error of each substep rather than from the precipitation rate
+  double maximum_timestep_h;             // maximum time step in hours, only used by the error-controlled adaptive timestep
+  double adaptive_front_tol_cm = 0.1;    // error-controlled adaptive timestep: tolerance of the local truncation error of the wetting front depths [cm]
+  double adaptive_mbal_tol_cm = 1.E-6;   // error-controlled adaptive timestep: tolerance of the mass balance residual of a substep [cm]
   bool   free_drainage_enabled = false;  // free_drainage_enabled will specify whether the lower boundary condition is no flow (false), or free drainage (true). Defaults to false.
   bool   free_drainage_to_CR   = false;  // This will specify whether free drainage is sent to the nonlinear conceptual reservoir (true) or lost to deep GW (false). Defaults to false.
   double mbal_tol;                       // if a substep's mass balance error is larger than this number, the model will abort. By default it is set to a large value (10 cm).
@@ -165,12 +327,37 @@ struct lgar_bmi_parameters
 
   bool   runoff_in_prev_step = false; // true if there was there runoff in the previous time step. Used for simple preferential flow
   bool   allow_flux_caching = false; //if set to true, allows for the use of cached fluxes rather than computing new ones when internal states are changing slowly. 
+  bool   flux_caching_fast_forward = false; // if true (flux_caching_method = fast_forward), dry forcing steps are taken as one coarse substep with cached wetting front speeds instead of freezing the wetting fronts
   int    cache_count = 1;            //used for caching to accumulate fluxes
 
   bool   log_mode = false; // mode where log-normally distributed parameters are expected to be input as their log_10 values rather than their normal values. This is to ensure the calibration searches the parameter space effectively.
                            // for example, instead if using 0.1 cm/h for a K_s value, we would use -1.0 because 10^-1 = 0.1. In this case, the parameter names are not updated, so be careful with this.
 };
 
+// Define a cache of per-layer quantities derived from the soil parameters, the frozen factor and the field capacity.
+// Rebuilt by lgar_update_derived_constants() whenever these change (initialization, calibration, frozen factor), so that
+// the hot routines read them instead of recomputing them on every subtimestep. Arrays are indexed by layer (1..num_layers).
+struct lgar_derived_constants
+{
+  vector<double> Ksat_cm_per_h;        // frozen_factor * Ksat of the soil of each layer
+  vector<double> h_50_cm;              // capillary head at which AET = 0.5 * PET, for a surface front in each layer
+  double largest_Ksat_cm_per_h = 0.0;  // largest Ksat (without frozen factor) of the soils of the layers
+  double min_storage_cm = 0.0;         // water in the soil if all layers are at theta_r
+  double max_storage_cm = 0.0;         // water in the soil if all layers are at theta_e
+};
+
+// Define the state of the error-controlled adaptive timestep (adaptive_timestep_method = error_control). A substep whose
+// error estimate exceeds the tolerances is rejected: the state at the start of the substep is restored from the
+// rollback buffers and the substep is repeated with a smaller size.
+struct substep_controller
+{
+  double next_timestep_h = 0.0;            // size proposed for the next substep, 0 before the first one
+  double previous_precip_mm_per_h = 0.0;   // precipitation rate of the previous forcing step
+  long   num_accepted = 0;                 // number of accepted substeps
+  long   num_rejected = 0;                 // number of rejected substeps
+  struct wetting_front_store fronts;       // wetting fronts at the start of the substep
+};
+
 // Define a data structure for local (timestep) and global mass balance parameters
 struct lgar_mass_balance_variables
 {
@@ -211,6 +398,7 @@ struct lgar_mass_balance_variables
   double previous_PET = 0.0;  // used to determine if fluxes can be cached rather than computed
   double previous_recharge = 0.0;  // used to determine if fluxes can be cached rather than computed
   bool cache_fluxes = FALSE;
+  bool fast_forward = FALSE;  // true while dry forcing steps are fast-forwarded (flux_caching_method = fast_forward)
   double accumulated_PET = 0.0;
   double accumulated_free_drainage = 0.0;
 
@@ -270,10 +458,17 @@ struct lgar_calib_parameters
 // nested structure of structures; main structure for the use in bmi
 struct model_state
 {
+  int                                 verbosity      = VERBOSITY_NONE; // verbosity of this instance (config file)
   struct wetting_front*               head           = NULL; // head pointer to the current state
-  struct wetting_front*               state_previous = NULL; // head pointer to the previous state,
+  const struct wetting_front_store*   state_previous = NULL; // the previous state (latest snapshot in state_snapshot),
                                                              // used in computing derivatives and mass balance
+  struct wetting_front_snapshot       state_snapshot;        // preallocated buffers holding the previous state
+  struct wetting_front_pool           front_pool;            // nodes of the wetting front list (head)
+  struct Geff_quadrature              Geff_quadrature;       // quadrature rule and work counters of the numeric Geff
   struct soil_properties_*            soil_properties;       // dynamic allocation
+  struct lgar_derived_constants       derived;               // per-layer constants derived from the parameters
+  struct substep_controller           substep_control;       // error-controlled adaptive timestep
+  struct flux_caching_policy          flux_caching;          // flux caching thresholds, horizon and counters
   struct lgar_bmi_parameters          lgar_bmi_params;
   struct lgar_mass_balance_variables  lgar_mass_balance;
   struct unit_conversion              units;
@@ -281,6 +476,29 @@ struct model_state
   struct lgar_calib_parameters        lgar_calib_params;
 };
 
+// Define the forcing data of a forcing file as columns, one entry per forcing timestep (see forcing.cxx)
+struct forcing_data
+{
+  vector<double> time_s;                  // time stamps in seconds since 1970-01-01 00:00:00, in the time zone of the file
+  vector<double> precipitation_mm_per_h;  // precipitation rate [mm/h]
+  vector<double> PET_mm_per_h;            // potential evapotranspiration rate [mm/h]
+};
+
+// Define the forcing columns of a forcing file opened for a run: a binary forcing file is memory-mapped and its columns
+// are used in place, a csv forcing file is parsed into a struct forcing_data (see forcing.cxx)
+struct forcing_series
+{
+  long          num_steps;
+  double        start_time_s;            // time of the first entry, seconds since 1970-01-01 00:00:00
+  double        timestep_s;              // time between the entries of a binary forcing file (first step of a csv file)
+  const double* time_s;                  // time stamps of a csv forcing file, NULL for a binary forcing file
+  const double* precipitation_mm_per_h;  // precipitation rate [mm/h], num_steps entries
+  const double* PET_mm_per_h;            // potential evapotranspiration rate [mm/h], num_steps entries
+  struct forcing_data* parsed;           // storage of the columns of a csv forcing file
+  void*         mapping;                 // mapping of a binary forcing file
+  size_t        mapping_nbytes;
+};
+
 
 /* next, function prototypes. */
 /* function prototypes provide the compiler with variable types and order in the calling statement */
@@ -300,16 +518,31 @@ extern int                      listLength(struct wetting_front* head);
 extern bool                     listIsEmpty();
 extern struct wetting_front*    listDeleteFirst(struct wetting_front** head);
 extern struct wetting_front*    listFindFront(int i, struct wetting_front* head, struct wetting_front* head_old);
-extern struct wetting_front*    listDeleteFront(int front_num, struct wetting_front** head, int *soil_type, struct soil_properties_ *soil_properties);
+extern struct wetting_front*    listDeleteFront(int front_num, struct wetting_front** head, struct wetting_front_pool *pool,
+						int *soil_type, struct soil_properties_ *soil_properties);
 extern void                     listSortFrontsByDepth(struct wetting_front *head);
-extern void                     listInsertFirst(double d, double t, int f, int l, bool b, struct wetting_front** head);
-extern struct wetting_front*    listInsertFront(double d, double t, int f, int l, bool b, struct wetting_front** head);
-extern struct wetting_front*    listInsertFrontAtDepth(int numlay, double *tvec,double d, double t, struct wetting_front* head);
+extern void                     listInsertFirst(double d, double t, int f, int l, bool b, struct wetting_front** head,
+						struct wetting_front_pool *pool);
+extern struct wetting_front*    listInsertFront(double d, double t, int f, int l, bool b, struct wetting_front** head,
+						struct wetting_front_pool *pool);
 extern void                     listReverseOrder(struct wetting_front** head_ref);
 extern bool                     listFindLayer(struct wetting_front* link, int num_layers, double *cum_layer_thickness_cm,
 					      int *lives_in_layer, bool *extends_to_bottom_flag);
-extern struct wetting_front*    listCopy(struct wetting_front* current, struct wetting_front* state_previous=NULL);
-extern void listDelete(struct wetting_front* head);
+extern void listDelete(struct wetting_front* head, struct wetting_front_pool *pool);
+extern int                      listIndex(struct wetting_front* head, struct wetting_front** index);
+extern struct wetting_front*    poolAlloc(struct wetting_front_pool *pool);
+extern void                     poolFree(struct wetting_front_pool *pool, struct wetting_front *node);
+extern void                     poolReset(struct wetting_front_pool *pool);
+
+/*##########################################*/
+/*   Wetting front store function prototypes */
+/*##########################################*/
+extern int                      storeLength(const struct wetting_front_store *store);
+extern void                     storeFromList(struct wetting_front* head, struct wetting_front_store *store);
+extern void                     storeToList(const struct wetting_front_store *store, struct wetting_front** head,
+					    struct wetting_front_pool *pool);
+extern struct wetting_front*    storeGetFront(const struct wetting_front_store *store, int wf, struct wetting_front *front);
+extern const struct wetting_front_store* snapshotTake(struct wetting_front* head, struct wetting_front_snapshot *snapshot);
 
 
 
@@ -322,9 +555,30 @@ extern double calc_K_from_Se(double Se,double Ks, double m);
 extern double calc_h_from_Se(double Se, double alpha, double m, double n);
 extern double calc_Se_from_h(double h, double alpha, double m, double n);
 extern double calc_theta_from_h(double h, double alpha, double m, double n, double theta_e, double theta_r);
+extern double calc_dtheta_dh_from_h(double h, double alpha, double m, double n, double theta_e, double theta_r);
 extern double calc_Se_from_theta(double theta,double effsat,double residual);
+
+// van Genuchten relations of a soil; these use the soil's lookup tables if they have been built, closed forms otherwise
+extern void   lgar_build_vG_tables(struct soil_properties_ *soil, double tolerance);
+extern double soil_theta_from_h(const struct soil_properties_ *soil, double h);
+extern double soil_h_from_Se(const struct soil_properties_ *soil, double Se);
+extern double soil_K_from_Se(const struct soil_properties_ *soil, double Se, double Ksat);
+extern void   lgar_build_Geff_table(struct soil_properties_ *soil);
+extern void   lgar_calc_soil_constants(struct soil_properties_ *soil);
+extern double soil_Geff(const struct soil_properties_ *soil, bool use_closed_form_G, double theta1, double theta2,
+			double Ksat, int nint, struct Geff_quadrature *quadrature);
 extern double calc_Geff(bool use_closed_form_G, double theta1, double theta2, double theta_e, double theta_r,
-                        double alpha, double n, double m, double h_min, double Ks, int nint, double lambda, double bc_psib_cm);
+                        double alpha, double n, double m, double h_min, double Ks, int nint, double lambda, double bc_psib_cm,
+			struct Geff_quadrature *quadrature);
+
+/*########################################*/
+/*   quadrature function prototypes       */
+/*########################################*/
+// integrals of f(h) from a to b (0 <= a < b) over u = ln(h); the number of evaluations of f is added to *num_evals
+extern double quad_gauss_legendre_log_h(double (*f)(double, const void*), const void *context, double a, double b,
+					long *num_evals);
+extern double quad_tanh_sinh_log_h(double (*f)(double, const void*), const void *context, double a, double b,
+				   double tolerance, long *num_evals);
 
 /*########################################*/
 /* LGAR calculation function prototypes   */
@@ -332,15 +586,16 @@ extern double calc_Geff(bool use_closed_form_G, double theta1, double theta2, do
 // computed mass balance
 extern double lgar_calc_mass_bal(double *cum_layer_thickness, struct wetting_front* head);
 
-extern void lgar_clean_redundant_fronts(struct wetting_front** head, int *soil_type, struct soil_properties_ *soil_properties);
+extern void lgar_clean_redundant_fronts(struct wetting_front** head, struct wetting_front_pool *pool, int *soil_type,
+					struct soil_properties_ *soil_properties);
 
 // computes derivatives; called derivs() in Python code
-extern void lgar_dzdt_calc(bool use_closed_form_G, int nint, int num_layers, double h_p, double subtimestep_h, int *soil_type, double *cum_layer_thickness,
-			   double *frozen_factor, struct wetting_front* head, struct soil_properties_ *soil_properties, bool switch_caching, int cache_count, int new_front);
+extern void lgar_dzdt_calc(bool use_closed_form_G, int nint, struct Geff_quadrature *quadrature, double h_p, double subtimestep_h, int *soil_type, double *cum_layer_thickness,
+			   const struct lgar_derived_constants *derived, struct wetting_front* head, struct soil_properties_ *soil_properties, bool switch_caching, int cache_count, int new_front);
 
 // computes dry depth
-extern double lgar_calc_dry_depth(bool use_closed_form_G, int nint, double timestep_h, double *deltheta, int *soil_type,
-                                  double *cum_layer_thickness_cm, double *frozen_factor,
+extern double lgar_calc_dry_depth(bool use_closed_form_G, int nint, struct Geff_quadrature *quadrature, double timestep_h, double *deltheta, int *soil_type,
+                                  double *cum_layer_thickness_cm, const struct lgar_derived_constants *derived,
 				  struct wetting_front* head, struct soil_properties_ *soil_properties);
 
 // reads van Genuchten parameters from a file
@@ -350,24 +605,26 @@ extern int lgar_read_vG_param_file(char const* vG_param_file_name, int num_soil_
 // creates a surficial front (new top most wetting front)
 extern void lgar_create_surficial_front(int num_layers, double *ponded_depth_cm, double *volin, double dry_depth,
 					double theta1, int *soil_type, double *cum_layer_thickness_cm,
-					double *frozen_factor, struct wetting_front **head, struct soil_properties_ *soil_properties);
+					double *frozen_factor, struct wetting_front **head, struct wetting_front_pool *pool,
+					struct soil_properties_ *soil_properties);
 
 // computes the infiltration capacity, fp, of the soil
-extern double lgar_insert_water(bool use_closed_form_G, int nint, double timestep_h, double AET_demand_cm, double free_drainage_subtimestep_cm, double *ponded_depth,
+extern double lgar_insert_water(bool use_closed_form_G, int nint, struct Geff_quadrature *quadrature, double timestep_h, double AET_demand_cm, double free_drainage_subtimestep_cm, double *ponded_depth,
 				double *volin_this_timestep, double precip_timestep_cm, int wf_free_drainge_demand,
 				int num_layers, double ponded_depth_max_cm, int *soil_type, double *cum_layer_thickness_cm,
-				double *frozen_factor, struct wetting_front* head, struct soil_properties_ *soil_properties);
+				const struct lgar_derived_constants *derived, struct wetting_front* head, struct soil_properties_ *soil_properties);
 
 // the subroutine moves wetting fronts, merges wetting fronts, and does the mass balance correction if needed
 extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_subtimestep_cm, double *interflow_subtimestep_cm, double interflow_psi_threshold_cm,
 				     double interflow_factor, double *ponded_depth_cm, int wf_free_drainage_demand,
 				     double old_mass, double mass_correction_for_cached_free_drainage_fluxes, int number_of_layers, double *actual_ET_demand,
 				     double *cum_layer_thickness_cm, int *soil_type_by_layer, double *frozen_factor,
-				     struct wetting_front** head, struct wetting_front* state_previous, struct soil_properties_ *soil_properties);
+				     struct wetting_front** head, struct wetting_front_pool *pool, const struct wetting_front_store* state_previous,
+				     struct soil_properties_ *soil_properties);
 
 // the subroutine merges the wetting fronts; called from lgar_move_wetting_fronts
 extern void lgar_merge_wetting_fronts(int *soil_type, double *frozen_factor, struct wetting_front** head,
-				      struct soil_properties_ *soil_properties);
+				      struct wetting_front_pool *pool, struct soil_properties_ *soil_properties);
 
 // the subroutine lets wetting fronts cross soil layer boundaries; called from lgar_move_wetting_fronts
 extern void lgar_wetting_fronts_cross_layer_boundary(int num_layers, double* cum_layer_thickness_cm,
@@ -378,11 +635,21 @@ extern void lgar_wetting_fronts_cross_layer_boundary(int num_layers, double* cum
    called from lgar_move_wetting_fronts. Currently, fluxes from the lower boundary will always be 0 and this fraction of a
    wetting front will be dealth with in another way */
 extern double lgar_wetting_front_cross_domain_boundary(double domain_depth_cm, int *soil_type, double *frozen_factor,
-						       struct wetting_front** head, struct soil_properties_ *soil_properties);
+						       struct wetting_front** head, struct wetting_front_pool *pool,
+						       struct soil_properties_ *soil_properties);
 
 // subroutine to handle wet over dry wetting fronts condtions
 extern void lgar_fix_dry_over_wet_wetting_fronts(double *mass_change, double* cum_layer_thickness_cm, int *soil_type,
-						 struct wetting_front** head, struct soil_properties_ *soil_properties);
+						 struct wetting_front** head, struct wetting_front_pool *pool,
+						 struct soil_properties_ *soil_properties);
+
+// error estimate of a substep relative to the tolerances of the error-controlled adaptive timestep, and the size of the next substep
+extern double lgar_substep_error(const struct wetting_front_store *start, struct wetting_front* head, double timestep_h,
+				 double local_mass_balance_cm, double front_tol_cm, double mbal_tol_cm);
+extern double lgar_substep_next_size(double timestep_h, double error, double minimum_timestep_h, double maximum_timestep_h);
+
+// halves or doubles the flux caching horizon from the drifts over the cache window that just ended
+extern void lgar_adapt_flux_caching_horizon(struct flux_caching_policy *policy, double storage_cm, double dzdt_cm_per_h);
 
 // checks if dry over wet wetting front exists or not
 extern bool lgar_check_dry_over_wet_wetting_fronts(struct wetting_front* head);
@@ -392,7 +659,7 @@ extern int wetting_front_free_drainage(struct wetting_front* head);
 
 // computes updated theta (soil moisture content) after moving down a wetting front; called for each wetting front to ensure mass is conserved
 extern double lgar_theta_mass_balance(int layer_num, int soil_num, double psi_cm, double new_mass,
-				      double prior_mass, double precip_mass_to_add, double *AET_demand_cm, double *delta_theta, double *layer_thickness_cm,
+				      double prior_mass, double *AET_demand_cm, double *delta_theta, double *layer_thickness_cm,
 				      int *soil_type, struct soil_properties_ *soil_properties);
 
 // computes updated theta (soil moisture content) after fixing a dry over wet front or after layer boundary crossing to address edge cases 
@@ -408,16 +675,21 @@ extern double calc_storage_in_free_drainage_wetting_front(int wf_free_drainage,
 // functions to initialize model's state at time zero from a config file
 extern void lgar_initialize(string config_file, struct model_state *state);
 extern void InitFromConfigFile(string config_file, struct model_state *state);
+extern void lgar_build_soil_tables(struct model_state *state);
+extern void lgar_update_derived_constants(const struct lgar_bmi_parameters *lgar_bmi_params,
+					  const struct soil_properties_ *soil_properties,
+					  struct lgar_derived_constants *derived);
 extern vector<double> ReadVectorData(string key);
 extern void InitializeWettingFronts(bool is_invalid_soil_type, int num_layers, double initial_psi_cm, int *layer_soil_type, double *cum_layer_thickness_cm,
-				    double *frozen_factor, struct wetting_front** head, struct soil_properties_ *soil_properties);
+				    double *frozen_factor, struct wetting_front** head, struct wetting_front_pool *pool,
+				    struct soil_properties_ *soil_properties);
 
 /********************************************************************/
 /*Other function prototypes for doing hydrology calculations, etc.  */
 /********************************************************************/
 
-extern double calc_aet(double PET_timestep_cm, double timestep_h, double wilting_point_psi_cm, double field_capacity_psi_cm, int *soil_type,
-		       double AET_thresh_Theta, double AET_expon, struct wetting_front* head, struct soil_properties_ *soil_props);
+extern double calc_aet(double PET_timestep_cm, double timestep_h, double AET_thresh_Theta, double AET_expon,
+		       struct wetting_front* head, const struct lgar_derived_constants *derived);
 
 //returns an integer that describes which type of layer boundary crossing or WF merging is necessary
 extern int lgarto_correction_type_surf(int num_layers, double* cum_layer_thickness_cm, struct wetting_front** head);
@@ -429,16 +701,15 @@ extern int lgarto_correction_type_surf(int num_layers, double* cum_layer_thickne
 // computes global mass balance at the end of the simulation
 extern void lgar_global_mass_balance(struct model_state *state, double *giuh_runoff_queue);
 
-// writes full state of wetting fronts (depth, theta, no. of wetting front, no. of layer, dz/dt, psi) to a file at each time step
-extern void write_state(FILE *out, struct wetting_front* head);
-
 
 /********************************************************************/
 /* Function used in coupling with seasonally frozen soil modules  */
 /********************************************************************/
 
 // computes frozen factor for each layer (coefficient used to modify hydraulic conductivity of layers)
-extern void frozen_factor_hydraulic_conductivity(struct lgar_bmi_parameters lgar_bmi_params);
+extern void frozen_factor_hydraulic_conductivity(struct lgar_bmi_parameters lgar_bmi_params,
+						 const struct soil_properties_ *soil_properties,
+						 struct lgar_derived_constants *derived);
 
 /*###################################################################*/
 /*   1- and 2-D int and double memory allocation function prototypes */
@@ -450,6 +721,21 @@ extern void i_alloc(int **var,int size);
 extern void f_alloc(float **var,int size);
 
 
+/*####################################*/
+/*   forcing data function prototypes */
+/*####################################*/
+extern std::string GetForcingFile(std::string config_file);
+extern void        ReadForcingFile(std::string forcing_file, struct forcing_data *forcing);
+extern void        ReadForcingData(std::string config_file, struct forcing_data *forcing);
+extern std::string forcing_time_string(double time_s);
+extern bool        IsBinaryForcingFile(std::string forcing_file);
+extern void        ValidateForcingData(const struct forcing_data *forcing);
+extern void        WriteBinaryForcingFile(std::string binary_file, const struct forcing_data *forcing);
+extern void        OpenForcingSeries(std::string forcing_file, struct forcing_series *series);
+extern void        CloseForcingSeries(struct forcing_series *series);
+extern double      forcing_series_time(const struct forcing_series *series, long step);
+
+
 /*###############################*/
 /*   utility function prototypes */
 /*###############################*/
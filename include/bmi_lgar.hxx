@@ -149,9 +149,52 @@ public:
   void global_mass_balance();
   double update_calibratable_parameters();
   struct model_state* get_model();
+
+  // supplies the forcing of the next num_steps timesteps in advance (arrays owned by the caller, strides in elements)
+  void SetForcingSeries(const double *precipitation_mm_per_h, const double *PET_mm_per_h, int num_steps,
+			int precipitation_stride = 1, int PET_stride = 1);
+  // same as SetForcingSeries, but the model keeps its own copy of the forcing
+  void CopyForcingSeries(const double *precipitation_mm_per_h, const double *PET_mm_per_h, int num_steps,
+			 int precipitation_stride = 1, int PET_stride = 1);
+  // number of forcing series entries not yet used
+  int GetForcingSeriesRemaining();
+
+  // variable handles, resolve a variable name once and access the variable without name lookups
+  int GetVarHandle(std::string name);
+  int GetVarNbytesByHandle(int handle);
+  void GetValueByHandle(int handle, void *dest);
+  void SetValueByHandle(int handle, void *src);
+  void *GetValuePtrByHandle(int handle);
+
+  // checkpoint/restart: the state of the model (wetting fronts, storages, mass balance accumulators, GIUH queue, ...)
+  // as a versioned binary image, restored into a model initialized from the same config file (see checkpoint.cxx)
+  void SaveState(std::vector<char> &buffer);
+  void RestoreState(const char *buffer, size_t nbytes);
+  void SaveStateToFile(std::string file_name);
+  void RestoreStateFromFile(std::string file_name);
   
 private:
-  void realloc_soil();
+  void advance_timestep();
+  void update_outputs();
+  void *value_ptr(int handle, const std::string *name);
+  bool serialization_request(int handle, void *src);
+  template <class Archive> void checkpoint_fields(Archive &archive);
+
+  // forcing series supplied with SetForcingSeries, consumed one entry per forcing timestep
+  struct forcing_series_view {
+    const double *precipitation_mm_per_h = nullptr;
+    const double *PET_mm_per_h = nullptr;
+    int precipitation_stride = 1;
+    int PET_stride = 1;
+    int num_steps = 0;
+    int next_step = 0;
+  };
+  struct forcing_series_view forcing_series;
+  std::vector<double> forcing_series_copy; // storage of CopyForcingSeries, precipitation followed by PET
+
+  // state serialized through the BMI (serialization_create/state/size/free)
+  std::vector<char> serialization_buffer;
+  int serialization_size = 0;
   struct model_state* state;
   static const int input_var_name_count  = 3;
   static const int output_var_name_count = 15;
@@ -196,10 +239,7 @@ extern "C"
    * @return A pointer to the newly allocated instance.
    */
   
-  BmiLGAR *bmi_model_create()
-  {
-    return new BmiLGAR();
-  }
+  BmiLGAR *bmi_model_create();
   
   /**
    * @brief Destroy/free an instance created with @see bmi_model_create
@@ -207,10 +247,7 @@ extern "C"
    * @param ptr 
    */
   
-  void bmi_model_destroy(BmiLGAR *ptr)
-  {
-    delete ptr;
-  }
+  void bmi_model_destroy(BmiLGAR *ptr);
   
 }
 
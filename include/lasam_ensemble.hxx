@@ -0,0 +1,103 @@
+#ifndef LASAM_ENSEMBLE_HXX_INCLUDED
+#define LASAM_ENSEMBLE_HXX_INCLUDED
+
+/*
+  Description: runs many independent LASAM instances (e.g. one per catchment) to a common time on a pool of threads.
+               Every instance is advanced by one thread at a time and the instances share no state, so the results
+               do not depend on the number of threads or on which thread advanced which instance.
+*/
+
+#include <memory>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <exception>
+#include "bmi_lgar.hxx"
+
+// cost statistics of a catchment (used to balance the load and to find the expensive catchments)
+struct ensemble_catchment_stats
+{
+  double seconds_total      = 0.0; // wall time spent advancing the catchment
+  double seconds_last       = 0.0; // wall time of the last UpdateUntil
+  long   num_updates        = 0;   // number of UpdateUntil calls the catchment took part in
+  int    max_wetting_fronts = 0;   // largest number of wetting fronts at the end of an UpdateUntil
+};
+
+class LasamEnsemble {
+public:
+  // num_threads = 0 uses one thread per hardware thread; the calling thread is one of the threads
+  explicit LasamEnsemble(int num_threads = 0);
+  ~LasamEnsemble();
+
+  // initializes a catchment from its config file and attaches the forcing of its forcing_file; returns its index
+  int AddCatchment(std::string config_file, bool read_forcing = true);
+
+  // initializes one member per parameter set from the same config file, the forcing is read once and shared by the
+  // members; parameter_names are calibratable variables (e.g. "smcmax_1"); returns the index of the first member
+  int AddParameterEnsemble(std::string config_file, const std::vector<std::string> &parameter_names,
+			   const std::vector<std::vector<double>> &parameter_sets);
+
+  // records the given scalar output variables of every catchment after each timestep (sums always, series optional)
+  void RecordOutputs(const std::vector<std::string> &names, bool keep_series = true);
+
+  // advances all catchments until time t [s] (see BmiLGAR::UpdateUntil)
+  void UpdateUntil(double t);
+
+  // finalizes the catchments, in the order they were added
+  void Finalize();
+
+  int GetNumCatchments();
+  int GetNumThreads();
+  BmiLGAR* GetCatchment(int index);
+  const struct ensemble_catchment_stats& GetCatchmentStats(int index);
+  long GetNumSteals();  // number of catchments advanced by a thread other than the one they were assigned to
+  const std::vector<double>& GetRecordedSeries(int index, std::string name);
+  double GetRecordedSum(int index, std::string name);
+
+private:
+  // deque of catchment indices of a thread; the owner takes from the front, other threads steal from the back
+  struct work_queue {
+    std::mutex lock;
+    std::deque<int> catchments;
+  };
+
+  void worker_loop(int thread_num);
+  void run_queues(int thread_num);
+  bool next_catchment(int thread_num, int *catchment);
+  void advance_catchment(int catchment);
+  void record_outputs(int catchment);
+  int recorded_index(std::string name);
+  std::shared_ptr<struct forcing_series> read_forcing_series(std::string config_file);
+
+  std::vector<std::unique_ptr<BmiLGAR>> models;
+  std::vector<std::shared_ptr<struct forcing_series>> forcing; // forcing of each catchment, shared by members
+  std::map<std::string, std::shared_ptr<struct forcing_series>> forcing_files; // series opened so far, by forcing file
+  std::vector<struct ensemble_catchment_stats> stats;
+
+  // outputs recorded after each timestep, indexed [catchment][variable] (and [timestep] for the series)
+  std::vector<std::string> recorded_names;
+  std::vector<int> recorded_handles;
+  bool keep_recorded_series = true;
+  std::vector<std::vector<std::vector<double>>> recorded_series;
+  std::vector<std::vector<double>> recorded_sums;
+
+  int num_threads;
+  std::vector<std::thread> workers;                  // threads 1..num_threads-1, thread 0 is the caller
+  std::vector<std::unique_ptr<work_queue>> queues;   // one per thread
+
+  // a run is started by increasing run_number and finished when num_running drops to zero
+  std::mutex pool_lock;
+  std::condition_variable run_started, run_finished;
+  long run_number  = 0;
+  int  num_running = 0;
+  bool stopping    = false;
+  double target_time_s = 0.0;
+
+  std::mutex counters_lock;
+  long num_steals = 0;
+  std::exception_ptr error;                          // first exception thrown by a catchment in the current run
+};
+
+#endif
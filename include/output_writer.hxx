@@ -0,0 +1,119 @@
+#ifndef OUTPUT_WRITER_HXX_INCLUDED
+#define OUTPUT_WRITER_HXX_INCLUDED
+
+/*
+  Description: writes the output files of the standalone driver (data_variables and data_layers) on a dedicated
+               thread. The model thread copies the values of a timestep into a preallocated row of a single-producer
+               single-consumer ring and continues; the writer thread formats the rows (text) or copies them (binary)
+               and writes them in large blocks.
+*/
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "all.hxx"
+
+enum output_format {
+  OUTPUT_TEXT   = 0,  // csv variables file and a text layers file with one line of fronts per row
+  OUTPUT_BINARY = 1   // float64 records, see output_writer.cxx
+};
+
+class OutputWriter {
+public:
+  // opens the output files and starts the writer thread; variable_names are the columns of the variables file; a file
+  // with an empty name is not written
+  OutputWriter(std::string variables_file, std::string layers_file, const std::vector<std::string> &variable_names,
+	       enum output_format format = OUTPUT_TEXT, int queue_rows = 256);
+  ~OutputWriter();
+
+  // queues the outputs of a timestep: the values of the variables (in the order of variable_names) with the time of
+  // their row, and the wetting fronts with the time of the timestep; values or head NULL writes no row to that file.
+  // Waits only if the writer thread is queue_rows steps behind.
+  void WriteStep(int step, double time_s, const double *values, double values_time_s, const struct wetting_front *head);
+
+  // writes the queued rows, stops the writer thread and closes the files; throws if a write failed
+  void Close();
+
+private:
+  // outputs of one timestep; the buffers are allocated once and reused (the fronts grow to the largest count seen)
+  struct output_row {
+    int step;
+    double time_s, values_time_s;
+    bool has_values, has_fronts;
+    std::vector<double> values;
+    std::vector<double> fronts;   // depth [mm], theta, layer, front number and psi [mm] of each front
+  };
+
+  void writer_loop();
+  void format_text(const struct output_row &row);
+  void format_binary(const struct output_row &row);
+  void flush_buffers(bool force);
+
+  std::vector<std::string> variable_names;
+  enum output_format format;
+  FILE *variables_fp = NULL;
+  FILE *layers_fp = NULL;
+  std::string variables_file, layers_file;
+  std::string variables_buffer, layers_buffer;  // output not yet written
+  bool write_failed = false;
+
+  // ring of rows: the model thread fills row write_index % size, the writer thread empties row read_index % size
+  std::vector<struct output_row> rows;
+  std::atomic<size_t> write_index{0}, read_index{0};
+  size_t wake_rows;                     // the writer thread sleeps until this many rows are queued (or at Close)
+
+  std::mutex sleep_lock;
+  std::condition_variable rows_queued;
+  std::atomic<bool> writer_sleeping{false};
+  std::atomic<bool> closing{false};
+  std::thread writer;
+};
+
+// aggregation of an output variable over an output interval
+enum output_aggregation {
+  AGGREGATE_MEAN = 0,
+  AGGREGATE_SUM  = 1,
+  AGGREGATE_MAX  = 2,
+  AGGREGATE_MIN  = 3,
+  AGGREGATE_LAST = 4
+};
+
+// output options of the standalone driver (output_* keys of the config file, see configs/README.md)
+struct output_config
+{
+  std::vector<std::string>             variable_names;         // columns of the variables file, empty for no file
+  std::vector<enum output_aggregation> aggregation;            // of each variable over an output interval
+  int                                  interval_steps;         // timesteps per row of the variables file
+  bool                                 write_layers;           // write the wetting fronts to the layers file
+  int                                  layers_interval_steps;  // timesteps between the rows of the layers file
+};
+
+// aggregates the values of the output variables over an output interval; the driver completes a row at the end of each
+// interval (the last interval of a run may be shorter)
+class OutputAggregator {
+public:
+  explicit OutputAggregator(const std::vector<enum output_aggregation> &aggregation);
+
+  // adds the values of a timestep (in the order of aggregation); time_s is the time of the timestep
+  void Add(const double *values, double time_s);
+
+  // returns the aggregates of the timesteps added since the last row (NULL if there are none) and the time of the
+  // first of them, and starts the next interval; the aggregates stay valid until the next Add
+  const double* CompleteRow(double *interval_time_s);
+
+private:
+  std::vector<enum output_aggregation> aggregation;
+  std::vector<double> aggregates;  // sums (mean, sum), extremes (max, min) or values (last) of the current interval
+  std::vector<double> row;
+  int count = 0;                   // timesteps of the current interval
+  double interval_time_s = 0.0;    // time of its first timestep
+};
+
+// reads the output options from the config file; intervals are converted to timesteps of timestep_s seconds
+extern void ReadOutputConfig(std::string config_file, double timestep_s, struct output_config *config);
+
+// writes value as printf("%.<precision>f") would (0 <= precision <= 15) and returns the end of the text
+extern char* format_fixed(char *out, double value, int precision);
+
+#endif
@@ -14,12 +14,11 @@
 //################################################################################
 
 
-extern double calc_aet(double PET_timestep_cm, double time_step_h, double wilting_point_psi_cm, double field_capacity_psi_cm,
-		       int *soil_type, double AET_thresh_Theta, double AET_expon,
-		       struct wetting_front* head, struct soil_properties_ *soil_properties)
+extern double calc_aet(double PET_timestep_cm, double time_step_h, double AET_thresh_Theta, double AET_expon,
+		       struct wetting_front* head, const struct lgar_derived_constants *derived)
 {
 
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     printf("Computing AET... \n");
     printf("Note: AET_thresh_theta = %lf and AET_expon = %lf are not used in the computation of the current AET model. \n", AET_thresh_Theta, AET_expon);
   }
@@ -30,32 +29,10 @@ extern double calc_aet(double PET_timestep_cm, double time_step_h, double wiltin
 
   if (current->psi_cm<1.E6){ // for some extremely dry soils and combinations of van Genuchten parameters, it is possible to get an AET value that would reduce theta to below theta_r. 
                              // while this has been addressed in a variety of places, a simple solution is to just not allow AET for extremely dry soils.
-    double theta_wp;
-    
-    double Se,theta_e,theta_r;
-    double vg_a, vg_m, vg_n;
-    int layer_num, soil_num;
 
-    layer_num = current->layer_num;
-    soil_num  = soil_type[layer_num];
-    theta_e   = soil_properties[soil_num].theta_e;
-    theta_r   = soil_properties[soil_num].theta_r;
-    vg_a      = soil_properties[soil_num].vg_alpha_per_cm;
-    vg_m      = soil_properties[soil_num].vg_m;
-    vg_n      = soil_properties[soil_num].vg_n;
-
-    // compute theta field capacity
-    double head_at_which_PET_equals_AET_cm = field_capacity_psi_cm; //340.9 is 0.33 atm, expressed in water depth, which is a good field capacity for most soils.
-    //Coarser soils like sand will have a field capacity of 0.1 atm or so, which would be 103.3 cm.
-    double theta_fc = calc_theta_from_h(head_at_which_PET_equals_AET_cm, vg_a,vg_m, vg_n, theta_e, theta_r);
-    
-    double wp_head_theta = calc_theta_from_h(wilting_point_psi_cm, vg_a,vg_m, vg_n, theta_e, theta_r);
-    
-    
-    theta_wp = (theta_fc - wp_head_theta)*1/2 + wp_head_theta; // theta_50 in python
-
-    Se = calc_Se_from_theta(theta_wp,theta_e,theta_r);
-    double psi_wp_cm = calc_h_from_Se(Se, vg_a, vg_m, vg_n);
+    // h_50 is computed from the field capacity and the wilting point of the soil of the layer when the parameters change,
+    // see lgar_update_derived_constants() in lgar.cxx
+    double psi_wp_cm = derived->h_50_cm[current->layer_num];
 
     double h_ratio = 1.0 + pow(current->psi_cm/psi_wp_cm, 3.0);
 
@@ -68,7 +45,7 @@ extern double calc_aet(double PET_timestep_cm, double time_step_h, double wiltin
 
   }
 
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     printf("AET =  %14.10f \n",actual_ET_demand);
   }
   
@@ -9,50 +9,21 @@
 #include <vector>
 #include <algorithm>
 #include <iostream>
+#include <unordered_map>
 #include "../bmi/bmi.hxx"
 #include "../include/bmi_lgar.hxx"
 #include "../include/all.hxx"
 
 
-// default verbosity is set to 'none' other option 'high' or 'low' needs to be specified in the config file
-string verbosity="none";
-
-// some macros for flux caching, these are not relevant if flux caching is disabled in the config file.
-// precip intensity above which flux caching does not occur
-#ifndef PRECIP_THRESHOLD_MM_PER_H
-#define PRECIP_THRESHOLD_MM_PER_H ((double)1.0e-6)
-#endif
+// verbosity of the model instance whose BMI call runs on this thread (see verbosity_scope in all.hxx); the verbosity of
+// an instance is set in its config file, default is 'none', other options are 'high' or 'low'
+thread_local int verbosity = VERBOSITY_NONE;
 
 // Small epsilon added to PET denominator to prevent division by 0, and in another case to check if there is significant PET
 #ifndef PET_EPSILON
 #define PET_EPSILON ((double)1.0e-8)
 #endif
 
-// Threshold for AET/PET ratio to indicate low enough AET for flux caching to start
-#ifndef AET_PET_RATIO_THRESHOLD
-#define AET_PET_RATIO_THRESHOLD ((double)0.75)
-#endif
-
-// while ponded head is greater than this, flux caching will not occur
-#ifndef VOLON_TIMESTEP_THRESHOLD_CM
-#define VOLON_TIMESTEP_THRESHOLD_CM ((double)1.0e-16)
-#endif
-
-// While the vadose zone lower boundary flux is greater than this, flux caching will not happen
-#ifndef BOTTOM_BDY_FLUX_THRESHOLD_CM
-#define BOTTOM_BDY_FLUX_THRESHOLD_CM ((double)1.0e-4)
-#endif
-
-// While the top most wetting front has a dzdt value greater than this, flux caching will not happen
-#ifndef THRESHOLD_DZDT_CM_PER_H
-#define THRESHOLD_DZDT_CM_PER_H ((double)1.0e0)
-#endif
-
-// Number of timesteps before flux cache reset
-#ifndef NUM_TIMESTEPS_BEFORE_RESET_CACHE
-#define NUM_TIMESTEPS_BEFORE_RESET_CACHE 24
-#endif
-
 // small epsillon that is used to determine if the difference between two quantities is 0 while avoiding machine precision errors
 #define SMALL_EPS 1.E-12
 
@@ -67,6 +38,105 @@ static bool any_wetting_front_can_interflow(struct wetting_front *head, double i
 }
 
 
+// variables exposed through the BMI (aliases point to the same variable)
+enum bmi_var {
+  BMI_VAR_NONE, // known name without a value (e.g. only a grid)
+  BMI_VAR_PRECIPITATION_RATE, BMI_VAR_PRECIPITATION, BMI_VAR_PET_RATE, BMI_VAR_PET, BMI_VAR_AET,
+  BMI_VAR_SURFACE_RUNOFF, BMI_VAR_GIUH_RUNOFF, BMI_VAR_SOIL_STORAGE, BMI_VAR_CR_STORAGE, BMI_VAR_TOTAL_DISCHARGE,
+  BMI_VAR_INFILTRATION, BMI_VAR_PERCOLATION, BMI_VAR_CR_TO_STREAM, BMI_VAR_MASS_BALANCE,
+  BMI_VAR_SOIL_DEPTH_LAYERS, BMI_VAR_SOIL_MOISTURE_WF, BMI_VAR_SOIL_DEPTH_WF, BMI_VAR_SOIL_NUM_WF,
+  BMI_VAR_SOIL_TEMPERATURE_PROFILE,
+  BMI_VAR_SMCMAX_1, BMI_VAR_SMCMIN_1, BMI_VAR_VG_N_1, BMI_VAR_VG_ALPHA_1, BMI_VAR_KSAT_1,
+  BMI_VAR_SMCMAX_2, BMI_VAR_SMCMIN_2, BMI_VAR_VG_N_2, BMI_VAR_VG_ALPHA_2, BMI_VAR_KSAT_2,
+  BMI_VAR_SMCMAX_3, BMI_VAR_SMCMIN_3, BMI_VAR_VG_N_3, BMI_VAR_VG_ALPHA_3, BMI_VAR_KSAT_3,
+  BMI_VAR_PONDED_DEPTH_MAX, BMI_VAR_FIELD_CAPACITY, BMI_VAR_A_CON_RES, BMI_VAR_B_CON_RES, BMI_VAR_FRAC_TO_CR,
+  BMI_VAR_A_CON_RES_SLOW, BMI_VAR_B_CON_RES_SLOW, BMI_VAR_FRAC_SLOW, BMI_VAR_INTERFLOW_PSI_THRESHOLD,
+  BMI_VAR_INTERFLOW_FACTOR, BMI_VAR_SPF_FACTOR,
+  BMI_VAR_FC_PRECIP_THRESHOLD, BMI_VAR_FC_AET_PET_RATIO_THRESHOLD, BMI_VAR_FC_PONDED_DEPTH_THRESHOLD,
+  BMI_VAR_FC_BOTTOM_FLUX_THRESHOLD, BMI_VAR_FC_DZDT_THRESHOLD, BMI_VAR_FC_HORIZON,
+  BMI_VAR_SERIALIZATION_CREATE, BMI_VAR_SERIALIZATION_SIZE, BMI_VAR_SERIALIZATION_STATE, BMI_VAR_SERIALIZATION_FREE
+};
+
+// grid 0: int scalar, 1: double scalar, 2: layers (fixed), 3: wetting fronts (dynamic), 4: soil temperature profile,
+// 5: serialized state (char), -1: no grid; the handle of a variable is its index in this table
+struct bmi_var_info {
+  const char *name;
+  int var;
+  int grid;
+  const char *units;
+  const char *location;
+};
+
+static const struct bmi_var_info bmi_var_table[] = {
+  {"precipitation_rate",                       BMI_VAR_PRECIPITATION_RATE,          1, "mm h^-1", "node"},
+  {"precipitation",                            BMI_VAR_PRECIPITATION,               1, "m",       "node"},
+  {"potential_evapotranspiration_rate",        BMI_VAR_PET_RATE,                    1, "mm h^-1", "node"},
+  {"potential_evapotranspiration",             BMI_VAR_PET,                         1, "m",       "node"},
+  {"actual_evapotranspiration",                BMI_VAR_AET,                         1, "m",       "node"},
+  {"surface_runoff",                           BMI_VAR_SURFACE_RUNOFF,              1, "m",       "node"},
+  {"giuh_runoff",                              BMI_VAR_GIUH_RUNOFF,                 1, "m",       "node"},
+  {"soil_storage",                             BMI_VAR_SOIL_STORAGE,                1, "m",       "node"},
+  {"conceptual_reservoir_storage",             BMI_VAR_CR_STORAGE,                 -1, "none",    "none"},
+  {"total_discharge",                          BMI_VAR_TOTAL_DISCHARGE,             1, "m",       "node"},
+  {"infiltration",                             BMI_VAR_INFILTRATION,                1, "m",       "node"},
+  {"percolation",                              BMI_VAR_PERCOLATION,                 1, "m",       "node"},
+  {"conceptual_reservoir_to_stream_discharge", BMI_VAR_CR_TO_STREAM,                1, "m",       "node"},
+  {"mass_balance",                             BMI_VAR_MASS_BALANCE,                1, "m",       "node"},
+  {"soil_depth_layers",                        BMI_VAR_SOIL_DEPTH_LAYERS,           2, "m",       "node"},
+  {"soil_moisture_wetting_fronts",             BMI_VAR_SOIL_MOISTURE_WF,            3, "none",    "node"},
+  {"soil_depth_wetting_fronts",                BMI_VAR_SOIL_DEPTH_WF,               3, "m",       "node"},
+  {"soil_num_wetting_fronts",                  BMI_VAR_SOIL_NUM_WF,                 0, "none",    "node"},
+  {"soil_temperature_profile",                 BMI_VAR_SOIL_TEMPERATURE_PROFILE,    4, "K",       "node"},
+  {"soil_storage_model",                       BMI_VAR_NONE,                        0, "none",    "none"},
+  {"smcmax_1",                                 BMI_VAR_SMCMAX_1,                    1, "none",    "none"},
+  {"smcmin_1",                                 BMI_VAR_SMCMIN_1,                    1, "none",    "none"},
+  {"van_genuchten_n_1",                        BMI_VAR_VG_N_1,                      1, "none",    "none"},
+  {"van_genuchten_alpha_1",                    BMI_VAR_VG_ALPHA_1,                  1, "none",    "none"},
+  {"hydraulic_conductivity_1",                 BMI_VAR_KSAT_1,                      1, "none",    "none"},
+  {"van_genuchten_m_1",                        BMI_VAR_NONE,                        1, "none",    "none"},
+  {"smcmax_2",                                 BMI_VAR_SMCMAX_2,                    1, "none",    "none"},
+  {"smcmin_2",                                 BMI_VAR_SMCMIN_2,                    1, "none",    "none"},
+  {"van_genuchten_n_2",                        BMI_VAR_VG_N_2,                      1, "none",    "none"},
+  {"van_genuchten_alpha_2",                    BMI_VAR_VG_ALPHA_2,                  1, "none",    "none"},
+  {"hydraulic_conductivity_2",                 BMI_VAR_KSAT_2,                      1, "none",    "none"},
+  {"van_genuchten_m_2",                        BMI_VAR_NONE,                        1, "none",    "none"},
+  {"smcmax_3",                                 BMI_VAR_SMCMAX_3,                   -1, "none",    "none"},
+  {"smcmin_3",                                 BMI_VAR_SMCMIN_3,                   -1, "none",    "none"},
+  {"van_genuchten_n_3",                        BMI_VAR_VG_N_3,                     -1, "none",    "none"},
+  {"van_genuchten_alpha_3",                    BMI_VAR_VG_ALPHA_3,                 -1, "none",    "none"},
+  {"hydraulic_conductivity_3",                 BMI_VAR_KSAT_3,                     -1, "none",    "none"},
+  {"ponded_depth_max",                         BMI_VAR_PONDED_DEPTH_MAX,            1, "none",    "none"},
+  {"field_capacity",                           BMI_VAR_FIELD_CAPACITY,              1, "none",    "none"},
+  {"a_con_res",                                BMI_VAR_A_CON_RES,                   1, "none",    "node"},
+  {"a",                                        BMI_VAR_A_CON_RES,                   1, "none",    "node"},
+  {"b_con_res",                                BMI_VAR_B_CON_RES,                   1, "none",    "node"},
+  {"b",                                        BMI_VAR_B_CON_RES,                   1, "none",    "node"},
+  {"frac_to_CR",                               BMI_VAR_FRAC_TO_CR,                  1, "none",    "node"},
+  {"a_con_res_slow",                           BMI_VAR_A_CON_RES_SLOW,              1, "none",    "node"},
+  {"a_slow",                                   BMI_VAR_A_CON_RES_SLOW,              1, "none",    "node"},
+  {"b_con_res_slow",                           BMI_VAR_B_CON_RES_SLOW,              1, "none",    "node"},
+  {"b_slow",                                   BMI_VAR_B_CON_RES_SLOW,              1, "none",    "node"},
+  {"frac_slow",                                BMI_VAR_FRAC_SLOW,                   1, "none",    "node"},
+  {"interflow_psi_threshold",                  BMI_VAR_INTERFLOW_PSI_THRESHOLD,     1, "none",    "node"},
+  {"lateral_flow_psi_threshold",               BMI_VAR_INTERFLOW_PSI_THRESHOLD,     1, "none",    "node"},
+  {"interflow_factor",                         BMI_VAR_INTERFLOW_FACTOR,            1, "none",    "node"},
+  {"lateral_flow_factor",                      BMI_VAR_INTERFLOW_FACTOR,            1, "none",    "node"},
+  {"spf_factor",                               BMI_VAR_SPF_FACTOR,                  1, "none",    "node"},
+  {"flux_caching_precip_threshold",            BMI_VAR_FC_PRECIP_THRESHOLD,         1, "mm h^-1", "node"},
+  {"flux_caching_AET_PET_ratio_threshold",     BMI_VAR_FC_AET_PET_RATIO_THRESHOLD,  1, "none",    "node"},
+  {"flux_caching_ponded_depth_threshold",      BMI_VAR_FC_PONDED_DEPTH_THRESHOLD,   1, "cm",      "node"},
+  {"flux_caching_bottom_flux_threshold",       BMI_VAR_FC_BOTTOM_FLUX_THRESHOLD,    1, "cm",      "node"},
+  {"flux_caching_dzdt_threshold",              BMI_VAR_FC_DZDT_THRESHOLD,           1, "cm h^-1", "node"},
+  {"flux_caching_horizon",                     BMI_VAR_FC_HORIZON,                  0, "none",    "node"},
+  {"serialization_create",                     BMI_VAR_SERIALIZATION_CREATE,        0, "none",    "none"},
+  {"serialization_size",                       BMI_VAR_SERIALIZATION_SIZE,          0, "none",    "none"},
+  {"serialization_state",                      BMI_VAR_SERIALIZATION_STATE,         5, "none",    "none"},
+  {"serialization_free",                       BMI_VAR_SERIALIZATION_FREE,          0, "none",    "none"},
+};
+
+static const int bmi_var_count = sizeof(bmi_var_table) / sizeof(bmi_var_table[0]);
+
+
 /**
  * @brief Delete dynamic arrays allocated in Initialize() and held by this object
  * 
@@ -82,6 +152,9 @@ BmiLGAR::~BmiLGAR(){
 void BmiLGAR::
 Initialize (std::string config_file)
 {
+  // the verbosity of this instance is read from the config file, until then it is 'none'
+  verbosity_scope scope(VERBOSITY_NONE);
+
   if (config_file.compare("") != 0 ) {
     this->state = new model_state;
     state->head = NULL;
@@ -102,6 +175,7 @@ Initialize (std::string config_file)
     state->lgar_bmi_input_params = NULL;
 
     lgar_initialize(config_file, state);
+
   }
 
   num_giuh_ordinates = state->lgar_bmi_params.num_giuh_ordinates;
@@ -122,17 +196,15 @@ Initialize (std::string config_file)
 
 }
 
-/**
- * @brief Allocate (or reallocate) storage for soil parameters
- * 
- */
-void BmiLGAR::realloc_soil(){
-  
-  delete [] state->lgar_bmi_params.soil_depth_wetting_fronts;
-  delete [] state->lgar_bmi_params.soil_moisture_wetting_fronts;
-
-  state->lgar_bmi_params.soil_depth_wetting_fronts = new double[state->lgar_bmi_params.num_wetting_fronts];
-  state->lgar_bmi_params.soil_moisture_wetting_fronts = new double[state->lgar_bmi_params.num_wetting_fronts];
+/*
+  Advances the model by one forcing timestep and updates the BMI output variables
+*/
+void BmiLGAR::
+Update()
+{
+  verbosity_scope scope(state->verbosity);
+  advance_timestep();
+  update_outputs();
 }
 
 /*
@@ -141,9 +213,16 @@ void BmiLGAR::realloc_soil(){
   If the model's timestep is smaller than the forcing's timestep then we take subtimesteps inside the subcycling loop
 */
 void BmiLGAR::
-Update()
+advance_timestep()
 {
-  if (verbosity.compare("none") != 0) {
+  // take the forcing of this timestep from the forcing series, if one was supplied and is not used up
+  if (forcing_series.next_step < forcing_series.num_steps) {
+    state->lgar_bmi_input_params->precipitation_mm_per_h = forcing_series.precipitation_mm_per_h[forcing_series.next_step * forcing_series.precipitation_stride];
+    state->lgar_bmi_input_params->PET_mm_per_h = forcing_series.PET_mm_per_h[forcing_series.next_step * forcing_series.PET_stride];
+    forcing_series.next_step ++;
+  }
+
+  if (LGAR_LOG_LOW) {
     std::cerr<<"---------------------------------------------------------\n";
     std::cerr<<"|****************** LASAM BMI Update... ******************|\n";
     std::cerr<<"---------------------------------------------------------\n";
@@ -191,7 +270,7 @@ Update()
   
   // if lasam is coupled to soil freeze-thaw, frozen fraction module is called
   if (state->lgar_bmi_params.sft_coupled)
-    frozen_factor_hydraulic_conductivity(state->lgar_bmi_params);
+    frozen_factor_hydraulic_conductivity(state->lgar_bmi_params, state->soil_properties, &state->derived);
 
   double volchange_calib_cm = 0.0;
 
@@ -240,8 +319,6 @@ Update()
   
   double subtimestep_h = state->lgar_bmi_params.timestep_h;
   int nint = state->lgar_bmi_params.nint;
-  double wilting_point_psi_cm = state->lgar_bmi_params.wilting_point_psi_cm;
-  double field_capacity_psi_cm = state->lgar_bmi_params.field_capacity_psi_cm;
   double a_con_res = state->lgar_bmi_params.a_con_res;
   double b_con_res = state->lgar_bmi_params.b_con_res;
   double frac_to_CR = state->lgar_bmi_params.frac_to_CR;
@@ -253,6 +330,7 @@ Update()
   double spf_factor = state->lgar_bmi_params.spf_factor;
   bool use_closed_form_G = state->lgar_bmi_params.use_closed_form_G; 
   bool adaptive_timestep = state->lgar_bmi_params.adaptive_timestep;
+  bool error_control = adaptive_timestep && state->lgar_bmi_params.adaptive_error_control && !state->lgar_bmi_params.is_invalid_soil_type;
   bool PET_affects_precip = state->lgar_bmi_params.PET_affects_precip;
   double mbal_tol = state->lgar_bmi_params.mbal_tol;
 
@@ -262,7 +340,7 @@ Update()
 
   double ponded_depth_max_cm = state->lgar_bmi_params.ponded_depth_max_cm;
 
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     std::cerr<<"Pr  [cm/h] (timestep) = "<<state->lgar_bmi_input_params->precipitation_mm_per_h * mm_to_cm <<"\n";
     std::cerr<<"PET [cm/h] (timestep) = "<<state->lgar_bmi_input_params->PET_mm_per_h * mm_to_cm <<"\n"; 
   }
@@ -271,7 +349,18 @@ Update()
   assert(state->lgar_bmi_input_params->PET_mm_per_h >=0.0);
 
   // adaptive time step is set 
-  if (adaptive_timestep && !state->lgar_bmi_params.is_invalid_soil_type) { //when there is an invalid soil type Q is equal to precip so no substepping is needed
+  if (error_control) {
+    // error-controlled adaptive time step: start from the size proposed at the end of the last forcing step, but restart
+    // from the minimum timestep when the precipitation rate increases, as the error estimate can't see a new surficial front coming
+    struct substep_controller *control = &state->substep_control;
+    subtimestep_h = control->next_timestep_h > 0.0 ? control->next_timestep_h : state->lgar_bmi_params.minimum_timestep_h;
+    if (state->lgar_bmi_input_params->precipitation_mm_per_h > control->previous_precip_mm_per_h)
+      subtimestep_h = state->lgar_bmi_params.minimum_timestep_h;
+    control->previous_precip_mm_per_h = state->lgar_bmi_input_params->precipitation_mm_per_h;
+    subtimestep_h = fmin(subtimestep_h, state->lgar_bmi_params.maximum_timestep_h);
+    state->lgar_bmi_params.timestep_h = subtimestep_h;
+  }
+  else if (adaptive_timestep && !state->lgar_bmi_params.is_invalid_soil_type) { //when there is an invalid soil type Q is equal to precip so no substepping is needed
     subtimestep_h = state->lgar_bmi_params.forcing_resolution_h;
     if (state->lgar_bmi_input_params->precipitation_mm_per_h > 10.0 || volon_timestep_cm > 0.0 ) {
       subtimestep_h = state->lgar_bmi_params.minimum_timestep_h;  //case where precip > 1 cm/h, or there is ponded head from the last time step
@@ -293,7 +382,46 @@ Update()
     wf_free_drain_dzdt = wf_free_drainage_for_cache->dzdt_cm_per_h;
   }
 
-  if (state->lgar_bmi_params.allow_flux_caching){
+  struct flux_caching_policy *policy = &state->flux_caching;
+  bool fast_forward = false;
+  bool fast_forward_at_start = state->lgar_mass_balance.fast_forward;
+
+  if (state->lgar_bmi_params.allow_flux_caching && state->lgar_bmi_params.flux_caching_fast_forward){
+    //Fast-forward generalizes the caching below. A dry forcing step is taken as a single substep of the forcing resolution, whatever the (minimum) timestep.
+    //AET and free drainage are taken out of the wetting fronts as usual, so the mass balance closes at every step, but the wetting fronts keep
+    //the speeds computed on entering the dry period; these are recomputed every policy->horizon steps or when the number of wetting fronts changes.
+    fast_forward = (state->lgar_bmi_input_params->precipitation_mm_per_h < policy->precip_threshold_mm_per_h)
+      && ( (state->lgar_mass_balance.previous_AET / (state->lgar_mass_balance.previous_PET + PET_EPSILON )) < policy->AET_PET_ratio_threshold)
+      && (volon_timestep_cm < policy->ponded_depth_threshold_cm) && (state->lgar_mass_balance.previous_recharge < policy->bottom_flux_threshold_cm)
+      && (wf_free_drain_dzdt <= policy->dzdt_threshold_cm_per_h) && !state->lgar_bmi_params.is_invalid_soil_type;
+
+    if (state->lgar_bmi_params.interflow_enabled
+        && any_wetting_front_can_interflow(state->head, state->lgar_bmi_params.interflow_psi_threshold_cm)) {
+      fast_forward = false;
+    }
+
+    if (fast_forward) {
+      // cache_count counts the steps since the wetting front speeds were computed
+      if (fast_forward_at_start && state->lgar_bmi_params.cache_count < policy->horizon)
+        state->lgar_bmi_params.cache_count ++;
+      else
+        state->lgar_bmi_params.cache_count = 1;
+
+      subtimestep_h = state->lgar_bmi_params.forcing_resolution_h;
+      state->lgar_bmi_params.timestep_h = subtimestep_h;
+    }
+    else if (!adaptive_timestep) {
+      // back to the fixed timestep after a fast-forwarded step
+      subtimestep_h = state->lgar_bmi_params.minimum_timestep_h;
+      state->lgar_bmi_params.timestep_h = subtimestep_h;
+    }
+
+    state->lgar_mass_balance.fast_forward = fast_forward;
+  }
+  else if (state->lgar_bmi_params.allow_flux_caching && !error_control){
+    //Not used with the error-controlled adaptive timestep: the catch-up after a cache window adds the accumulated PET amount to the PET rate and
+    //moves the wetting fronts cache_count times their speed, which both assume a single catch-up substep of the forcing resolution, whereas
+    //the error control may shorten, reject and repeat that substep.
     //The idea here is that, during dry periods, AET will become a small fraction of PET and wetting fronts will be very slow moving. In these cases, it is not necessary to compute fluxes for every time step.
     //To save on runtime, and if allow_flux_caching is set to true in the config file, we simply cache computed fluxes to be used for subsequent time steps rather than recomputing them.
     //The current implementation is to not move the wetting fronts under these conditions, but then move them more rapidly once it is time to calculate fluxes again. Also, during these periods, PET will be 0 but made to be larger to conserve mass when it is time to recalculate fluxes.
@@ -301,17 +429,17 @@ Update()
     //There is very little change to the simulation when this is enabled.
     //Note that for NextGen models, it is ultimately desirable that there is technically output for every hour, so simply relaxing the adaptive time step to be coarser than 1 hour isn't the best solution
     if (subtimestep_h == state->lgar_bmi_params.forcing_resolution_h){
-      if ( (state->lgar_bmi_input_params->precipitation_mm_per_h < PRECIP_THRESHOLD_MM_PER_H) && ( (state->lgar_mass_balance.previous_AET / (state->lgar_mass_balance.previous_PET + PET_EPSILON )) < AET_PET_RATIO_THRESHOLD) && (state->lgar_bmi_params.cache_count!=NUM_TIMESTEPS_BEFORE_RESET_CACHE) && 
-           (volon_timestep_cm<VOLON_TIMESTEP_THRESHOLD_CM) && (state->lgar_mass_balance.previous_recharge<BOTTOM_BDY_FLUX_THRESHOLD_CM) ){
+      if ( (state->lgar_bmi_input_params->precipitation_mm_per_h < policy->precip_threshold_mm_per_h) && ( (state->lgar_mass_balance.previous_AET / (state->lgar_mass_balance.previous_PET + PET_EPSILON )) < policy->AET_PET_ratio_threshold) && (state->lgar_bmi_params.cache_count < policy->horizon) && 
+           (volon_timestep_cm<policy->ponded_depth_threshold_cm) && (state->lgar_mass_balance.previous_recharge<policy->bottom_flux_threshold_cm) ){
         state->lgar_mass_balance.cache_fluxes = TRUE;
       }
-      if ( wf_free_drain_dzdt>THRESHOLD_DZDT_CM_PER_H ){
+      if ( wf_free_drain_dzdt>policy->dzdt_threshold_cm_per_h ){
         state->lgar_mass_balance.cache_fluxes = FALSE;
       }
-      if (volon_timestep_cm>=VOLON_TIMESTEP_THRESHOLD_CM){
+      if (volon_timestep_cm>=policy->ponded_depth_threshold_cm){
         state->lgar_mass_balance.cache_fluxes = FALSE;
       }
-      if ( (state->lgar_bmi_params.cache_count==NUM_TIMESTEPS_BEFORE_RESET_CACHE ) || (state->lgar_bmi_input_params->precipitation_mm_per_h >= PRECIP_THRESHOLD_MM_PER_H) ){
+      if ( (state->lgar_bmi_params.cache_count >= policy->horizon ) || (state->lgar_bmi_input_params->precipitation_mm_per_h >= policy->precip_threshold_mm_per_h) ){
         state->lgar_mass_balance.cache_fluxes = FALSE;
       }
     }
@@ -329,6 +457,24 @@ Update()
     switch_caching = TRUE;//if you switch from cached to not, you need to add the "missing" PET back into the mass balance and AET calculation 
   }
 
+  // a cache window ends when its fluxes are computed again; only a window that lasted the full horizon says something about how long the fluxes stay valid
+  bool horizon_expired = (switch_caching && state->lgar_bmi_params.cache_count >= policy->horizon)
+                         || (fast_forward && fast_forward_at_start && state->lgar_bmi_params.cache_count == 1);
+  double catch_up_factor = switch_caching ? state->lgar_bmi_params.cache_count : 1.0; // lgar_dzdt_calc speeds up the wetting fronts by this factor after caching
+
+  bool cached_step = state->lgar_mass_balance.cache_fluxes || (fast_forward && state->lgar_bmi_params.cache_count > 1);
+
+  if (cached_step) {
+    if (policy->window_steps == 0) {
+      policy->window_storage_cm    = volend_timestep_cm;
+      policy->window_dzdt_cm_per_h = state->head->dzdt_cm_per_h;
+    }
+    policy->window_steps ++;
+    policy->num_cached_steps ++;
+  }
+  else
+    policy->num_computed_steps ++;
+
   if (state->lgar_mass_balance.cache_fluxes){
     state->lgar_bmi_params.cache_count ++;
   }
@@ -336,7 +482,7 @@ Update()
   state->lgar_bmi_params.forcing_interval = int(state->lgar_bmi_params.forcing_resolution_h/state->lgar_bmi_params.timestep_h+1.0e-08); // add 1.0e-08 to prevent truncation error
   subcycles = state->lgar_bmi_params.forcing_interval;
 
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     printf("time step size in hours: %lf \n", state->lgar_bmi_params.timestep_h);
   }
 
@@ -366,13 +512,52 @@ Update()
     }
   }
 
-  if ( (verbosity.compare("high") == 0) && (PET_affects_precip)) {
+  if ( (LGAR_LOG_HIGH) && (PET_affects_precip)) {
     std::cerr<<"Pr  [cm/h] (timestep), after PET is subtracted from precip = "<<state->lgar_bmi_input_params->precipitation_mm_per_h * mm_to_cm <<"\n";
     std::cerr<<"PET [cm/h] (timestep), after PET is subtracted from precip = "<<state->lgar_bmi_input_params->PET_mm_per_h * mm_to_cm <<"\n"; 
   }
   
+  // with the error-controlled adaptive timestep the subcycles don't have a fixed size, the loop runs until the forcing step is covered
+  double forcing_resolution_h = state->lgar_bmi_params.forcing_resolution_h;
+  double minimum_timestep_h = state->lgar_bmi_params.minimum_timestep_h;
+  double time_start_s = this->state->lgar_bmi_params.time_s;
+  double elapsed_h = 0.0;
+  double proposed_subtimestep_h = subtimestep_h;
+
   // subcycling loop (loop over model's timestep)
-  for (int cycle=1; cycle <= subcycles; cycle++) {
+  for (int cycle=1; error_control ? (elapsed_h < forcing_resolution_h) : (cycle <= subcycles); cycle++) {
+
+    // state at the start of the substep, restored if the error-controlled adaptive timestep rejects the substep
+    struct lgar_mass_balance_variables mass_balance_at_start;
+    double time_s_at_start = 0.0, precip_previous_at_start = 0.0, precip_timestep_at_start = 0.0, PET_timestep_at_start = 0.0;
+    double volon_timestep_at_start = 0.0, volQ_CR_timestep_at_start = 0.0, volCRend_timestep_at_start = 0.0;
+    double volend_timestep_at_start = 0.0, volend_subtimestep_at_start = 0.0, volCRend_subtimestep_at_start = 0.0;
+    int timesteps_at_start = 0, cache_count_at_start = 0;
+    bool runoff_in_prev_step_at_start = false;
+
+    if (error_control) {
+      // don't leave a sliver shorter than the minimum timestep at the end of the forcing step, split the rest in two instead
+      double remaining_h = forcing_resolution_h - elapsed_h;
+      subtimestep_h = fmin(proposed_subtimestep_h, remaining_h);
+      if (remaining_h - subtimestep_h > 0.0 && remaining_h - subtimestep_h < minimum_timestep_h)
+        subtimestep_h = 0.5 * remaining_h;
+
+      storeFromList(state->head, &state->substep_control.fronts);
+      mass_balance_at_start         = state->lgar_mass_balance;
+      time_s_at_start               = state->lgar_bmi_params.time_s;
+      timesteps_at_start            = state->lgar_bmi_params.timesteps;
+      cache_count_at_start          = state->lgar_bmi_params.cache_count;
+      runoff_in_prev_step_at_start  = state->lgar_bmi_params.runoff_in_prev_step;
+      precip_previous_at_start      = state->lgar_bmi_params.precip_previous_timestep_cm;
+      precip_timestep_at_start      = precip_timestep_cm;
+      PET_timestep_at_start         = PET_timestep_cm;
+      volon_timestep_at_start       = volon_timestep_cm;
+      volQ_CR_timestep_at_start     = volQ_CR_timestep_cm;
+      volCRend_timestep_at_start    = volCRend_timestep_cm;
+      volend_timestep_at_start      = volend_timestep_cm;
+      volend_subtimestep_at_start   = volend_subtimestep_cm;
+      volCRend_subtimestep_at_start = volCRend_subtimestep_cm;
+    }
 
     bool top_near_sat = false;
     this->state->lgar_bmi_params.time_s    += subtimestep_h * state->units.hr_to_sec;
@@ -381,16 +566,12 @@ Update()
     double precip_for_CR_subtimestep_cm_per_h = 0.0;
     precip_subtimestep_cm_per_h = state->lgar_bmi_input_params->precipitation_mm_per_h * mm_to_cm; // rate [cm/hour]
     
-    if (verbosity.compare("high") == 0 || verbosity.compare("low") == 0) {
+    if (LGAR_LOG_LOW) {
       std::cerr<<"BMI Update |---------------------------------------------------------------|\n";
       std::cerr<<"BMI Update |Timesteps = "<< state->lgar_bmi_params.timesteps<<", Time [h] = "<<this->state->lgar_bmi_params.time_s / 3600.<<", Subcycle = "<< cycle <<" of "<<subcycles<<std::endl;
     }
 
-    if( state->state_previous != NULL ){
-      listDelete(state->state_previous);
-      state->state_previous = NULL;
-    }
-    state->state_previous = listCopy(state->head);
+    state->state_previous = snapshotTake(state->head, &state->state_snapshot);
 
     double ponded_flux_for_CR = 0.0;
     double volon_start_subtimestep_cm = volon_timestep_cm;
@@ -435,17 +616,13 @@ Update()
     PET_subtimestep_cm = PET_subtimestep_cm_per_h * subtimestep_h;      // potential ET for this subtimestep [cm]
 
     volstart_subtimestep_cm = lgar_calc_mass_bal(state->lgar_bmi_params.cum_layer_thickness_cm, state->head);
+    int num_fronts_at_start = listLength(state->head);
 
     if (!state->lgar_mass_balance.cache_fluxes){
 
       //this code makes sure that AET or free drainage will not be extracted in a way that would result in an impossible storage
-      double min_storage = 0.0;
+      double min_storage = state->derived.min_storage_cm;
       double mass_used_to_check_impossible_storages = lgar_calc_mass_bal(state->lgar_bmi_params.cum_layer_thickness_cm, state->head);
-      for (int k = 1; k < num_layers+1; k++) {
-        int layer_num_min_check = k;
-        int soil_num_min_check = state->lgar_bmi_params.layer_soil_type[layer_num_min_check];
-        min_storage += state->soil_properties[soil_num_min_check].theta_r * (state->lgar_bmi_params.cum_layer_thickness_cm[k]-state->lgar_bmi_params.cum_layer_thickness_cm[k-1]);
-      }
 
       int wf_free_drainage_demand = wetting_front_free_drainage(state->head);
 
@@ -481,12 +658,12 @@ Update()
         }
       }
 
-      if ((state->lgar_bmi_params.free_drainage_enabled) && verbosity.compare("high") == 0){
+      if ((state->lgar_bmi_params.free_drainage_enabled) && LGAR_LOG_HIGH){
         printf("free_drainage_subtimestep_cm: %.10lf \n", free_drainage_subtimestep_cm);
       }
 
       //using cerr instead of cout due to some cout buffering issues when running in the ngen framework, cerr doesn't buffer so it prints immediately to the sreeen.
-      if (verbosity.compare("high") == 0 || verbosity.compare("low") == 0) {
+      if (LGAR_LOG_LOW) {
 
         std::cerr<<"Pr [cm/h], Pr [cm] (subtimestep), subtimestep [h] = "<<state->lgar_bmi_input_params->precipitation_mm_per_h * mm_to_cm <<", "<< precip_subtimestep_cm <<", "<< subtimestep_h<<" ("<<subtimestep_h*3600<<" sec)"<<"\n";
         std::cerr<<"PET [cm/h], PET [cm] (subtimestep) = "<<state->lgar_bmi_input_params->PET_mm_per_h * mm_to_cm <<", "<< PET_subtimestep_cm<<"\n";
@@ -500,9 +677,8 @@ Update()
 
       // Calculate AET from PET if PET is non-zero
       if (PET_subtimestep_cm_per_h > 0.0) {
-        AET_subtimestep_cm = calc_aet(PET_subtimestep_cm_per_h, subtimestep_h, wilting_point_psi_cm, field_capacity_psi_cm,
-                                      state->lgar_bmi_params.layer_soil_type, AET_thresh_Theta, AET_expon,
-                                      state->head, state->soil_properties);
+        AET_subtimestep_cm = calc_aet(PET_subtimestep_cm_per_h, subtimestep_h, AET_thresh_Theta, AET_expon,
+                                      state->head, &state->derived);
       }
 
       int iter_mass_check_AET = 0;
@@ -555,7 +731,7 @@ Update()
       if (is_top_wf_saturated || volon_timestep_cm > 0.0)
         create_surficial_front = false;
 
-      if (verbosity.compare("high") == 0 || verbosity.compare("low") == 0) {
+      if (LGAR_LOG_LOW) {
         std::string flag        = (create_surficial_front && !is_top_wf_saturated) == true ? "Yes" : "No";
         std::string flag_top_wf = is_top_wf_saturated == true ? "Yes" : "No";
         std::cerr<<"Is top wetting front saturated? "<< flag_top_wf  << "\n";
@@ -575,7 +751,7 @@ Update()
               interflow_psi_threshold_cm, interflow_factor, &temp_pd, wf_free_drainage_demand, volend_subtimestep_cm, mass_correction_for_cached_free_drainage_fluxes,
               num_layers, &AET_subtimestep_cm, state->lgar_bmi_params.cum_layer_thickness_cm,
               state->lgar_bmi_params.layer_soil_type, state->lgar_bmi_params.frozen_factor,
-              &state->head, state->state_previous, state->soil_properties);
+              &state->head, &state->front_pool, state->state_previous, state->soil_properties);
 
         // if (temp_pd != 0.0){ //if temp_pd != 0.0, that means that some water left the model through the lower model bdy. For LGARTO preparation, this has been refactored such that temp_rch handles this now.
         //   // volrech_subtimestep_cm = temp_pd;
@@ -584,33 +760,29 @@ Update()
         // }
         
         // depth of the surficial front to be created
-        dry_depth = lgar_calc_dry_depth(use_closed_form_G, nint, subtimestep_h, &delta_theta, state->lgar_bmi_params.layer_soil_type,
-                state->lgar_bmi_params.cum_layer_thickness_cm, state->lgar_bmi_params.frozen_factor,
+        dry_depth = lgar_calc_dry_depth(use_closed_form_G, nint, &state->Geff_quadrature, subtimestep_h, &delta_theta, state->lgar_bmi_params.layer_soil_type,
+                state->lgar_bmi_params.cum_layer_thickness_cm, &state->derived,
                 state->head, state->soil_properties);
 
-        if (verbosity.compare("high") == 0) {
+        if (LGAR_LOG_HIGH) {
           printf("State before moving creating new WF...\n");
           listPrint(state->head);
         }
         
         lgar_create_surficial_front(num_layers, &ponded_depth_subtimestep_cm, &volin_subtimestep_cm, dry_depth, state->head->theta,
             state->lgar_bmi_params.layer_soil_type, state->lgar_bmi_params.cum_layer_thickness_cm,
-            state->lgar_bmi_params.frozen_factor, &state->head, state->soil_properties);
+            state->lgar_bmi_params.frozen_factor, &state->head, &state->front_pool, state->soil_properties);
 
-        if (verbosity.compare("high") == 0) {
+        if (LGAR_LOG_HIGH) {
           printf("State after moving creating new WF...\n");
           listPrint(state->head);
         }
 
-        if(state->state_previous != NULL ){
-          listDelete(state->state_previous);
-          state->state_previous = NULL;
-        }
-        state->state_previous = listCopy(state->head);
+        state->state_previous = snapshotTake(state->head, &state->state_snapshot);
 
         // volin_timestep_cm += volin_subtimestep_cm;
 
-        if (verbosity.compare("high") == 0) {
+        if (LGAR_LOG_HIGH) {
     std::cerr<<"New wetting front created...\n";
     listPrint(state->head);
         }
@@ -621,12 +793,12 @@ Update()
         is created and that there is water on the surface (or raining). */
 
       if (ponded_depth_subtimestep_cm > 0 && !create_surficial_front) {
-        volrunoff_subtimestep_cm = lgar_insert_water(use_closed_form_G, nint, subtimestep_h, AET_subtimestep_cm, free_drainage_subtimestep_cm, &ponded_depth_subtimestep_cm,
+        volrunoff_subtimestep_cm = lgar_insert_water(use_closed_form_G, nint, &state->Geff_quadrature, subtimestep_h, AET_subtimestep_cm, free_drainage_subtimestep_cm, &ponded_depth_subtimestep_cm,
                 &volin_subtimestep_cm, precip_subtimestep_cm_per_h,
                 wf_free_drainage_demand, num_layers,
                 ponded_depth_max_cm, state->lgar_bmi_params.layer_soil_type,
                 state->lgar_bmi_params.cum_layer_thickness_cm,
-                state->lgar_bmi_params.frozen_factor, state->head,
+                &state->derived, state->head,
                 state->soil_properties); 
         // volin_timestep_cm += volin_subtimestep_cm;
         // volrunoff_timestep_cm += volrunoff_subtimestep_cm;
@@ -665,7 +837,7 @@ Update()
               interflow_psi_threshold_cm, interflow_factor, &volin_subtimestep_cm, wf_free_drainage_demand, volend_subtimestep_cm, mass_correction_for_cached_free_drainage_fluxes,
               num_layers, &AET_subtimestep_cm, state->lgar_bmi_params.cum_layer_thickness_cm,
               state->lgar_bmi_params.layer_soil_type, state->lgar_bmi_params.frozen_factor,
-              &state->head, state->state_previous, state->soil_properties);
+              &state->head, &state->front_pool, state->state_previous, state->soil_properties);
 
         // this is the volume of water leaving through the bottom
         volrech_subtimestep_cm = volin_subtimestep_cm;
@@ -674,7 +846,7 @@ Update()
         volin_subtimestep_cm = volin_subtimestep_cm_temp;
       }
 
-      lgar_clean_redundant_fronts(&state->head, state->lgar_bmi_params.layer_soil_type, state->soil_properties); //deletes WFs that are very close in capillary head value
+      lgar_clean_redundant_fronts(&state->head, &state->front_pool, state->lgar_bmi_params.layer_soil_type, state->soil_properties); //deletes WFs that are very close in capillary head value
 
       /*----------------------------------------------------------------------*/
       // calculate derivative (dz/dt) for all wetting fronts
@@ -684,9 +856,14 @@ Update()
           new_front = state->head->front_num;
         }
       }
-      lgar_dzdt_calc(use_closed_form_G, nint, num_layers, ponded_depth_subtimestep_cm, subtimestep_h, state->lgar_bmi_params.layer_soil_type,
-        state->lgar_bmi_params.cum_layer_thickness_cm, state->lgar_bmi_params.frozen_factor,
-        state->head, state->soil_properties, switch_caching, state->lgar_bmi_params.cache_count, new_front);
+      // when fast-forwarding a dry period, the wetting fronts keep their cached speeds unless the speeds are due to be refreshed or fronts were created or removed
+      bool refresh_dzdt = !fast_forward || (state->lgar_bmi_params.cache_count == 1) || (listLength(state->head) != num_fronts_at_start);
+
+      if (refresh_dzdt) {
+        lgar_dzdt_calc(use_closed_form_G, nint, &state->Geff_quadrature, ponded_depth_subtimestep_cm, subtimestep_h, state->lgar_bmi_params.layer_soil_type,
+          state->lgar_bmi_params.cum_layer_thickness_cm, &state->derived,
+          state->head, state->soil_properties, switch_caching, state->lgar_bmi_params.cache_count, new_front);
+      }
 
       if (switch_caching){
         state->lgar_bmi_params.cache_count = 1;
@@ -747,6 +924,48 @@ Update()
                       - AET_subtimestep_cm - volon_subtimestep_cm - volrech_subtimestep_cm - interflow_subtimestep_cm - volend_subtimestep_cm;
 
 
+    /*----------------------------------------------------------------------*/
+    // error-controlled adaptive time step: accept the substep, or restore the state at its start and retry with a smaller one
+    if (error_control) {
+      struct substep_controller *control = &state->substep_control;
+      double error = lgar_substep_error(&control->fronts, state->head, subtimestep_h, local_mb,
+                                        state->lgar_bmi_params.adaptive_front_tol_cm, state->lgar_bmi_params.adaptive_mbal_tol_cm);
+      if (isnan(error))
+        error = INFINITY;
+
+      proposed_subtimestep_h = lgar_substep_next_size(subtimestep_h, error, minimum_timestep_h, state->lgar_bmi_params.maximum_timestep_h);
+
+      if (error > 1.0 && subtimestep_h > minimum_timestep_h) {
+        storeToList(&control->fronts, &state->head, &state->front_pool);
+        state->lgar_mass_balance                       = mass_balance_at_start;
+        state->lgar_bmi_params.time_s                  = time_s_at_start;
+        state->lgar_bmi_params.timesteps               = timesteps_at_start;
+        state->lgar_bmi_params.cache_count             = cache_count_at_start;
+        state->lgar_bmi_params.runoff_in_prev_step     = runoff_in_prev_step_at_start;
+        state->lgar_bmi_params.precip_previous_timestep_cm = precip_previous_at_start;
+        precip_timestep_cm      = precip_timestep_at_start;
+        PET_timestep_cm         = PET_timestep_at_start;
+        volon_timestep_cm       = volon_timestep_at_start;
+        volQ_CR_timestep_cm     = volQ_CR_timestep_at_start;
+        volCRend_timestep_cm    = volCRend_timestep_at_start;
+        volend_timestep_cm      = volend_timestep_at_start;
+        volend_subtimestep_cm   = volend_subtimestep_at_start;
+        volCRend_subtimestep_cm = volCRend_subtimestep_at_start;
+
+        if (LGAR_LOG_LOW)
+          std::cerr<<"Substep of "<<subtimestep_h*3600<<" sec rejected (error = "<<error<<"), retrying with "<<proposed_subtimestep_h*3600<<" sec\n";
+
+        control->num_rejected ++;
+        cycle --;
+        continue;
+      }
+
+      control->num_accepted ++;
+      elapsed_h += subtimestep_h;
+      if (forcing_resolution_h - elapsed_h < 1.0e-10)
+        elapsed_h = forcing_resolution_h;
+    }
+
     /*----------------------------------------------------------------------*/
 
     ///////
@@ -761,7 +980,7 @@ Update()
     volon_timestep_cm = volon_subtimestep_cm; // surface ponded water at the end of the timestep 
     ///////
     
-    if (verbosity.compare("high") == 0 || verbosity.compare("low") == 0) {
+    if (LGAR_LOG_LOW) {
       printf("Printing wetting fronts at this subtimestep... \n");
       listPrint(state->head);
     }
@@ -771,7 +990,7 @@ Update()
       unexpected_local_error = true;
     }
     
-    if (verbosity.compare("high") == 0 || verbosity.compare("low") == 0 || unexpected_local_error) {
+    if (LGAR_LOG_LOW || unexpected_local_error) {
       if (!state->lgar_bmi_params.frac_to_CR){
         printf("\nLocal mass balance at this timestep... \n\
         Error         = %14.10f \n\
@@ -830,6 +1049,17 @@ Update()
 
   } // end of subcycling
 
+  if (error_control) {
+    this->state->lgar_bmi_params.time_s = time_start_s + elapsed_h * state->units.hr_to_sec;
+    state->substep_control.next_timestep_h = proposed_subtimestep_h;
+  }
+
+  if (!cached_step && policy->window_steps > 0) {
+    if (policy->adaptive_horizon && horizon_expired)
+      lgar_adapt_flux_caching_horizon(policy, volend_timestep_cm, state->head->dzdt_cm_per_h / catch_up_factor);
+    policy->window_steps = 0;
+  }
+
   //update giuh at the time step level (was previously updated at the sub time step level)
   volrunoff_giuh_timestep_cm = giuh_convolution_integral(volrunoff_timestep_cm + volQ_CR_timestep_cm + volinterflow_timestep_cm, num_giuh_ordinates, giuh_ordinates, giuh_runoff_queue);
 
@@ -840,34 +1070,6 @@ Update()
   /*----------------------------------------------------------------------*/
   // Everything related to lgar state is done at this point, now time to update some dynamic variables
 
-  // update number of wetting fronts
-  state->lgar_bmi_params.num_wetting_fronts = listLength(state->head);
-
-  // allocate new memory based on updated wetting fronts; we could make it conditional i.e. create only if no. of wf are changed
-  realloc_soil();
-
-  // update thickness/depth and soil moisture of wetting fronts (used for state coupling)
-  struct wetting_front *current = state->head;
-  int to_bottom_count = 0;
-  for (int i=0; i<state->lgar_bmi_params.num_wetting_fronts; i++) {
-    if (current->to_bottom){
-      to_bottom_count ++;
-    }
-    if (to_bottom_count>num_layers){
-      std::cerr << "Error: too many to_bottom WFs! This should be equal to the number of layers.\n";
-      listPrint(state->head);
-	    abort();
-    }
-    assert (current != NULL);
-    state->lgar_bmi_params.soil_moisture_wetting_fronts[i] = current->theta;
-    state->lgar_bmi_params.soil_depth_wetting_fronts[i] = current->depth_cm * state->units.cm_to_m;
-    current = current->next;
-    if (verbosity.compare("high") == 0)
-      std::cerr<<"Wetting fronts (bmi outputs) (depth in meters, theta)= "
-	       <<state->lgar_bmi_params.soil_depth_wetting_fronts[i]
-	       <<" "<<state->lgar_bmi_params.soil_moisture_wetting_fronts[i]<<"\n";
-  }
-  
   // add to mass balance timestep variables
   state->lgar_mass_balance.volprecip_timestep_cm  = precip_timestep_cm;
   state->lgar_mass_balance.volin_timestep_cm      = volin_timestep_cm;
@@ -923,11 +1125,141 @@ Update()
 }
 
 
+/*
+  Advances the model by whole forcing timesteps until the model time reaches t, with the current forcing or the forcing
+  series supplied with SetForcingSeries. The output fluxes (precipitation, AET, runoff, ...) are accumulated over the
+  timesteps, the output states (storage, wetting fronts, ...) are those at the end. When running standalone, the model
+  is not advanced beyond the endtime.
+*/
 void BmiLGAR::
 UpdateUntil(double t)
 {
-  assert (t > 0.0);
-  this->Update();
+  verbosity_scope scope(state->verbosity);
+  double timestep_s = GetTimeStep();
+  struct bmi_unit_conversion span = {};
+  int num_steps = 0;
+
+#ifndef NGEN
+  t = fmin(t, this->state->lgar_bmi_params.endtime_s);
+#endif
+
+  while (this->state->lgar_bmi_params.time_s < t - 1.E-6 * timestep_s) {
+    advance_timestep();
+
+    span.volprecip_timestep_m      += bmi_unit_conv.volprecip_timestep_m;
+    span.volin_timestep_m          += bmi_unit_conv.volin_timestep_m;
+    span.volAET_timestep_m         += bmi_unit_conv.volAET_timestep_m;
+    span.volrech_timestep_m        += bmi_unit_conv.volrech_timestep_m;
+    span.volrunoff_timestep_m      += bmi_unit_conv.volrunoff_timestep_m;
+    span.volrunoff_giuh_timestep_m += bmi_unit_conv.volrunoff_giuh_timestep_m;
+    span.volQ_timestep_m           += bmi_unit_conv.volQ_timestep_m;
+    span.volQ_CR_timestep_m        += bmi_unit_conv.volQ_CR_timestep_m;
+    span.volPET_timestep_m         += bmi_unit_conv.volPET_timestep_m;
+    num_steps ++;
+  }
+
+  if (num_steps == 0)
+    return;
+
+  if (num_steps > 1) {
+    bmi_unit_conv.volprecip_timestep_m      = span.volprecip_timestep_m;
+    bmi_unit_conv.volin_timestep_m          = span.volin_timestep_m;
+    bmi_unit_conv.volAET_timestep_m         = span.volAET_timestep_m;
+    bmi_unit_conv.volrech_timestep_m        = span.volrech_timestep_m;
+    bmi_unit_conv.volrunoff_timestep_m      = span.volrunoff_timestep_m;
+    bmi_unit_conv.volrunoff_giuh_timestep_m = span.volrunoff_giuh_timestep_m;
+    bmi_unit_conv.volQ_timestep_m           = span.volQ_timestep_m;
+    bmi_unit_conv.volQ_CR_timestep_m        = span.volQ_CR_timestep_m;
+    bmi_unit_conv.volPET_timestep_m         = span.volPET_timestep_m;
+  }
+
+  update_outputs();
+}
+
+/*
+  Updates the wetting front outputs (used for state coupling) from the wetting fronts
+*/
+void BmiLGAR::
+update_outputs()
+{
+  if (state->lgar_bmi_params.is_invalid_soil_type)
+    return;
+
+  int num_layers = state->lgar_bmi_params.num_layers;
+
+  // update number of wetting fronts (number of valid entries in the wetting front outputs)
+  state->lgar_bmi_params.num_wetting_fronts = listLength(state->head);
+  assert (state->lgar_bmi_params.num_wetting_fronts <= MAX_NUM_WETTING_FRONTS);
+
+  // update thickness/depth and soil moisture of wetting fronts (used for state coupling), in place so that the
+  // pointers held by coupled models stay valid
+  struct wetting_front *current = state->head;
+  int to_bottom_count = 0;
+  for (int i=0; i<state->lgar_bmi_params.num_wetting_fronts; i++) {
+    if (current->to_bottom){
+      to_bottom_count ++;
+    }
+    if (to_bottom_count>num_layers){
+      std::cerr << "Error: too many to_bottom WFs! This should be equal to the number of layers.\n";
+      listPrint(state->head);
+	    abort();
+    }
+    assert (current != NULL);
+    state->lgar_bmi_params.soil_moisture_wetting_fronts[i] = current->theta;
+    state->lgar_bmi_params.soil_depth_wetting_fronts[i] = current->depth_cm * state->units.cm_to_m;
+    current = current->next;
+    if (LGAR_LOG_HIGH)
+      std::cerr<<"Wetting fronts (bmi outputs) (depth in meters, theta)= "
+	       <<state->lgar_bmi_params.soil_depth_wetting_fronts[i]
+	       <<" "<<state->lgar_bmi_params.soil_moisture_wetting_fronts[i]<<"\n";
+  }
+}
+
+/*
+  Supplies the forcing of the next num_steps timesteps in advance. The arrays are owned by the caller and must stay
+  valid until they are used up; Update and UpdateUntil then take one entry per forcing timestep instead of the values
+  set through SetValue. The strides (in number of doubles) allow reading the forcing from interleaved buffers, e.g.
+  the columns of a row-major forcing table.
+*/
+void BmiLGAR::
+SetForcingSeries(const double *precipitation_mm_per_h, const double *PET_mm_per_h, int num_steps,
+		 int precipitation_stride, int PET_stride)
+{
+  assert (num_steps >= 0);
+  assert (num_steps == 0 || (precipitation_mm_per_h != nullptr && PET_mm_per_h != nullptr));
+  assert (precipitation_stride >= 1 && PET_stride >= 1);
+
+  forcing_series.precipitation_mm_per_h = precipitation_mm_per_h;
+  forcing_series.PET_mm_per_h           = PET_mm_per_h;
+  forcing_series.precipitation_stride   = precipitation_stride;
+  forcing_series.PET_stride             = PET_stride;
+  forcing_series.num_steps              = num_steps;
+  forcing_series.next_step              = 0;
+}
+
+/*
+  Same as SetForcingSeries, but the forcing is copied, so the caller's arrays can be released or reused right away.
+*/
+void BmiLGAR::
+CopyForcingSeries(const double *precipitation_mm_per_h, const double *PET_mm_per_h, int num_steps,
+		  int precipitation_stride, int PET_stride)
+{
+  assert (num_steps >= 0);
+  assert (precipitation_stride >= 1 && PET_stride >= 1);
+
+  forcing_series_copy.resize(2 * num_steps);
+  for (int i=0; i<num_steps; i++) {
+    forcing_series_copy[i]             = precipitation_mm_per_h[i * precipitation_stride];
+    forcing_series_copy[num_steps + i] = PET_mm_per_h[i * PET_stride];
+  }
+
+  SetForcingSeries(forcing_series_copy.data(), forcing_series_copy.data() + num_steps, num_steps);
+}
+
+int BmiLGAR::
+GetForcingSeriesRemaining()
+{
+  return forcing_series.num_steps - forcing_series.next_step;
 }
 
 struct model_state* BmiLGAR::get_model()
@@ -938,16 +1270,18 @@ struct model_state* BmiLGAR::get_model()
 void BmiLGAR::
 global_mass_balance()
 {
+  verbosity_scope scope(state->verbosity);
   lgar_global_mass_balance(this->state, giuh_runoff_queue);
 }
 
 double BmiLGAR::
 update_calibratable_parameters()
 {
+  verbosity_scope scope(state->verbosity);
   int soil, layer_num;
   struct wetting_front *current = state->head;
 
-  if (verbosity.compare("high") == 0)
+  if (LGAR_LOG_HIGH)
     listPrint(state->head);
   
   double volstart_before = lgar_calc_mass_bal(state->lgar_bmi_params.cum_layer_thickness_cm, state->head);
@@ -960,7 +1294,7 @@ update_calibratable_parameters()
     
     assert (current != NULL);
 
-    if (verbosity.compare("high") == 0 || verbosity.compare("low") == 0) {
+    if (LGAR_LOG_LOW) {
       std::cerr<<"----------- Calibratable parameters depending on soil layer (initial values) ----------- \n";
       std::cerr<<"| soil_type = "<< soil <<", layer = "<<layer_num
 	       <<", smcmax = "   << state->soil_properties[soil].theta_e
@@ -1017,26 +1351,32 @@ update_calibratable_parameters()
       }
     }
     
-    current->theta = calc_theta_from_h(current->psi_cm, state->soil_properties[soil].vg_alpha_per_cm,
-				       state->soil_properties[soil].vg_m, state->soil_properties[soil].vg_n,
-				       state->soil_properties[soil].theta_e, state->soil_properties[soil].theta_r);
+    lgar_calc_soil_constants(&state->soil_properties[soil]);
 
-    if (verbosity.compare("high") == 0 || verbosity.compare("low") == 0) {
+    if (LGAR_LOG_LOW) {
       std::cerr<<"----------- Calibratable parameters depending on soil layer (updated values) ----------- \n";
       std::cerr<<"| soil_type = "<< soil <<", layer = "<<layer_num
 	       <<", smcmax = "   << state->soil_properties[soil].theta_e
 	       <<", smcmin = "   << state->soil_properties[soil].theta_r
 	       <<", vg_n = "     << state->soil_properties[soil].vg_n
 	       <<", vg_alpha = " << state->soil_properties[soil].vg_alpha_per_cm
-	       <<", Ksat = "     << state->soil_properties[soil].Ksat_cm_per_h
-	       <<", theta = "    << current->theta <<"\n";
+	       <<", Ksat = "     << state->soil_properties[soil].Ksat_cm_per_h <<"\n";
     }
     
     current = current->next;
   }
 
+  // the lookup tables of the calibrated soils are rebuilt with the updated parameters, then the fronts keep their psi
+  // and take the moisture content it has under the new parameters
+  lgar_build_soil_tables(state);
+
+  for (current = state->head; current != NULL; current = current->next) {
+    soil = state->lgar_bmi_params.layer_soil_type[current->layer_num];
+    current->theta = soil_theta_from_h(&state->soil_properties[soil], current->psi_cm);
+  }
+
   //next we update the parameters that apply to the whole model domain and do not depend on soil layer
-  if (verbosity.compare("high") == 0 || verbosity.compare("low") == 0) {
+  if (LGAR_LOG_LOW) {
     std::cerr<<"----------- Calibratable parameters independent of soil layer (initial values) ----------- \n";
     std::cerr<<"field_capacity_psi = "   << state->lgar_bmi_params.field_capacity_psi_cm
       <<", ponded_depth_max = "     << state->lgar_bmi_params.ponded_depth_max_cm
@@ -1086,7 +1426,10 @@ update_calibratable_parameters()
     }
   }
 
-  if (verbosity.compare("high") == 0 || verbosity.compare("low") == 0) {
+  // the per-layer derived constants depend on the soil parameters and the field capacity
+  lgar_update_derived_constants(&state->lgar_bmi_params, state->soil_properties, &state->derived);
+
+  if (LGAR_LOG_LOW) {
     std::cerr<<"----------- Calibratable parameters independent of soil layer (updated values) ----------- \n";
     std::cerr<<"field_capacity_psi = "   << state->lgar_bmi_params.field_capacity_psi_cm
       <<", ponded_depth_max = "     << state->lgar_bmi_params.ponded_depth_max_cm
@@ -1106,12 +1449,12 @@ update_calibratable_parameters()
     }
   }
   
-  if (verbosity.compare("high") == 0)
+  if (LGAR_LOG_HIGH)
     listPrint(state->head);
   
   double volstart_after = lgar_calc_mass_bal(state->lgar_bmi_params.cum_layer_thickness_cm, state->head);
 
-  if (verbosity.compare("high") == 0 || verbosity.compare("low") == 0)
+  if (LGAR_LOG_LOW)
     std::cerr<<"Mass of water (before and after) = "<< volstart_before<<", "<< volstart_after <<"\n";
   
   return volstart_after - volstart_before;
@@ -1120,9 +1463,27 @@ update_calibratable_parameters()
 void BmiLGAR::
 Finalize()
 {
+  verbosity_scope scope(state->verbosity);
   global_mass_balance();
-  listDelete(state->head);
-  listDelete(state->state_previous);
+
+  if (LGAR_LOG_LOW)
+    std::cerr<<"Wetting front pool high water mark = "<< state->front_pool.high_water_mark <<" of "<< MAX_NUM_WETTING_FRONTS <<" nodes \n";
+
+  if ((LGAR_LOG_LOW) && state->Geff_quadrature.num_integrals > 0)
+    std::cerr<<"Numeric Geff integrals = "<< state->Geff_quadrature.num_integrals <<", integrand evaluations = "
+	     << state->Geff_quadrature.num_evals <<"\n";
+
+  if ((LGAR_LOG_LOW) && state->lgar_bmi_params.allow_flux_caching)
+    std::cerr<<"Flux caching: cached timesteps = "<< state->flux_caching.num_cached_steps <<", computed timesteps = "
+	     << state->flux_caching.num_computed_steps <<", horizon = "<< state->flux_caching.horizon <<"\n";
+
+  if ((LGAR_LOG_LOW) && state->lgar_bmi_params.adaptive_error_control)
+    std::cerr<<"Error-controlled substeps accepted = "<< state->substep_control.num_accepted <<", rejected = "
+	     << state->substep_control.num_rejected <<"\n";
+
+  // all wetting fronts live in the per-instance pool, so they are released at once
+  poolReset(&state->front_pool);
+  state->head = NULL;
 
   delete [] state->soil_properties;
 
@@ -1152,46 +1513,8 @@ Finalize()
 int BmiLGAR::
 GetVarGrid(std::string name)
 {
-  if (name.compare("soil_storage_model") == 0 || name.compare("soil_num_wetting_fronts") == 0)   // int
-    return 0;
-  else if (name.compare("precipitation_rate") == 0 || name.compare("precipitation") == 0)
-    return 1;
-  else if (name.compare("potential_evapotranspiration_rate") == 0
-	   || name.compare("potential_evapotranspiration") == 0
-	   || name.compare("actual_evapotranspiration") == 0) // double
-    return 1;
-  else if (name.compare("surface_runoff") == 0 || name.compare("giuh_runoff") == 0 || name.compare("a_con_res") == 0 || name.compare("a") == 0 || name.compare("b_con_res") == 0 || name.compare("b") == 0 || name.compare("frac_to_CR") == 0 || name.compare("spf_factor") == 0
-	   || name.compare("interflow_psi_threshold") == 0 || name.compare("lateral_flow_psi_threshold") == 0 || name.compare("interflow_factor") == 0 || name.compare("lateral_flow_factor") == 0
-	   || name.compare("a_con_res_slow") == 0 || name.compare("a_slow") == 0 || name.compare("b_con_res_slow") == 0 || name.compare("b_slow") == 0 || name.compare("frac_slow") == 0 || name.compare("soil_storage") == 0 || name.compare("field_capacity") == 0 || name.compare("ponded_depth_max") == 0)// double
-    return 1;
-  else if (name.compare("total_discharge") == 0 || name.compare("infiltration") == 0
-	   || name.compare("percolation") == 0  || name.compare("conceptual_reservoir_to_stream_discharge") == 0) // double
-    return 1;
-  else if (name.compare("mass_balance") == 0)
-    return 1;
-  else if (name.compare("smcmax_1") == 0 || name.compare("smcmin_1") == 0 // per layer parameters are now handled with scalars and not arrays
-	   || name.compare("van_genuchten_m_1") == 0 || name.compare("van_genuchten_alpha_1") == 0 || name.compare("van_genuchten_n_1") == 0 
-	   || name.compare("hydraulic_conductivity_1") == 0)
-    return 1;
-  else if (name.compare("smcmax_2") == 0 || name.compare("smcmin_2") == 0 // per layer parameters are now handled with scalars and not arrays
-	   || name.compare("van_genuchten_m_2") == 0 || name.compare("van_genuchten_alpha_2") == 0 || name.compare("van_genuchten_n_2") == 0 
-	   || name.compare("hydraulic_conductivity_2") == 0)
-    return 1;
-  else if (name.compare("smcmax_2") == 0 || name.compare("smcmin_2") == 0 // per layer parameters are now handled with scalars and not arrays
-	   || name.compare("van_genuchten_m_2") == 0 || name.compare("van_genuchten_alpha_2") == 0 || name.compare("van_genuchten_n_2") == 0 
-	   || name.compare("hydraulic_conductivity_2") == 0)
-    return 1;
-  // else if (name.compare("soil_depth_layers") == 0  || name.compare("smcmax") == 0 || name.compare("smcmin") == 0
-	//    || name.compare("van_genuchten_m") == 0 || name.compare("van_genuchten_alpha") == 0 || name.compare("van_genuchten_n") == 0 
-	//    || name.compare("hydraulic_conductivity") == 0) // array of doubles (fixed length)
-  else if (name.compare("soil_depth_layers") == 0 )// array of doubles (fixed length)
-    return 2;
-  else if (name.compare("soil_moisture_wetting_fronts") == 0 || name.compare("soil_depth_wetting_fronts") == 0) // array of doubles (dynamic length)
-    return 3;
-  else if (name.compare("soil_temperature_profile") == 0) // array of doubles (fixed and of the size of soil temperature profile)
-    return 4;
-  else
-    return -1;
+  int handle = GetVarHandle(name);
+  return handle < 0 ? -1 : bmi_var_table[handle].grid;
 }
 
 
@@ -1204,6 +1527,8 @@ GetVarType(std::string name)
     return "int";
   else if (var_grid == 1 || var_grid == 2 || var_grid == 3 || var_grid == 4)
     return "double";
+  else if (var_grid == 5)
+    return "char";
   else
     return "none";
 }
@@ -1218,6 +1543,8 @@ GetVarItemsize(std::string name)
     return sizeof(int);
   else if (var_grid == 1 || var_grid == 2 || var_grid == 3 || var_grid == 4)
     return sizeof(double);
+  else if (var_grid == 5)
+    return sizeof(char);
   else
     return 0;
 }
@@ -1226,68 +1553,23 @@ GetVarItemsize(std::string name)
 std::string BmiLGAR::
 GetVarUnits(std::string name)
 {
-  if (name.compare("precipitation_rate") == 0 || name.compare("potential_evapotranspiration_rate") == 0)
-    return "mm h^-1";
-  else if (name.compare("precipitation") == 0 || name.compare("potential_evapotranspiration") == 0
-	   || name.compare("actual_evapotranspiration") == 0) // double
-    return "m";
-  else if (name.compare("surface_runoff") == 0 || name.compare("giuh_runoff") == 0 
-	   || name.compare("soil_storage") == 0) // double
-    return "m";
-  else if (name.compare("total_discharge") == 0 || name.compare("infiltration") == 0
-	   || name.compare("percolation") == 0) // double
-    return "m";
-  else if (name.compare("mass_balance") == 0 || name.compare("conceptual_reservoir_to_stream_discharge") == 0)
-    return "m";
-  else if (name.compare("soil_moisture_wetting_fronts") == 0) // array of doubles
-    return "none";
-  else if (name.compare("soil_depth_layers") == 0 || name.compare("soil_depth_wetting_fronts") == 0) // array of doubles
-    return "m";
-  else if (name.compare("soil_temperature_profile") == 0)
-    return "K";
-  else
-    return "none";
-
+  int handle = GetVarHandle(name);
+  return handle < 0 ? "none" : bmi_var_table[handle].units;
 }
 
 
 int BmiLGAR::
 GetVarNbytes(std::string name)
 {
-  int itemsize;
-  int gridsize;
-
-  itemsize = this->GetVarItemsize(name);
-  gridsize = this->GetGridSize(this->GetVarGrid(name));
-  return itemsize * gridsize;
+  return GetVarNbytesByHandle(GetVarHandle(name));
 }
 
 
 std::string BmiLGAR::
 GetVarLocation(std::string name)
 {
-  if (name.compare("precipitation_rate") == 0 || name.compare("precipitation") == 0 ||
-      name.compare("potential_evapotranspiration") == 0 || name.compare("potential_evapotranspiration_rate") == 0
-      || name.compare("actual_evapotranspiration") == 0) // double
-    return "node";
-  else if (name.compare("surface_runoff") == 0 || name.compare("giuh_runoff") == 0 || name.compare("a_con_res") == 0 || name.compare("a") == 0 || name.compare("b_con_res") == 0 || name.compare("b") == 0 || name.compare("frac_to_CR") == 0 || name.compare("spf_factor") == 0
-	   || name.compare("interflow_psi_threshold") == 0 || name.compare("lateral_flow_psi_threshold") == 0 || name.compare("interflow_factor") == 0 || name.compare("lateral_flow_factor") == 0
-	   || name.compare("a_con_res_slow") == 0 || name.compare("a_slow") == 0 || name.compare("b_con_res_slow") == 0 || name.compare("b_slow") == 0 || name.compare("frac_slow") == 0 || name.compare("soil_storage") == 0) // double
-    return "node";
-   else if (name.compare("total_discharge") == 0 || name.compare("infiltration") == 0
-	    || name.compare("percolation") == 0 || name.compare("conceptual_reservoir_to_stream_discharge") == 0) // double
-    return "node";
-  else if (name.compare("soil_moisture_wetting_fronts") == 0) // array of doubles
-    return "node";
-  else if (name.compare("mass_balance") == 0)
-    return "node";
-  else if (name.compare("soil_depth_layers") == 0 || name.compare("soil_depth_wetting_fronts") == 0
-	   || name.compare("soil_num_wetting_fronts") == 0) // array of doubles
-    return "node";
-  else if (name.compare("soil_temperature_profile") == 0)
-    return "node";
-  else
-    return "none";
+  int handle = GetVarHandle(name);
+  return handle < 0 ? "none" : bmi_var_table[handle].location;
 }
 
 
@@ -1322,7 +1604,7 @@ GetGridOrigin (const int grid, double *origin)
 int BmiLGAR::
 GetGridRank(const int grid)
 {
-  if (grid == 0 || grid == 1 || grid == 2 || grid == 3 || grid == 4)
+  if (grid == 0 || grid == 1 || grid == 2 || grid == 3 || grid == 4 || grid == 5)
     return 1;
   else
     return -1;
@@ -1340,6 +1622,8 @@ GetGridSize(const int grid)
     return this->state->lgar_bmi_params.num_wetting_fronts;
   else if (grid == 4) // number of cells (discretized temperature profile, input from SFT)
     return this->state->lgar_bmi_params.num_cells_temp;
+  else if (grid == 5) // number of bytes of the serialized state
+    return serialization_size;
   else
     return -1;
 }
@@ -1349,130 +1633,191 @@ GetGridSize(const int grid)
 void BmiLGAR::
 GetValue (std::string name, void *dest)
 {
-  void * src = NULL;
-  int nbytes = 0;
-
-  src = this->GetValuePtr(name);
-  nbytes = this->GetVarNbytes(name);
-  memcpy (dest, src, nbytes);
+  int handle = GetVarHandle(name);
+  void *src = value_ptr(handle, &name);
+  memcpy(dest, src, GetVarNbytesByHandle(handle));
 }
 
 
 void *BmiLGAR::
 GetValuePtr (std::string name)
 {
-  if (name.compare("precipitation_rate") == 0)
-    return (void*)(&this->state->lgar_bmi_input_params->precipitation_mm_per_h);
-  else if (name.compare("precipitation") == 0)
-    return (void*)(&bmi_unit_conv.volprecip_timestep_m);
-  else if (name.compare("potential_evapotranspiration_rate") == 0)
-    return (void*)(&this->state->lgar_bmi_input_params->PET_mm_per_h);
-  else if (name.compare("potential_evapotranspiration") == 0)
-    return (void*)(&bmi_unit_conv.volPET_timestep_m);
-  else if (name.compare("actual_evapotranspiration") == 0)
-    return (void*)(&bmi_unit_conv.volAET_timestep_m);
-  else if (name.compare("surface_runoff") == 0)
-    return (void*)(&bmi_unit_conv.volrunoff_timestep_m);
-  else if (name.compare("giuh_runoff") == 0)
-    return (void*)(&bmi_unit_conv.volrunoff_giuh_timestep_m);
-  else if (name.compare("soil_storage") == 0)
-    return (void*)(&bmi_unit_conv.volend_timestep_m);
-  else if (name.compare("conceptual_reservoir_storage") == 0)
-    return (void*)(&bmi_unit_conv.volCRend_timestep_m);
-  else if (name.compare("total_discharge") == 0)
-    return (void*)(&bmi_unit_conv.volQ_timestep_m);
-  else if (name.compare("infiltration") == 0)
-    return (void*)(&bmi_unit_conv.volin_timestep_m);
-  else if (name.compare("percolation") == 0)
-    return (void*)(&bmi_unit_conv.volrech_timestep_m);
-  else if (name.compare("conceptual_reservoir_to_stream_discharge") == 0)
-    return (void*)(&bmi_unit_conv.volQ_CR_timestep_m);
-  else if (name.compare("mass_balance") == 0)
-    return (void*)(&bmi_unit_conv.mass_balance_m);
-  else if (name.compare("soil_depth_layers") == 0)
-    return (void*)this->state->lgar_bmi_params.cum_layer_thickness_cm;  // this too and, if needed, change soil_moisture_layers to soil_thickness_layers
-  else if (name.compare("soil_moisture_wetting_fronts") == 0)
-    return (void*)this->state->lgar_bmi_params.soil_moisture_wetting_fronts;
-  else if (name.compare("soil_depth_wetting_fronts") == 0)
-    return (void*)this->state->lgar_bmi_params.soil_depth_wetting_fronts;
-  else if (name.compare("soil_num_wetting_fronts") == 0)
-    return (void*)(&state->lgar_bmi_params.num_wetting_fronts);
-  else if (name.compare("soil_temperature_profile") == 0)
-    return (void*)this->state->lgar_bmi_params.soil_temperature;
-  // else if (name.compare("smcmax") == 0)
-  //   return (void*)this->state->lgar_calib_params.theta_e;
-  // else if (name.compare("smcmin") == 0)
-  //   return (void*)this->state->lgar_calib_params.theta_r;
-  // else if (name.compare("van_genuchten_n") == 0)
-  //   return (void*)this->state->lgar_calib_params.vg_n;
-  // else if (name.compare("van_genuchten_alpha") == 0)
-  //   return (void*)this->state->lgar_calib_params.vg_alpha;
-  // else if (name.compare("hydraulic_conductivity") == 0)
-  //   return (void*)this->state->lgar_calib_params.Ksat;
+  return value_ptr(GetVarHandle(name), &name);
+}
 
+
+/*
+  Returns the handle of a variable (its index in the variable table), or -1 if the variable does not exist. Callers
+  that access the same variables every timestep can resolve the names once and use the *ByHandle functions.
+*/
+int BmiLGAR::
+GetVarHandle(std::string name)
+{
+  // built once from the table, the names and handles are the same for all instances
+  static const std::unordered_map<std::string, int> handles = [] {
+    std::unordered_map<std::string, int> map;
+    for (int i=0; i<bmi_var_count; i++)
+      map.emplace(bmi_var_table[i].name, i);
+    return map;
+  }();
+
+  auto it = handles.find(name);
+  return it == handles.end() ? -1 : it->second;
+}
+
+
+int BmiLGAR::
+GetVarNbytesByHandle(int handle)
+{
+  if (handle < 0 || handle >= bmi_var_count)
+    return 0;
+
+  int grid = bmi_var_table[handle].grid;
+  if (grid == 0)
+    return sizeof(int) * GetGridSize(grid);
+  else if (grid == 1 || grid == 2 || grid == 3 || grid == 4)
+    return sizeof(double) * GetGridSize(grid);
+  else if (grid == 5)
+    return sizeof(char) * GetGridSize(grid);
+  else
+    return 0;
+}
+
+
+void BmiLGAR::
+GetValueByHandle(int handle, void *dest)
+{
+  void *src = value_ptr(handle, NULL);
+  memcpy(dest, src, GetVarNbytesByHandle(handle));
+}
+
+
+void BmiLGAR::
+SetValueByHandle(int handle, void *src)
+{
+  if (serialization_request(handle, src))
+    return;
+
+  void *dest = value_ptr(handle, NULL);
+  if (dest)
+    memcpy(dest, src, GetVarNbytesByHandle(handle));
+}
+
+
+void *BmiLGAR::
+GetValuePtrByHandle(int handle)
+{
+  return value_ptr(handle, NULL);
+}
+
+
+/*
+  Handles the BMI serialization variables, which are requests rather than values: setting serialization_create writes
+  the state into a buffer held by the model (read through serialization_size and serialization_state), setting
+  serialization_state restores the state from the given checkpoint and setting serialization_free releases the buffer.
+  Returns false for all other variables.
+*/
+bool BmiLGAR::
+serialization_request(int handle, void *src)
+{
+  int var = (handle < 0 || handle >= bmi_var_count) ? BMI_VAR_NONE : bmi_var_table[handle].var;
+
+  switch (var) {
+  case BMI_VAR_SERIALIZATION_CREATE:
+    SaveState(serialization_buffer);
+    serialization_size = (int)serialization_buffer.size();
+    return true;
+  case BMI_VAR_SERIALIZATION_STATE:
+    RestoreState((const char*)src, 0); // the size is taken from the checkpoint header
+    return true;
+  case BMI_VAR_SERIALIZATION_FREE:
+    std::vector<char>().swap(serialization_buffer);
+    serialization_size = 0;
+    return true;
+  case BMI_VAR_SERIALIZATION_SIZE:
+    throw std::runtime_error("variable serialization_size cannot be set");
+  default:
+    return false;
+  }
+}
+
+
+/*
+  Returns the pointer to the value of the variable with the given handle; throws if the variable has no value, naming
+  the variable by name if it is given and by its handle otherwise
+*/
+void *BmiLGAR::
+value_ptr(int handle, const std::string *name)
+{
+  int var = (handle < 0 || handle >= bmi_var_count) ? BMI_VAR_NONE : bmi_var_table[handle].var;
+
+  switch (var) {
+  case BMI_VAR_PRECIPITATION_RATE:         return (void*)(&this->state->lgar_bmi_input_params->precipitation_mm_per_h);
+  case BMI_VAR_PRECIPITATION:              return (void*)(&bmi_unit_conv.volprecip_timestep_m);
+  case BMI_VAR_PET_RATE:                   return (void*)(&this->state->lgar_bmi_input_params->PET_mm_per_h);
+  case BMI_VAR_PET:                        return (void*)(&bmi_unit_conv.volPET_timestep_m);
+  case BMI_VAR_AET:                        return (void*)(&bmi_unit_conv.volAET_timestep_m);
+  case BMI_VAR_SURFACE_RUNOFF:             return (void*)(&bmi_unit_conv.volrunoff_timestep_m);
+  case BMI_VAR_GIUH_RUNOFF:                return (void*)(&bmi_unit_conv.volrunoff_giuh_timestep_m);
+  case BMI_VAR_SOIL_STORAGE:               return (void*)(&bmi_unit_conv.volend_timestep_m);
+  case BMI_VAR_CR_STORAGE:                 return (void*)(&bmi_unit_conv.volCRend_timestep_m);
+  case BMI_VAR_TOTAL_DISCHARGE:            return (void*)(&bmi_unit_conv.volQ_timestep_m);
+  case BMI_VAR_INFILTRATION:               return (void*)(&bmi_unit_conv.volin_timestep_m);
+  case BMI_VAR_PERCOLATION:                return (void*)(&bmi_unit_conv.volrech_timestep_m);
+  case BMI_VAR_CR_TO_STREAM:               return (void*)(&bmi_unit_conv.volQ_CR_timestep_m);
+  case BMI_VAR_MASS_BALANCE:               return (void*)(&bmi_unit_conv.mass_balance_m);
+  // this too and, if needed, change soil_moisture_layers to soil_thickness_layers
+  case BMI_VAR_SOIL_DEPTH_LAYERS:          return (void*)this->state->lgar_bmi_params.cum_layer_thickness_cm;
+  case BMI_VAR_SOIL_MOISTURE_WF:           return (void*)this->state->lgar_bmi_params.soil_moisture_wetting_fronts;
+  case BMI_VAR_SOIL_DEPTH_WF:              return (void*)this->state->lgar_bmi_params.soil_depth_wetting_fronts;
+  case BMI_VAR_SOIL_NUM_WF:                return (void*)(&state->lgar_bmi_params.num_wetting_fronts);
+  case BMI_VAR_SOIL_TEMPERATURE_PROFILE:   return (void*)this->state->lgar_bmi_params.soil_temperature;
   // per layer calibratable params are now scalars and not arrays
-  else if (name.compare("smcmax_1") == 0)
-    return (void*)&this->state->lgar_calib_params.theta_e_1;
-  else if (name.compare("smcmin_1") == 0)
-    return (void*)&this->state->lgar_calib_params.theta_r_1;
-  else if (name.compare("van_genuchten_n_1") == 0)
-    return (void*)&this->state->lgar_calib_params.vg_n_1;
-  else if (name.compare("van_genuchten_alpha_1") == 0)
-    return (void*)&this->state->lgar_calib_params.vg_alpha_1;
-  else if (name.compare("hydraulic_conductivity_1") == 0)
-    return (void*)&this->state->lgar_calib_params.Ksat_1;
-  else if (name.compare("smcmax_2") == 0)
-    return (void*)&this->state->lgar_calib_params.theta_e_2;
-  else if (name.compare("smcmin_2") == 0)
-    return (void*)&this->state->lgar_calib_params.theta_r_2;
-  else if (name.compare("van_genuchten_n_2") == 0)
-    return (void*)&this->state->lgar_calib_params.vg_n_2;
-  else if (name.compare("van_genuchten_alpha_2") == 0)
-    return (void*)&this->state->lgar_calib_params.vg_alpha_2;
-  else if (name.compare("hydraulic_conductivity_2") == 0)
-    return (void*)&this->state->lgar_calib_params.Ksat_2;
-  else if (name.compare("smcmax_3") == 0)
-    return (void*)&this->state->lgar_calib_params.theta_e_3;
-  else if (name.compare("smcmin_3") == 0)
-    return (void*)&this->state->lgar_calib_params.theta_r_3;
-  else if (name.compare("van_genuchten_n_3") == 0)
-    return (void*)&this->state->lgar_calib_params.vg_n_3;
-  else if (name.compare("van_genuchten_alpha_3") == 0)
-    return (void*)&this->state->lgar_calib_params.vg_alpha_3;
-  else if (name.compare("hydraulic_conductivity_3") == 0)
-    return (void*)&this->state->lgar_calib_params.Ksat_3;
-
-  else if (name.compare("ponded_depth_max") == 0)
-    return (void*)&this->state->lgar_calib_params.ponded_depth_max;
-  else if (name.compare("field_capacity") == 0)
-    return (void*)&this->state->lgar_calib_params.field_capacity_psi;
-  else if (name.compare("a_con_res") == 0 || name.compare("a") == 0)
-    return (void*)&this->state->lgar_calib_params.a_con_res;
-  else if (name.compare("b_con_res") == 0 || name.compare("b") == 0)
-    return (void*)&this->state->lgar_calib_params.b_con_res;
-  else if (name.compare("frac_to_CR") == 0)
-    return (void*)&this->state->lgar_calib_params.frac_to_CR;
-  else if (name.compare("a_con_res_slow") == 0 || name.compare("a_slow") == 0)
-    return (void*)&this->state->lgar_calib_params.a_con_res_slow;
-  else if (name.compare("b_con_res_slow") == 0 || name.compare("b_slow") == 0)
-    return (void*)&this->state->lgar_calib_params.b_con_res_slow;
-  else if (name.compare("frac_slow") == 0)
-    return (void*)&this->state->lgar_calib_params.frac_slow;
-  else if (name.compare("interflow_psi_threshold") == 0 || name.compare("lateral_flow_psi_threshold") == 0)
-    return (void*)&this->state->lgar_calib_params.interflow_psi_threshold_cm;
-  else if (name.compare("interflow_factor") == 0 || name.compare("lateral_flow_factor") == 0)
-    return (void*)&this->state->lgar_calib_params.interflow_factor;
-  else if (name.compare("spf_factor") == 0)
-    return (void*)&this->state->lgar_calib_params.spf_factor;
-  else {
+  case BMI_VAR_SMCMAX_1:                   return (void*)&this->state->lgar_calib_params.theta_e_1;
+  case BMI_VAR_SMCMIN_1:                   return (void*)&this->state->lgar_calib_params.theta_r_1;
+  case BMI_VAR_VG_N_1:                     return (void*)&this->state->lgar_calib_params.vg_n_1;
+  case BMI_VAR_VG_ALPHA_1:                 return (void*)&this->state->lgar_calib_params.vg_alpha_1;
+  case BMI_VAR_KSAT_1:                     return (void*)&this->state->lgar_calib_params.Ksat_1;
+  case BMI_VAR_SMCMAX_2:                   return (void*)&this->state->lgar_calib_params.theta_e_2;
+  case BMI_VAR_SMCMIN_2:                   return (void*)&this->state->lgar_calib_params.theta_r_2;
+  case BMI_VAR_VG_N_2:                     return (void*)&this->state->lgar_calib_params.vg_n_2;
+  case BMI_VAR_VG_ALPHA_2:                 return (void*)&this->state->lgar_calib_params.vg_alpha_2;
+  case BMI_VAR_KSAT_2:                     return (void*)&this->state->lgar_calib_params.Ksat_2;
+  case BMI_VAR_SMCMAX_3:                   return (void*)&this->state->lgar_calib_params.theta_e_3;
+  case BMI_VAR_SMCMIN_3:                   return (void*)&this->state->lgar_calib_params.theta_r_3;
+  case BMI_VAR_VG_N_3:                     return (void*)&this->state->lgar_calib_params.vg_n_3;
+  case BMI_VAR_VG_ALPHA_3:                 return (void*)&this->state->lgar_calib_params.vg_alpha_3;
+  case BMI_VAR_KSAT_3:                     return (void*)&this->state->lgar_calib_params.Ksat_3;
+  case BMI_VAR_PONDED_DEPTH_MAX:           return (void*)&this->state->lgar_calib_params.ponded_depth_max;
+  case BMI_VAR_FIELD_CAPACITY:             return (void*)&this->state->lgar_calib_params.field_capacity_psi;
+  case BMI_VAR_A_CON_RES:                  return (void*)&this->state->lgar_calib_params.a_con_res;
+  case BMI_VAR_B_CON_RES:                  return (void*)&this->state->lgar_calib_params.b_con_res;
+  case BMI_VAR_FRAC_TO_CR:                 return (void*)&this->state->lgar_calib_params.frac_to_CR;
+  case BMI_VAR_A_CON_RES_SLOW:             return (void*)&this->state->lgar_calib_params.a_con_res_slow;
+  case BMI_VAR_B_CON_RES_SLOW:             return (void*)&this->state->lgar_calib_params.b_con_res_slow;
+  case BMI_VAR_FRAC_SLOW:                  return (void*)&this->state->lgar_calib_params.frac_slow;
+  case BMI_VAR_INTERFLOW_PSI_THRESHOLD:    return (void*)&this->state->lgar_calib_params.interflow_psi_threshold_cm;
+  case BMI_VAR_INTERFLOW_FACTOR:           return (void*)&this->state->lgar_calib_params.interflow_factor;
+  case BMI_VAR_SPF_FACTOR:                 return (void*)&this->state->lgar_calib_params.spf_factor;
+  case BMI_VAR_FC_PRECIP_THRESHOLD:        return (void*)&this->state->flux_caching.precip_threshold_mm_per_h;
+  case BMI_VAR_FC_AET_PET_RATIO_THRESHOLD: return (void*)&this->state->flux_caching.AET_PET_ratio_threshold;
+  case BMI_VAR_FC_PONDED_DEPTH_THRESHOLD:  return (void*)&this->state->flux_caching.ponded_depth_threshold_cm;
+  case BMI_VAR_FC_BOTTOM_FLUX_THRESHOLD:   return (void*)&this->state->flux_caching.bottom_flux_threshold_cm;
+  case BMI_VAR_FC_DZDT_THRESHOLD:          return (void*)&this->state->flux_caching.dzdt_threshold_cm_per_h;
+  case BMI_VAR_FC_HORIZON:                 return (void*)&this->state->flux_caching.horizon;
+  case BMI_VAR_SERIALIZATION_CREATE:       return (void*)&this->serialization_size;
+  case BMI_VAR_SERIALIZATION_SIZE:         return (void*)&this->serialization_size;
+  case BMI_VAR_SERIALIZATION_STATE:        return (void*)this->serialization_buffer.data();
+  case BMI_VAR_SERIALIZATION_FREE:         return (void*)&this->serialization_size;
+  default: {
     std::stringstream errMsg;
-    errMsg << "variable "<< name << " does not exist";
+    if (name)
+      errMsg << "variable "<< *name << " does not exist";
+    else
+      errMsg << "variable handle "<< handle << " does not exist";
     throw std::runtime_error(errMsg.str());
-    return NULL;
   }
-  
-  // delete it later
-  return NULL;
+  }
 }
 
 void BmiLGAR::
@@ -1501,15 +1846,13 @@ GetValueAtIndices (std::string name, void *dest, int *inds, int len)
 void BmiLGAR::
 SetValue (std::string name, void *src)
 {
-  void * dest = NULL;
-  dest = this->GetValuePtr(name);
-
-  if (dest) {
-    int nbytes = 0;
-    nbytes = this->GetVarNbytes(name);
-    memcpy(dest, src, nbytes);
-  }
+  int handle = GetVarHandle(name);
+  if (serialization_request(handle, src))
+    return;
 
+  void *dest = value_ptr(handle, &name);
+  if (dest)
+    memcpy(dest, src, GetVarNbytesByHandle(handle));
 }
 
 
@@ -1709,4 +2052,22 @@ GetGridNodesPerFace(const int grid, int *nodes_per_face)
   throw bmi_lgar::NotImplemented();
 }
 
+
+#ifdef NGEN
+/* the factory functions are defined here rather than in bmi_lgar.hxx, so that the header can be included by more than
+   one source file of the library (e.g. lasam_ensemble.cxx) */
+extern "C"
+{
+  BmiLGAR *bmi_model_create()
+  {
+    return new BmiLGAR();
+  }
+
+  void bmi_model_destroy(BmiLGAR *ptr)
+  {
+    delete ptr;
+  }
+}
+#endif
+
 #endif
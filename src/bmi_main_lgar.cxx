@@ -19,12 +19,7 @@
 #include "../bmi/bmi.hxx"
 #include "../include/all.hxx"
 #include "../include/bmi_lgar.hxx"
-
-// module finds forcing file name in the config file
-std::string GetForcingFile(std::string config_file);
-
-// module read forcings (precipitation and PET)
-void ReadForcingData(std::string config_file, std::vector<std::string>& time, std::vector<double>& precip, std::vector<double>& pet);
+#include "../include/output_writer.hxx"
 
 
 #define SUCCESS 0
@@ -34,12 +29,29 @@ int main(int argc, char *argv[])
 
   BmiLGAR model_state;
 
-  bool is_IO_supress = false; // if true no output files will be written
+  // optional checkpoint/restart and output flags after the configuration file
+  std::string restart_file, checkpoint_file;
+  enum output_format format = OUTPUT_TEXT;
+  bool is_usage_valid = (argc % 2 == 0);
+  for (int i = 2; i + 1 < argc && is_usage_valid; i += 2) {
+    if (std::string(argv[i]) == "--restart")
+      restart_file = argv[i+1];
+    else if (std::string(argv[i]) == "--checkpoint")
+      checkpoint_file = argv[i+1];
+    else if (std::string(argv[i]) == "--output-format" && std::string(argv[i+1]) == "text")
+      format = OUTPUT_TEXT;
+    else if (std::string(argv[i]) == "--output-format" && std::string(argv[i+1]) == "binary")
+      format = OUTPUT_BINARY;
+    else
+      is_usage_valid = false;
+  }
 
-  if (argc != 2) {
-    printf("Usage: ./build/xlgar CONFIGURATION_FILE \n");
+  if (!is_usage_valid) {
+    printf("Usage: ./build/xlgar CONFIGURATION_FILE [--restart CHECKPOINT_FILE] [--checkpoint CHECKPOINT_FILE] [--output-format text|binary] \n");
     printf("Run the LASAM (Lumped Arid/semi-aric Model through its BMI with a configuration file.\n");
-    printf("Outputs are written to files `variables_data.csv and layers_data.csv`.\n");
+    printf("Outputs are written to files `data_variables.csv and data_layers.csv` (.bin with --output-format binary).\n");
+    printf("--restart starts from the state in a checkpoint file (written by --checkpoint with the same configuration),\n");
+    printf("--checkpoint writes the state at the end time to a checkpoint file.\n");
     return SUCCESS;
   }
 
@@ -49,27 +61,8 @@ int main(int argc, char *argv[])
 
   model_state.Initialize(argv[1]);
 
-
-  std::string var_name_precip = "precipitation_rate";
-  std::string var_name_pet    = "potential_evapotranspiration_rate";
-  std::string var_name_wf     = "soil_moisture_wetting_fronts";
-  std::string var_name_thickness_wf = "soil_depth_wetting_fronts";
-
-  int num_output_var = 11;
-  std::vector<std::string> output_var_names(num_output_var);
-  std::vector<double> output_var_data(num_output_var);
-
-  output_var_names[0]  = "precipitation";
-  output_var_names[1]  = "potential_evapotranspiration";
-  output_var_names[2]  = "actual_evapotranspiration";
-  output_var_names[3]  = "surface_runoff"; // direct surface runoff
-  output_var_names[4]  = "giuh_runoff";
-  output_var_names[5]  = "soil_storage";
-  output_var_names[6]  = "total_discharge";
-  output_var_names[7]  = "infiltration";
-  output_var_names[8]  = "percolation";
-  output_var_names[9]  = "conceptual_reservoir_to_stream_discharge";
-  output_var_names[10] = "mass_balance";
+  if (!restart_file.empty())
+    model_state.RestoreStateFromFile(restart_file);
 
 
   // total number of timesteps
@@ -79,94 +72,102 @@ int main(int argc, char *argv[])
   double timestep = model_state.GetTimeStep();
   int nsteps = int(endtime/timestep); // total number of time steps
 
-  std::vector<std::string> time;
-  std::vector<double> precipitation;
-  std::vector<double> PET;
+  // output variables, interval and aggregation, and layers output (output_* keys of the config file); the default is
+  // every timestep of the variables below and of the wetting fronts
+  struct output_config output;
+  ReadOutputConfig(argv[1], timestep, &output);
 
-  ReadForcingData(argv[1], time, precipitation, PET);
+  int num_output_var = output.variable_names.size();
+  std::vector<std::string> &output_var_names = output.variable_names;
+  std::vector<double> output_var_data(num_output_var);  // values of the timestep
 
-  assert (nsteps <= int(PET.size()) ); // assertion to ensure that nsteps are less or equal than the input data
-  
-  if (verbosity.compare("high") == 0 && !is_IO_supress) {
-    std::cout<<"Variables are written to file           : \'data_variables.csv\' \n";
-    std::cout<<"Wetting fronts state is written to file : \'data_layers.csv\' \n";
-  }
+  bool is_IO_supress = (num_output_var == 0 && !output.write_layers); // if true no output files will be written
 
-  FILE *outdata_fptr = NULL;
-  FILE *outlayer_fptr = NULL;
-
-  if (!is_IO_supress) {
-    outdata_fptr = fopen("data_variables.csv", "w");  // write output variables (e.g. infiltration, storage etc.) to this file pointer
-    outlayer_fptr = fopen("data_layers.csv", "w");    // write output layers to this file pointer
-
-    // write heading (variable names)
-    fprintf(outdata_fptr,"Time,");
-    for (int j = 0; j < num_output_var; j++) {
-      fprintf(outdata_fptr,"%s",output_var_names[j].c_str());
-      if (j == num_output_var-1)
-	fprintf(outdata_fptr,"\n");
-      else
-      fprintf(outdata_fptr,",");
+  // resolve the output variable names once, the output loop accesses them by handle
+  std::vector<int> output_var_handles(num_output_var);
+  for (int j = 0; j < num_output_var; j++) {
+    output_var_handles[j] = model_state.GetVarHandle(output_var_names[j]);
+    if (output_var_handles[j] < 0 || model_state.GetVarGrid(output_var_names[j]) != 1) {
+      std::cerr<<"Invalid option: output_variables must be scalar variables of the model, "<<output_var_names[j]<<" is not. \n";
+      abort();
     }
+  }
+
+  // a binary forcing file is memory-mapped and used in place, a csv forcing file is parsed
+  struct forcing_series forcing;
+  OpenForcingSeries(GetForcingFile(argv[1]), &forcing);
+
+  assert (nsteps <= forcing.num_steps ); // assertion to ensure that nsteps are less or equal than the input data
+
+  // a restarted run continues at the forcing entry of the checkpoint time
+  int first_step = int(round(model_state.GetCurrentTime()/timestep));
+  assert (first_step <= nsteps);
+
+  // attach the whole forcing to the model, each Update takes the next entry (no per-timestep SetValue calls)
+  model_state.SetForcingSeries(forcing.precipitation_mm_per_h + first_step, forcing.PET_mm_per_h + first_step, nsteps - first_step);
+  
+  std::string extension = (format == OUTPUT_BINARY) ? ".bin" : ".csv";
 
+  std::string variables_file = num_output_var > 0 ? "data_variables" + extension : "";
+  std::string layers_file = output.write_layers ? "data_layers" + extension : "";
+
+  if (model_state.get_model()->verbosity == VERBOSITY_HIGH && !is_IO_supress) {
+    std::cout<<"Variables are written to file           : \'"<<variables_file<<"\' \n";
+    std::cout<<"Wetting fronts state is written to file : \'"<<layers_file<<"\' \n";
   }
 
+  // the output files are formatted and written on a separate thread, see output_writer.cxx
+  OutputWriter *writer = NULL;
+  if (!is_IO_supress)
+    writer = new OutputWriter(variables_file, layers_file, output_var_names, format);
+
+  // aggregates of the output variables over the current output interval
+  OutputAggregator aggregator(output.aggregation);
+
   // model timestep and forcing timestep are read from a config file in lgar.cxx
   //  double dt = 3600;
-  for (int i = 0; i < nsteps; i++) {
+  for (int i = first_step; i < nsteps; i++) {
 
-    if (verbosity.compare("none") != 0) {
+    if (model_state.get_model()->verbosity != VERBOSITY_NONE) {
       std::cout<<"===============================================================\n";
-      std::cout<<"Real time | "<<time[i]<<"\n";
-      std::cout<<"Rainfall [mm/h], PET [mm/h] = "<<precipitation[i]<<" , "<<PET[i]<<"\n";
+      std::cout<<"Real time | "<<forcing_time_string(forcing_series_time(&forcing, i))<<"\n";
+      std::cout<<"Rainfall [mm/h], PET [mm/h] = "<<forcing.precipitation_mm_per_h[i]<<" , "<<forcing.PET_mm_per_h[i]<<"\n";
     }
 
-    model_state.SetValue(var_name_precip, &precipitation[i]);
-    model_state.SetValue(var_name_pet, &PET[i]);
-
-    //model_state.UpdateUntil(dt); // Update model
-
     model_state.Update(); // Update model
 
-    if (!is_IO_supress) {
-      int num_wetting_fronts =  model_state.get_model()->lgar_bmi_params.num_wetting_fronts;
+    if (writer) {
+      // aggregate the bmi output variables over the output interval (intervals are counted from the start of the
+      // forcing, the last interval of the run may be shorter)
+      for (int j = 0; j < num_output_var; j++)
+	model_state.GetValueByHandle(output_var_handles[j], &output_var_data[j]);
+      aggregator.Add(output_var_data.data(), forcing_series_time(&forcing, i));
 
-      double *soil_moisture_wetting_front = new double[num_wetting_fronts];
-      double *soil_thickness_wetting_front = new double[num_wetting_fronts];
+      bool is_variables_row = num_output_var > 0 && ((i + 1) % output.interval_steps == 0 || i == nsteps - 1);
+      bool is_layers_row = output.write_layers && (i + 1) % output.layers_interval_steps == 0;
 
-      model_state.GetValue(var_name_wf,&soil_moisture_wetting_front[0]);
-      model_state.GetValue(var_name_thickness_wf,&soil_thickness_wetting_front[0]);
+      double interval_time_s = 0.0;
+      const double *variables_row = is_variables_row ? aggregator.CompleteRow(&interval_time_s) : NULL;
 
-      // write bmi output variables to file
-      fprintf(outdata_fptr,"%s,",time[i].c_str());
+      // queue the rows of the timestep for the output files
+      if (is_variables_row || is_layers_row)
+	writer->WriteStep(i, forcing_series_time(&forcing, i), variables_row, interval_time_s,
+			  is_layers_row ? model_state.get_model()->head : NULL);
+    }
 
-      for (int j = 0; j < num_output_var; j++) {
-	std::string name = output_var_names[j];
-	double value = 0.0;
-	model_state.GetValue(name,&value);
-	fprintf(outdata_fptr,"%6.15f",value);
-	if (j == num_output_var-1)
-	  fprintf(outdata_fptr,"\n");
-	else
-	  fprintf(outdata_fptr,",");
-      }
+  }
 
+  if (!checkpoint_file.empty())
+    model_state.SaveStateToFile(checkpoint_file);
 
-      // write layers data to file
-      fprintf(outlayer_fptr,"# Timestep = %d, %s \n", i, time[i].c_str());
-      write_state(outlayer_fptr, model_state.get_model()->head);
-      delete [] soil_moisture_wetting_front;
-      delete [] soil_thickness_wetting_front;
-    }
-
+  if (writer) {
+    writer->Close();
+    delete writer;
   }
 
   // do final mass balance ( inside Finalize() ) and finish the simulation
   model_state.Finalize();
-  if (outdata_fptr) {
-    fclose(outdata_fptr);
-    fclose(outlayer_fptr);
-  }
+  CloseForcingSeries(&forcing);
 
   end_time = clock();
 
@@ -177,104 +178,3 @@ int main(int argc, char *argv[])
 
   return SUCCESS;
 }
-
-
-
-void
-ReadForcingData(std::string config_file, std::vector<std::string>& time, std::vector<double>& precip, std::vector<double>& pet)
-{
-  // get the forcing file from the config file
-
-  std::ifstream file;
-  file.open(config_file);
-
-  if (!file) {
-    std::stringstream errMsg;
-    errMsg << config_file << " does not exist";
-    throw std::runtime_error(errMsg.str());
-  }
-
-  std::string forcing_file;
-  bool is_forcing_file_set=false;
-
-  while (file) {
-    std::string line;
-    std::string param_key, param_value;
-
-    std::getline(file, line);
-
-    int loc_eq = line.find("=") + 1;
-    param_key = line.substr(0, line.find("="));
-    param_value = line.substr(loc_eq,line.length());
-
-    if (param_key == "forcing_file") {
-      forcing_file = param_value;
-      is_forcing_file_set = true;
-      break;
-    }
-  }
-
-  if (!is_forcing_file_set) {
-    std::stringstream errMsg;
-    errMsg << config_file << " does not provide forcing_file";
-    throw std::runtime_error(errMsg.str());
-  }
-
-  std::ifstream fp;
-  fp.open(forcing_file);
-  if (!fp) {
-    cout<<"file "<<forcing_file<<" doesn't exist. \n";
-    abort();
-  }
-
-  std::string line, cell;
-
-  //read first line of strings which contains forcing variables names.
-  std::getline(fp, line);
-
-  while (fp) {
-    std::getline(fp, line);
-    std::stringstream lineStream(line);
-    int count = 0;
-    while(std::getline(lineStream,cell, ',')) {
-
-      if (count == 0) {
-	time.push_back(cell);
-	count++;
-	continue;
-      }
-      else if (count == 1) {
-	precip.push_back(stod(cell));
-	count++;
-	continue;
-      }
-      else if (count == 2) {
-	pet.push_back(stod(cell));
-	count +=1;
-	continue;
-      }
-
-    }
-
-  }
-
-
-}
-
-
-extern void write_state(FILE *out, struct wetting_front* head){
-
-  struct wetting_front *current = head;
-
-  fprintf(out, "[");
-  while(current != NULL)
-  {
-    if (current == head)
-      fprintf(out,"(%lf,%lf,%d,%d,%lf)",current->depth_cm*10., current->theta, current->layer_num,current->front_num, current->psi_cm*10.);
-    else
-      fprintf(out,"|(%lf,%lf,%d,%d,%lf)",current->depth_cm*10., current->theta, current->layer_num,current->front_num, current->psi_cm*10.);
-  current = current->next;
-  }
-  fprintf(out, "]\n");
-
-}
@@ -0,0 +1,338 @@
+#include "../include/bmi_lgar.hxx"
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <type_traits>
+
+//#####################################################################################
+/* - The file contains the checkpoint/restart of a model instance: the state that evolves
+     during a run (wetting fronts, conceptual reservoir storages, mass balance
+     accumulators, GIUH runoff queue, flux caching and adaptive timestep state) and the
+     parameters that can change after initialization (calibration, coupling inputs) are
+     written to a binary image, which is restored into a model that was initialized
+     from the same config file. The configuration itself is not part of the image.
+   - Image layout: magic "LASAMCKP", format version, total size, then the fields in
+     the order of checkpoint_fields(), each preceded by its size in bytes, so that an
+     image of a different version or of a build with different structures is rejected
+     instead of being misread. Images are not portable across byte orders.
+   - A restore is all or nothing: the image is first checked field by field without
+     touching the model (checkpoint_validator), and only then read into the model.
+   - The latest wetting front snapshot (state_previous) is not saved, it is taken again
+     at the start of each subtimestep; the lookup tables and per-layer derived constants
+     are rebuilt from the restored parameters.                                        */
+//#####################################################################################
+
+static const char     checkpoint_magic[8]   = {'L','A','S','A','M','C','K','P'};
+static const uint32_t checkpoint_version    = 1;
+static const size_t   checkpoint_header_len = sizeof(checkpoint_magic) + sizeof(uint32_t) + sizeof(uint64_t);
+
+
+// appends the fields of a model to a checkpoint image
+class checkpoint_writer {
+public:
+  static const bool restoring = false;
+
+  explicit checkpoint_writer(std::vector<char> &buffer) : buffer(buffer) {}
+
+  template <class T> void item(T &value) { array(&value, 1); }
+  template <class T> void dimensions(T *values, int count) { array(values, count); }
+
+  template <class T> void array(T *values, int count)
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "checkpoint fields must be trivially copyable");
+    uint32_t nbytes = (uint32_t)(count * sizeof(T));
+    append(&nbytes, sizeof(nbytes));
+    append(values, nbytes);
+  }
+
+  void append(const void *data, size_t nbytes)
+  {
+    size_t offset = buffer.size();
+    buffer.resize(offset + nbytes);
+    if (nbytes > 0)
+      memcpy(buffer.data() + offset, data, nbytes);
+  }
+
+private:
+  std::vector<char> &buffer;
+};
+
+
+// reads the fields of a model from a checkpoint image, checking the size of each field
+class checkpoint_reader {
+public:
+  static const bool restoring = true;
+
+  checkpoint_reader(const char *buffer, size_t nbytes) : buffer(buffer), nbytes(nbytes) {}
+
+  template <class T> void item(T &value) { array(&value, 1); }
+  template <class T> void dimensions(T *values, int count) { array(values, count); }
+
+  template <class T> void array(T *values, int count)
+  {
+    take(values, field_size<T>(count));
+  }
+
+  // checks the size of the next field against count values of T and returns it
+  template <class T> uint32_t field_size(int count)
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "checkpoint fields must be trivially copyable");
+    uint32_t field_nbytes;
+    take(&field_nbytes, sizeof(field_nbytes));
+    if (field_nbytes != count * sizeof(T)) {
+      std::stringstream errMsg;
+      errMsg << "checkpoint field at byte " << offset << " has " << field_nbytes << " bytes, expected "
+	     << count * sizeof(T) << " (checkpoint of another configuration or build)";
+      throw std::runtime_error(errMsg.str());
+    }
+    return field_nbytes;
+  }
+
+  void take(void *data, size_t data_nbytes)
+  {
+    skip(data_nbytes);
+    memcpy(data, buffer + offset - data_nbytes, data_nbytes);
+  }
+
+  void skip(size_t data_nbytes)
+  {
+    if (offset + data_nbytes > nbytes)
+      throw std::runtime_error("checkpoint is truncated");
+    offset += data_nbytes;
+  }
+
+  size_t offset = 0;
+
+private:
+  const char *buffer;
+  size_t nbytes;
+};
+
+
+// checks a checkpoint image field by field without changing the model: only the dimensions, which give the sizes of
+// the fields that follow, are decoded (into locals of checkpoint_fields)
+class checkpoint_validator : public checkpoint_reader {
+public:
+  static const bool restoring = false;
+
+  checkpoint_validator(const char *buffer, size_t nbytes) : checkpoint_reader(buffer, nbytes) {}
+
+  template <class T> void item(T &value) { array(&value, 1); }
+  template <class T> void dimensions(T *values, int count) { checkpoint_reader::array(values, count); }
+
+  template <class T> void array(T *, int count)
+  {
+    skip(field_size<T>(count));
+  }
+};
+
+
+/*
+  Visits the fields of the checkpoint in a fixed order; used by both the writer and the reader so that the two cannot
+  disagree. A change of the fields requires a new checkpoint_version. Fields that give the sizes of later fields are
+  visited with dimensions() and must be locals, as the validator decodes them.
+*/
+template <class Archive>
+void BmiLGAR::
+checkpoint_fields(Archive &archive)
+{
+  struct lgar_bmi_parameters *params = &state->lgar_bmi_params;
+
+  // dimensions, checked against the model the checkpoint is restored into
+  int dims[4] = {params->num_layers, params->num_soil_types, num_giuh_ordinates, params->num_cells_temp};
+  archive.dimensions(dims, 4);
+  if (dims[0] != params->num_layers || dims[1] != params->num_soil_types || dims[2] != num_giuh_ordinates
+      || dims[3] != params->num_cells_temp) {
+    std::stringstream errMsg;
+    errMsg << "checkpoint has " << dims[0] << " layers, " << dims[1] << " soil types, " << dims[2]
+	   << " giuh ordinates and " << dims[3] << " temperature cells, which does not match the configuration";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  // time and the parameters that change during a run, through calibration or through coupling
+  archive.item(params->time_s);
+  archive.item(params->timesteps);
+  archive.item(params->AET_cm);
+  archive.item(params->ponded_depth_cm);
+  archive.item(params->ponded_depth_max_cm);
+  archive.item(params->precip_previous_timestep_cm);
+  archive.item(params->field_capacity_psi_cm);
+  archive.item(params->a_con_res);
+  archive.item(params->b_con_res);
+  archive.item(params->frac_to_CR);
+  archive.item(params->a_con_res_slow);
+  archive.item(params->b_con_res_slow);
+  archive.item(params->frac_slow);
+  archive.item(params->interflow_psi_threshold_cm);
+  archive.item(params->interflow_factor);
+  archive.item(params->spf_factor);
+  archive.item(params->calib_params_flag);
+  archive.item(params->runoff_in_prev_step);
+  archive.item(params->cache_count);
+  archive.array(params->frozen_factor, params->num_layers + 1);
+  if (params->num_cells_temp > 0)
+    archive.array(params->soil_temperature, params->num_cells_temp);
+
+  // soil parameters (the calibrated soils differ from the soil parameters file)
+  if (state->soil_properties) {
+    for (int soil=1; soil <= params->num_soil_types; soil++) {
+      struct soil_properties_ *properties = &state->soil_properties[soil];
+      double values[15] = {properties->theta_r, properties->theta_e, properties->vg_alpha_per_cm, properties->vg_n,
+			   properties->vg_m, properties->bc_lambda, properties->bc_psib_cm, properties->h_min_cm,
+			   properties->Ksat_cm_per_h, properties->theta_wp, properties->vg_m_inv, properties->vg_n_inv,
+			   properties->vg_alpha_inv_cm, properties->bc_Geff_exponent, properties->bc_H_c_cm};
+      archive.array(values, 15);
+      if (Archive::restoring) {
+        properties->theta_r          = values[0];
+        properties->theta_e          = values[1];
+        properties->vg_alpha_per_cm  = values[2];
+        properties->vg_n             = values[3];
+        properties->vg_m             = values[4];
+        properties->bc_lambda        = values[5];
+        properties->bc_psib_cm       = values[6];
+        properties->h_min_cm         = values[7];
+        properties->Ksat_cm_per_h    = values[8];
+        properties->theta_wp         = values[9];
+        properties->vg_m_inv         = values[10];
+        properties->vg_n_inv         = values[11];
+        properties->vg_alpha_inv_cm  = values[12];
+        properties->bc_Geff_exponent = values[13];
+        properties->bc_H_c_cm        = values[14];
+      }
+    }
+  }
+
+  archive.item(state->lgar_calib_params);
+  archive.item(*state->lgar_bmi_input_params);
+  archive.item(state->lgar_mass_balance);
+  archive.item(state->flux_caching);
+  archive.item(state->Geff_quadrature);
+  archive.item(state->substep_control.next_timestep_h);
+  archive.item(state->substep_control.previous_precip_mm_per_h);
+  archive.item(state->substep_control.num_accepted);
+  archive.item(state->substep_control.num_rejected);
+
+  // BMI side: GIUH runoff queue and the output fluxes of the last update
+  archive.array(giuh_runoff_queue, num_giuh_ordinates + 1);
+  archive.item(bmi_unit_conv);
+
+  // wetting fronts
+  struct wetting_front_store fronts;
+  storeFromList(state->head, &fronts);
+  archive.dimensions(&fronts.num_fronts, 1);
+  if (fronts.num_fronts < 0 || fronts.num_fronts > MAX_NUM_WETTING_FRONTS)
+    throw std::runtime_error("checkpoint has an invalid number of wetting fronts");
+  archive.array(&fronts.depth_cm[1], fronts.num_fronts);
+  archive.array(&fronts.theta[1], fronts.num_fronts);
+  archive.array(&fronts.psi_cm[1], fronts.num_fronts);
+  archive.array(&fronts.K_cm_per_h[1], fronts.num_fronts);
+  archive.array(&fronts.layer_num[1], fronts.num_fronts);
+  archive.array(&fronts.to_bottom[1], fronts.num_fronts);
+  archive.array(&fronts.dzdt_cm_per_h[1], fronts.num_fronts);
+  if (Archive::restoring)
+    storeToList(&fronts, &state->head, &state->front_pool);
+}
+
+
+/*
+  Writes the state of the model into buffer (which is resized to the size of the image)
+*/
+void BmiLGAR::
+SaveState(std::vector<char> &buffer)
+{
+  buffer.clear();
+  checkpoint_writer writer(buffer);
+
+  uint64_t nbytes = 0; // patched below
+  writer.append(checkpoint_magic, sizeof(checkpoint_magic));
+  writer.append(&checkpoint_version, sizeof(checkpoint_version));
+  writer.append(&nbytes, sizeof(nbytes));
+
+  checkpoint_fields(writer);
+
+  nbytes = buffer.size();
+  memcpy(buffer.data() + sizeof(checkpoint_magic) + sizeof(checkpoint_version), &nbytes, sizeof(nbytes));
+}
+
+
+/*
+  Restores the state of the model from a checkpoint image of nbytes bytes; if nbytes is 0 the size is taken from the
+  header of the image (for the BMI serialization_state, which is set without a size). The model must have been
+  initialized from the same config file as the model that wrote the image; throws if the image is not a checkpoint of
+  this version or does not match the configuration. The whole image is checked before any field is restored, so a
+  rejected image leaves the model unchanged.
+*/
+void BmiLGAR::
+RestoreState(const char *buffer, size_t nbytes)
+{
+  verbosity_scope scope(state->verbosity);
+
+  if (nbytes != 0 && nbytes < checkpoint_header_len)
+    throw std::runtime_error("checkpoint is truncated");
+  if (memcmp(buffer, checkpoint_magic, sizeof(checkpoint_magic)) != 0)
+    throw std::runtime_error("not a LASAM checkpoint");
+
+  uint32_t version;
+  uint64_t image_nbytes;
+  memcpy(&version, buffer + sizeof(checkpoint_magic), sizeof(version));
+  memcpy(&image_nbytes, buffer + sizeof(checkpoint_magic) + sizeof(version), sizeof(image_nbytes));
+
+  if (version != checkpoint_version) {
+    std::stringstream errMsg;
+    errMsg << "checkpoint version " << version << " is not supported (expected " << checkpoint_version << ")";
+    throw std::runtime_error(errMsg.str());
+  }
+  if (nbytes != 0 && image_nbytes > nbytes)
+    throw std::runtime_error("checkpoint is truncated");
+
+  checkpoint_validator validator(buffer, image_nbytes);
+  validator.offset = checkpoint_header_len;
+  checkpoint_fields(validator);
+
+  if (validator.offset != image_nbytes)
+    throw std::runtime_error("checkpoint has trailing data");
+
+  checkpoint_reader reader(buffer, image_nbytes);
+  reader.offset = checkpoint_header_len;
+  checkpoint_fields(reader);
+
+  // rebuild what is derived from the restored parameters and state
+  lgar_build_soil_tables(state);
+  lgar_update_derived_constants(&state->lgar_bmi_params, state->soil_properties, &state->derived);
+  state->state_previous = NULL;
+  update_outputs();
+
+  if (LGAR_LOG_LOW)
+    std::cerr<<"Restored checkpoint, time [h] = "<< state->lgar_bmi_params.time_s / 3600. <<"\n";
+}
+
+
+void BmiLGAR::
+SaveStateToFile(std::string file_name)
+{
+  std::vector<char> buffer;
+  SaveState(buffer);
+
+  std::ofstream file(file_name, std::ios::binary);
+  file.write(buffer.data(), buffer.size());
+  if (!file) {
+    std::stringstream errMsg;
+    errMsg << "cannot write checkpoint file " << file_name;
+    throw std::runtime_error(errMsg.str());
+  }
+}
+
+
+void BmiLGAR::
+RestoreStateFromFile(std::string file_name)
+{
+  std::ifstream file(file_name, std::ios::binary);
+  if (!file) {
+    std::stringstream errMsg;
+    errMsg << "checkpoint file " << file_name << " does not exist";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  std::vector<char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  RestoreState(buffer.data(), buffer.size());
+}
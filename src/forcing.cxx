@@ -0,0 +1,472 @@
+#include "../include/all.hxx"
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <string.h>
+#include <cstdint>
+#include <memory>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//#####################################################################################
+/* - The file contains the readers of the forcing data (precipitation and PET) used by
+     the standalone driver and the ensemble runner (lasam_ensemble.cxx).
+   - The forcing file is a csv file with a header line and the columns time,
+     precipitation [mm/h], PET [mm/h]; its path is given by forcing_file in the config.
+   - The file is read with one block read and parsed in a single pass into the columns
+     of struct forcing_data: time stamps (YYYY-MM-DD HH:MM:SS) are converted to seconds
+     once, and the numbers are parsed without the C++ streams and independently of the
+     locale (see parse_number).
+   - Binary forcing files (written by lasam_forcing_convert, see WriteBinaryForcingFile)
+     hold the same columns without parsing: magic "LASAMFRC", format version, header
+     size, number of entries, start time and timestep, followed by the precipitation
+     and PET columns as float64. The file is validated once when it is written (no
+     gaps, a uniform timestep, no negative or non-finite rates); a run memory-maps it
+     and reads the columns in place (OpenForcingSeries). Binary forcing files are not
+     portable across byte orders.                                                      */
+//#####################################################################################
+
+
+/* returns the forcing file named in the config file (forcing_file) */
+extern std::string
+GetForcingFile(std::string config_file)
+{
+  std::ifstream file;
+  file.open(config_file);
+
+  if (!file) {
+    std::stringstream errMsg;
+    errMsg << config_file << " does not exist";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  std::string line;
+  while (std::getline(file, line)) {
+    size_t loc_eq = line.find("=");
+    if (loc_eq != std::string::npos && line.compare(0, loc_eq, "forcing_file") == 0)
+      return line.substr(loc_eq + 1);
+  }
+
+  std::stringstream errMsg;
+  errMsg << config_file << " does not provide forcing_file";
+  throw std::runtime_error(errMsg.str());
+}
+
+
+// days since 1970-01-01 of a date of the proleptic Gregorian calendar, and the inverse
+static long days_from_civil(long year, long month, long day)
+{
+  year -= (month <= 2);
+  long era = (year >= 0 ? year : year - 399) / 400;
+  long year_of_era = year - era * 400;
+  long day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  long day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+  return era * 146097 + day_of_era - 719468;
+}
+
+static void civil_from_days(long days, long *year, long *month, long *day)
+{
+  days += 719468;
+  long era = (days >= 0 ? days : days - 146096) / 146097;
+  long day_of_era = days - era * 146097;
+  long year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+  long day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+  long mp = (5 * day_of_year + 2) / 153;
+  *day   = day_of_year - (153 * mp + 2) / 5 + 1;
+  *month = mp < 10 ? mp + 3 : mp - 9;
+  *year  = year_of_era + era * 400 + (*month <= 2);
+}
+
+
+/* formats a time stamp (seconds since 1970-01-01 00:00:00) as YYYY-MM-DD HH:MM:SS, the format of the forcing files */
+extern std::string
+forcing_time_string(double time_s)
+{
+  long seconds = (long)floor(time_s);
+  long days = (seconds >= 0 ? seconds : seconds - 86399) / 86400;
+  long second_of_day = seconds - days * 86400;
+  long year, month, day;
+  civil_from_days(days, &year, &month, &day);
+
+  // 19 characters for the years 0-9999; room for any int in each of the 6 fields, plus its separator
+  char buffer[6 * 12];
+  snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d %02d:%02d:%02d", (int)year, (int)month, (int)day,
+	   (int)(second_of_day / 3600), (int)(second_of_day / 60) % 60, (int)(second_of_day % 60));
+  return buffer;
+}
+
+
+// parses the unsigned integer of exactly num_digits digits at p
+static bool parse_digits(const char *p, int num_digits, long *value)
+{
+  *value = 0;
+  for (int i=0; i<num_digits; i++) {
+    if (p[i] < '0' || p[i] > '9')
+      return false;
+    *value = *value * 10 + (p[i] - '0');
+  }
+  return true;
+}
+
+
+// parses a time stamp YYYY-MM-DD HH:MM[:SS] (or with a 'T' between date and time) of the cell [p, end)
+static bool parse_time_stamp(const char *p, const char *end, double *time_s)
+{
+  long year, month, day, hour, minute, second = 0;
+  size_t length = end - p;
+
+  if (length < 16 || p[4] != '-' || p[7] != '-' || (p[10] != ' ' && p[10] != 'T') || p[13] != ':'
+      || !parse_digits(p, 4, &year) || !parse_digits(p + 5, 2, &month) || !parse_digits(p + 8, 2, &day)
+      || !parse_digits(p + 11, 2, &hour) || !parse_digits(p + 14, 2, &minute))
+    return false;
+
+  if (length >= 19 && p[16] == ':') {
+    if (!parse_digits(p + 17, 2, &second))
+      return false;
+  }
+
+  *time_s = (double)days_from_civil(year, month, day) * 86400.0 + hour * 3600.0 + minute * 60.0 + second;
+  return true;
+}
+
+
+/*
+  Parses the decimal number [+-]digits[.digits][(e|E)[+-]digits] of the cell [p, end), blanks around it are allowed.
+  The digits are accumulated as an integer and scaled by an exact power of ten, which is correctly rounded (the same
+  value as strtod) if the integer is below 2^53 and the power at most 10^22; this covers the numbers of forcing files.
+  Other cells (more digits, larger exponents, nan, inf, ...) are converted with stod, as before.
+*/
+static double parse_number(const char *p, const char *end)
+{
+  static const double powers_of_ten[23] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13,
+					   1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  const char *start = p;
+
+  while (p < end && (*p == ' ' || *p == '\t'))
+    p++;
+
+  bool negative = false;
+  if (p < end && (*p == '+' || *p == '-'))
+    negative = (*p++ == '-');
+
+  unsigned long long mantissa = 0;
+  int num_digits = 0, exponent = 0;
+  bool is_simple = true;
+
+  for (; p < end && *p >= '0' && *p <= '9'; p++, num_digits++)
+    mantissa = mantissa * 10 + (*p - '0');
+
+  if (p < end && *p == '.') {
+    for (p++; p < end && *p >= '0' && *p <= '9'; p++, num_digits++, exponent--)
+      mantissa = mantissa * 10 + (*p - '0');
+  }
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    p++;
+    bool negative_exponent = false;
+    if (p < end && (*p == '+' || *p == '-'))
+      negative_exponent = (*p++ == '-');
+    int exponent_digits = 0, value = 0;
+    for (; p < end && *p >= '0' && *p <= '9' && exponent_digits < 6; p++, exponent_digits++)
+      value = value * 10 + (*p - '0');
+    is_simple = (exponent_digits > 0);
+    exponent += negative_exponent ? -value : value;
+  }
+
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+    p++;
+
+  is_simple = is_simple && p == end && num_digits > 0 && num_digits <= 19 && mantissa < (1ULL << 53)
+    && exponent >= -22 && exponent <= 22;
+
+  if (!is_simple)
+    return stod(std::string(start, end));
+
+  double value = (double)mantissa;
+  value = exponent < 0 ? value / powers_of_ten[-exponent] : value * powers_of_ten[exponent];
+  return negative ? -value : value;
+}
+
+
+static const char     forcing_magic[8] = {'L','A','S','A','M','F','R','C'};
+static const uint32_t forcing_version  = 1;
+
+// header of a binary forcing file, the precipitation and PET columns follow
+struct binary_forcing_header
+{
+  char     magic[8];
+  uint32_t version;
+  uint32_t header_nbytes;
+  uint64_t num_steps;
+  double   start_time_s;
+  double   timestep_s;
+};
+static_assert(sizeof(struct binary_forcing_header) == 40, "the columns of a binary forcing file must be 8-byte aligned");
+
+
+/* returns true if forcing_file is a binary forcing file (false for a csv file or a file that does not exist) */
+extern bool
+IsBinaryForcingFile(std::string forcing_file)
+{
+  char magic[sizeof(forcing_magic)];
+  FILE *fp = fopen(forcing_file.c_str(), "rb");
+  if (fp == NULL)
+    return false;
+  bool is_binary = fread(magic, 1, sizeof(magic), fp) == sizeof(magic) && memcmp(magic, forcing_magic, sizeof(magic)) == 0;
+  fclose(fp);
+  return is_binary;
+}
+
+
+/*
+  Checks that forcing has at least one entry, a uniform positive timestep (no gaps) and finite, non-negative
+  precipitation and PET; throws otherwise, naming the first offending entry.
+*/
+extern void
+ValidateForcingData(const struct forcing_data *forcing)
+{
+  size_t num_steps = forcing->time_s.size();
+  if (num_steps == 0 || forcing->precipitation_mm_per_h.size() != num_steps || forcing->PET_mm_per_h.size() != num_steps)
+    throw std::runtime_error("forcing has no entries or columns of different lengths");
+
+  double timestep_s = num_steps > 1 ? forcing->time_s[1] - forcing->time_s[0] : 0.0;
+  for (size_t i=0; i<num_steps; i++) {
+    std::stringstream errMsg;
+    if (i > 0 && (forcing->time_s[i] - forcing->time_s[i-1] != timestep_s || timestep_s <= 0.0))
+      errMsg << "forcing has a gap or an irregular timestep at " << forcing_time_string(forcing->time_s[i])
+	     << " (" << forcing->time_s[i] - forcing->time_s[i-1] << " s after the previous entry, expected "
+	     << timestep_s << " s)";
+    else if (!std::isfinite(forcing->precipitation_mm_per_h[i]) || forcing->precipitation_mm_per_h[i] < 0.0)
+      errMsg << "forcing has precipitation " << forcing->precipitation_mm_per_h[i] << " mm/h at "
+	     << forcing_time_string(forcing->time_s[i]);
+    else if (!std::isfinite(forcing->PET_mm_per_h[i]) || forcing->PET_mm_per_h[i] < 0.0)
+      errMsg << "forcing has PET " << forcing->PET_mm_per_h[i] << " mm/h at " << forcing_time_string(forcing->time_s[i]);
+    else
+      continue;
+    throw std::runtime_error(errMsg.str());
+  }
+}
+
+
+/*
+  Writes the columns of forcing to a binary forcing file. The forcing is validated here, once, instead of at every
+  load (see ValidateForcingData).
+*/
+extern void
+WriteBinaryForcingFile(std::string binary_file, const struct forcing_data *forcing)
+{
+  ValidateForcingData(forcing);
+
+  size_t num_steps = forcing->time_s.size();
+  double timestep_s = num_steps > 1 ? forcing->time_s[1] - forcing->time_s[0] : 0.0;
+
+  struct binary_forcing_header header;
+  memcpy(header.magic, forcing_magic, sizeof(forcing_magic));
+  header.version       = forcing_version;
+  header.header_nbytes = sizeof(header);
+  header.num_steps     = num_steps;
+  header.start_time_s  = forcing->time_s[0];
+  header.timestep_s    = timestep_s;
+
+  FILE *fp = fopen(binary_file.c_str(), "wb");
+  bool is_written = fp != NULL && fwrite(&header, sizeof(header), 1, fp) == 1
+    && fwrite(forcing->precipitation_mm_per_h.data(), sizeof(double), num_steps, fp) == num_steps
+    && fwrite(forcing->PET_mm_per_h.data(), sizeof(double), num_steps, fp) == num_steps;
+  if (fp != NULL)
+    is_written = (fclose(fp) == 0) && is_written;
+
+  if (!is_written) {
+    std::stringstream errMsg;
+    errMsg << "cannot write binary forcing file " << binary_file;
+    throw std::runtime_error(errMsg.str());
+  }
+}
+
+
+// maps a binary forcing file into series, checking its header and size (the values were validated when it was written)
+static void map_binary_forcing_file(std::string forcing_file, struct forcing_series *series)
+{
+  std::stringstream errMsg;
+  int fd = open(forcing_file.c_str(), O_RDONLY);
+  struct stat file_stat;
+  if (fd < 0 || fstat(fd, &file_stat) != 0) {
+    if (fd >= 0)
+      close(fd);
+    errMsg << "cannot open binary forcing file " << forcing_file;
+    throw std::runtime_error(errMsg.str());
+  }
+
+  size_t nbytes = file_stat.st_size;
+  void *mapping = nbytes > 0 ? mmap(NULL, nbytes, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    errMsg << "cannot map binary forcing file " << forcing_file;
+    throw std::runtime_error(errMsg.str());
+  }
+
+  struct binary_forcing_header header;
+  if (nbytes < sizeof(header))
+    errMsg << "binary forcing file " << forcing_file << " is truncated";
+  else {
+    memcpy(&header, mapping, sizeof(header));
+    if (header.version != forcing_version || header.header_nbytes != sizeof(header))
+      errMsg << "binary forcing file " << forcing_file << " has version " << header.version << " (expected "
+	     << forcing_version << ")";
+    // compare entry counts rather than byte sizes so a corrupt num_steps cannot overflow the expected size
+    else if ((nbytes - sizeof(header)) % (2 * sizeof(double)) != 0
+	     || (nbytes - sizeof(header)) / (2 * sizeof(double)) != header.num_steps)
+      errMsg << "binary forcing file " << forcing_file << " has " << nbytes << " bytes, which does not hold the "
+	     << header.num_steps << " entries its header declares";
+  }
+
+  if (!errMsg.str().empty()) {
+    munmap(mapping, nbytes);
+    throw std::runtime_error(errMsg.str());
+  }
+
+  const double *columns = (const double*)((const char*)mapping + sizeof(header));
+  series->num_steps              = (long)header.num_steps;
+  series->start_time_s           = header.start_time_s;
+  series->timestep_s             = header.timestep_s;
+  series->time_s                 = NULL;
+  series->precipitation_mm_per_h = columns;
+  series->PET_mm_per_h           = columns + header.num_steps;
+  series->mapping                = mapping;
+  series->mapping_nbytes         = nbytes;
+}
+
+
+/*
+  Opens the forcing of a run: a binary forcing file is memory-mapped and read in place (no parsing), a csv forcing
+  file is parsed. The columns stay valid until CloseForcingSeries.
+*/
+extern void
+OpenForcingSeries(std::string forcing_file, struct forcing_series *series)
+{
+  *series = forcing_series();
+
+  if (IsBinaryForcingFile(forcing_file)) {
+    map_binary_forcing_file(forcing_file, series);
+    return;
+  }
+
+  std::unique_ptr<struct forcing_data> parsed(new forcing_data);
+  ReadForcingFile(forcing_file, parsed.get());
+
+  series->num_steps              = (long)parsed->time_s.size();
+  series->start_time_s           = series->num_steps > 0 ? parsed->time_s[0] : 0.0;
+  series->timestep_s             = series->num_steps > 1 ? parsed->time_s[1] - parsed->time_s[0] : 0.0;
+  series->time_s                 = parsed->time_s.data();
+  series->precipitation_mm_per_h = parsed->precipitation_mm_per_h.data();
+  series->PET_mm_per_h           = parsed->PET_mm_per_h.data();
+  series->parsed                 = parsed.release();
+}
+
+
+extern void
+CloseForcingSeries(struct forcing_series *series)
+{
+  if (series->mapping)
+    munmap(series->mapping, series->mapping_nbytes);
+  delete series->parsed;
+  *series = forcing_series();
+}
+
+
+/* time of entry step of a forcing series, seconds since 1970-01-01 00:00:00 */
+extern double
+forcing_series_time(const struct forcing_series *series, long step)
+{
+  return series->time_s ? series->time_s[step] : series->start_time_s + step * series->timestep_s;
+}
+
+
+/* reads the time stamps, precipitation and PET of a forcing file (csv or binary) into the columns of forcing */
+extern void
+ReadForcingFile(std::string forcing_file, struct forcing_data *forcing)
+{
+  if (IsBinaryForcingFile(forcing_file)) {
+    struct forcing_series series = forcing_series();
+    map_binary_forcing_file(forcing_file, &series);
+    forcing->time_s.resize(series.num_steps);
+    for (long i=0; i<series.num_steps; i++)
+      forcing->time_s[i] = forcing_series_time(&series, i);
+    forcing->precipitation_mm_per_h.assign(series.precipitation_mm_per_h, series.precipitation_mm_per_h + series.num_steps);
+    forcing->PET_mm_per_h.assign(series.PET_mm_per_h, series.PET_mm_per_h + series.num_steps);
+    munmap(series.mapping, series.mapping_nbytes);
+    return;
+  }
+
+  FILE *fp = fopen(forcing_file.c_str(), "rb");
+  if (fp == NULL) {
+    cout<<"file "<<forcing_file<<" doesn't exist. \n";
+    abort();
+  }
+
+  // read the whole file with one block read
+  fseek(fp, 0, SEEK_END);
+  long file_size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  std::vector<char> contents(file_size > 0 ? file_size : 0);
+  size_t nread = fread(contents.data(), 1, contents.size(), fp);
+  fclose(fp);
+  contents.resize(nread);
+
+  const char *p = contents.data();
+  const char *end = p + contents.size();
+
+  // one row per line (the first line is the header with the names of the columns)
+  size_t num_rows = std::count(contents.begin(), contents.end(), '\n');
+  forcing->time_s.clear();
+  forcing->precipitation_mm_per_h.clear();
+  forcing->PET_mm_per_h.clear();
+  forcing->time_s.reserve(num_rows);
+  forcing->precipitation_mm_per_h.reserve(num_rows);
+  forcing->PET_mm_per_h.reserve(num_rows);
+
+  int line_num = 0;
+  while (p < end) {
+    const char *line_end = (const char*)memchr(p, '\n', end - p);
+    if (line_end == NULL)
+      line_end = end;
+    line_num++;
+
+    // cells time, precipitation and PET (further columns are ignored); blank lines are skipped
+    const char *cell[4] = {p, NULL, NULL, NULL};
+    int num_cells = 1;
+    for (const char *c = p; c < line_end && num_cells < 4; c++) {
+      if (*c == ',')
+	cell[num_cells++] = c + 1;
+    }
+
+    bool is_blank = true;
+    for (const char *c = p; c < line_end && is_blank; c++)
+      is_blank = (*c == ' ' || *c == '\t' || *c == '\r');
+
+    if (line_num > 1 && !is_blank) {
+      double time_s;
+      if (num_cells < 3 || !parse_time_stamp(cell[0], cell[1] - 1, &time_s)) {
+	std::stringstream errMsg;
+	errMsg << "line " << line_num << " of forcing file " << forcing_file
+	       << " is not a row 'YYYY-MM-DD HH:MM:SS,precipitation,PET'";
+	throw std::runtime_error(errMsg.str());
+      }
+
+      forcing->time_s.push_back(time_s);
+      forcing->precipitation_mm_per_h.push_back(parse_number(cell[1], cell[2] - 1));
+      forcing->PET_mm_per_h.push_back(parse_number(cell[2], num_cells > 3 ? cell[3] - 1 : line_end));
+    }
+
+    p = line_end + 1;
+  }
+}
+
+
+/* reads the forcing of the forcing file named in the config file */
+extern void
+ReadForcingData(std::string config_file, struct forcing_data *forcing)
+{
+  ReadForcingFile(GetForcingFile(config_file), forcing);
+}
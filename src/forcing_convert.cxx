@@ -0,0 +1,87 @@
+/*
+  Description: converts csv forcing files (Time,P(mm/h),PET(mm/h)) to binary forcing files, which the standalone
+               driver and the ensemble runner memory-map instead of parsing (see forcing.cxx). The forcing is
+               validated once here: units of the columns, gaps and irregular timesteps, negative or non-finite rates.
+  Input: csv forcing files; a binary forcing file is checked and summarized instead
+  Output: FILE.bin next to each FILE.csv (or FILE.txt)
+*/
+
+#include <stdio.h>
+#include <iostream>
+#include <fstream>
+
+#include "../include/all.hxx"
+
+#define SUCCESS 0
+#define FAILURE 1
+
+// the precipitation and PET columns of a csv forcing file must be in mm/h
+static void check_units(std::string csv_file)
+{
+  std::ifstream file(csv_file);
+  if (!file) {
+    std::stringstream errMsg;
+    errMsg << csv_file << " does not exist";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  std::string header, time_name, precipitation_name, PET_name;
+  std::getline(file, header);
+  std::stringstream header_stream(header);
+  std::getline(header_stream, time_name, ',');
+  std::getline(header_stream, precipitation_name, ',');
+  std::getline(header_stream, PET_name, ',');
+
+  if (precipitation_name.find("mm/h") == std::string::npos || PET_name.find("mm/h") == std::string::npos) {
+    std::stringstream errMsg;
+    errMsg << csv_file << " has the columns '" << header << "', expected 'Time,P(mm/h),PET(mm/h)'";
+    throw std::runtime_error(errMsg.str());
+  }
+}
+
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2) {
+    printf("Usage: ./build/lasam_forcing_convert FORCING_FILE [FORCING_FILE ...] \n");
+    printf("Converts csv forcing files to binary forcing files (FILE.csv -> FILE.bin) after validating them.\n");
+    printf("A binary forcing file is checked and summarized instead of converted.\n");
+    return SUCCESS;
+  }
+
+  int status = SUCCESS;
+
+  for (int i = 1; i < argc; i++) {
+    std::string forcing_file = argv[i];
+
+    try {
+      struct forcing_data forcing;
+      std::string binary_file;
+
+      if (IsBinaryForcingFile(forcing_file)) {
+	ReadForcingFile(forcing_file, &forcing);
+	ValidateForcingData(&forcing);
+      }
+      else {
+	check_units(forcing_file);
+	ReadForcingFile(forcing_file, &forcing);
+	size_t extension = forcing_file.rfind('.');
+	if (extension != std::string::npos && forcing_file.find('/', extension) != std::string::npos)
+	  extension = std::string::npos;
+	binary_file = forcing_file.substr(0, extension) + ".bin";
+	WriteBinaryForcingFile(binary_file, &forcing);
+      }
+
+      size_t num_steps = forcing.time_s.size();
+      std::cout<<forcing_file<<(binary_file.empty() ? "" : " -> " + binary_file)<<" : "<<num_steps<<" entries, "
+	       <<forcing_time_string(forcing.time_s[0])<<" to "<<forcing_time_string(forcing.time_s[num_steps-1])
+	       <<", timestep "<<(num_steps > 1 ? forcing.time_s[1] - forcing.time_s[0] : 0.0)<<" s \n";
+    }
+    catch (const std::runtime_error &e) {
+      std::cerr<<"Invalid forcing file "<<forcing_file<<": "<<e.what()<<"\n";
+      status = FAILURE;
+    }
+  }
+
+  return status;
+}
@@ -0,0 +1,138 @@
+#include "../include/all.hxx"
+
+//#####################################################################################
+/* - The file contains the fixed-capacity, structure-of-arrays wetting front store.
+   - Fronts are stored in parallel arrays indexed by front number (1..num_fronts), so the
+     front number is the array index.
+   - The store is a copy of the fronts, not the working representation: the linked list
+     (see linked_list.cxx, nodes from the per-instance pool) stays primary, and inserting,
+     deleting, merging and renumbering fronts are list operations only. lgar.cxx, aet.cxx
+     and bmi_lgar.cxx work on the list; the repeated front lookups of the move routine go
+     through a pointer index of the list (listIndex) instead of the store.
+   - storeFromList/storeToList are the adapters between the store and the linked list;
+     the store holds the snapshots of the state (rollback, checkpoints, error control). */
+//#####################################################################################
+
+/*#########################################################*/
+/*#########################################################*/
+/*#########################################################*/
+//---------------------------------------------------------
+//
+// wetting    SSS    TTTTTTTTTTT     OOO     RRRRRRR    EEEEEEEE
+//          SSS  SSS     TT        OOO OOO   RR   RRR   EE
+//         SS      SS    TT       OO     OO  RR    RR   EE
+//         SS            TT       OO     OO  RR   RRR   EE
+//          SSSS         TT       OO     OO  RRRRRR     EEEEEE
+//              SSS      TT       OO     OO  RR  RR     EE
+//                SSS    TT       OO     OO  RR   RR    EE
+//         SS      SS    TT       OO     OO  RR    RR   EE
+//          SSS  SSS     TT        OOO OOO   RR     RR  EE
+//            SSSS       TT          OOO     RR     RR  EEEEEEEE  front functions
+//___________________________________________________________
+
+
+/*#######################################################*/
+/* storeLength - number of wetting fronts in the store   */
+/*#######################################################*/
+extern int storeLength(const struct wetting_front_store *store)
+{
+  return store->num_fronts;
+}
+
+/*###############################################################*/
+/* storeFromList() - copies a linked list into the store. This    */
+/* does not allocate; the store has a fixed capacity of           */
+/* MAX_NUM_WETTING_FRONTS fronts                                  */
+/*###############################################################*/
+extern void storeFromList(struct wetting_front* head, struct wetting_front_store *store)
+{
+  int wf = 0;
+
+  for (struct wetting_front *current = head; current != NULL; current = current->next) {
+    wf++;
+    if (wf > MAX_NUM_WETTING_FRONTS) {
+      fprintf(stderr, "ERROR: number of wetting fronts exceeds MAX_NUM_WETTING_FRONTS (%d). Program stopped.\n", MAX_NUM_WETTING_FRONTS);
+      abort();
+    }
+
+    store->depth_cm[wf]      = current->depth_cm;
+    store->theta[wf]         = current->theta;
+    store->psi_cm[wf]        = current->psi_cm;
+    store->K_cm_per_h[wf]    = current->K_cm_per_h;
+    store->layer_num[wf]     = current->layer_num;
+    store->to_bottom[wf]     = current->to_bottom;
+    store->dzdt_cm_per_h[wf] = current->dzdt_cm_per_h;
+  }
+
+  store->num_fronts = wf;
+}
+
+/*###############################################################*/
+/* storeToList() - writes the store back into a linked list. The  */
+/* existing nodes are reused; nodes are only allocated or freed   */
+/* if the number of fronts has changed                            */
+/*###############################################################*/
+extern void storeToList(const struct wetting_front_store *store, struct wetting_front** head, struct wetting_front_pool *pool)
+{
+  struct wetting_front **link = head;
+
+  for (int wf = 1; wf <= store->num_fronts; wf++) {
+    if (*link == NULL) {
+      *link = poolAlloc(pool);
+      (*link)->next = NULL;
+    }
+
+    struct wetting_front *current = *link;
+    current->depth_cm      = store->depth_cm[wf];
+    current->theta         = store->theta[wf];
+    current->psi_cm        = store->psi_cm[wf];
+    current->K_cm_per_h    = store->K_cm_per_h[wf];
+    current->layer_num     = store->layer_num[wf];
+    current->front_num     = wf;
+    current->to_bottom     = store->to_bottom[wf];
+    current->dzdt_cm_per_h = store->dzdt_cm_per_h[wf];
+
+    link = &current->next;
+  }
+
+  // the store has fewer fronts than the list, release the tail
+  listDelete(*link, pool);
+  *link = NULL;
+}
+
+/*##################################################################*/
+/* storeGetFront - copies front wf of the store into a wetting_front */
+/* struct (next is set to NULL) so that routines written for a list  */
+/* node can be used on the store; returns front                      */
+/*##################################################################*/
+extern struct wetting_front* storeGetFront(const struct wetting_front_store *store, int wf, struct wetting_front *front)
+{
+  front->depth_cm      = store->depth_cm[wf];
+  front->theta         = store->theta[wf];
+  front->psi_cm        = store->psi_cm[wf];
+  front->K_cm_per_h    = store->K_cm_per_h[wf];
+  front->layer_num     = store->layer_num[wf];
+  front->front_num     = wf;
+  front->to_bottom     = store->to_bottom[wf];
+  front->dzdt_cm_per_h = store->dzdt_cm_per_h[wf];
+  front->next          = NULL;
+
+  return front;
+}
+
+/*####################################################################*/
+/* snapshotTake - copies the current state (linked list) into the     */
+/* buffer of the snapshot that does not hold the latest snapshot and  */
+/* swaps the buffers. No memory is allocated; the snapshot taken      */
+/* before stays valid in the other buffer until the next call         */
+/* returns the new snapshot                                           */
+/*####################################################################*/
+extern const struct wetting_front_store* snapshotTake(struct wetting_front* head, struct wetting_front_snapshot *snapshot)
+{
+  int back = (snapshot->latest == 0) ? 1 : 0;
+
+  storeFromList(head, &snapshot->buffer[back]);
+  snapshot->latest = back;
+
+  return &snapshot->buffer[back];
+}
@@ -0,0 +1,378 @@
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include "../include/lasam_ensemble.hxx"
+
+//#####################################################################################
+/* - The file contains the ensemble runner, which advances many independent LASAM
+     instances (catchments) to a common time on a pool of threads.
+   - Scheduling: at the start of a run the catchments are dealt to the threads in order
+     of decreasing cost of the previous run (round robin), and a thread that runs out of
+     work steals from the back of the other threads' queues. The expensive catchments
+     (e.g. a storm with many wetting fronts) are thus started first and the cheap ones
+     (e.g. dry columns on the flux caching path) fill the gaps at the end.
+   - Each catchment is advanced by one thread at a time and the instances share no
+     state, so the results are the same for any number of threads.
+   - Parameter ensembles (e.g. calibration trials) are members of one catchment that
+     differ in their parameters only; the forcing is read once and shared read-only
+     by the members, and only the selected outputs are recorded (no output files). */
+//#####################################################################################
+
+
+LasamEnsemble::
+LasamEnsemble(int num_threads)
+{
+  if (num_threads <= 0)
+    num_threads = std::max(1, (int)std::thread::hardware_concurrency());
+  this->num_threads = num_threads;
+
+  for (int i=0; i<num_threads; i++)
+    queues.emplace_back(new work_queue);
+
+  for (int i=1; i<num_threads; i++)
+    workers.emplace_back(&LasamEnsemble::worker_loop, this, i);
+}
+
+
+LasamEnsemble::
+~LasamEnsemble()
+{
+  {
+    std::lock_guard<std::mutex> guard(pool_lock);
+    stopping = true;
+  }
+  run_started.notify_all();
+
+  for (auto &worker : workers)
+    worker.join();
+}
+
+
+/*
+  Initializes a catchment from its config file. If read_forcing is true, the forcing of the forcing_file in the config
+  file is read and attached to the catchment (as a forcing series, see BmiLGAR::SetForcingSeries), otherwise the caller
+  supplies the forcing through GetCatchment(index).
+*/
+int LasamEnsemble::
+AddCatchment(std::string config_file, bool read_forcing)
+{
+  models.emplace_back(new BmiLGAR);
+  BmiLGAR *model = models.back().get();
+  model->Initialize(config_file);
+
+  forcing.emplace_back();
+  if (read_forcing) {
+    forcing.back() = read_forcing_series(config_file);
+    model->SetForcingSeries(forcing.back()->precipitation_mm_per_h, forcing.back()->PET_mm_per_h,
+			    (int)forcing.back()->num_steps);
+  }
+
+  stats.emplace_back();
+  recorded_series.emplace_back(recorded_names.size());
+  recorded_sums.emplace_back(recorded_names.size(), 0.0);
+  return (int)models.size() - 1;
+}
+
+
+/*
+  Initializes one member per parameter set (e.g. the trials of a calibration) from the same config file. The forcing
+  is read once and all members read it from the same (read-only) series. The parameters are set through the BMI and
+  applied at the first update, as with calib_params=true in the config file.
+*/
+int LasamEnsemble::
+AddParameterEnsemble(std::string config_file, const std::vector<std::string> &parameter_names,
+		     const std::vector<std::vector<double>> &parameter_sets)
+{
+  for (const auto &parameters : parameter_sets) {
+    if (parameters.size() != parameter_names.size()) {
+      std::stringstream errMsg;
+      errMsg << "parameter set has " << parameters.size() << " values, expected " << parameter_names.size();
+      throw std::runtime_error(errMsg.str());
+    }
+  }
+
+  std::shared_ptr<struct forcing_series> series = read_forcing_series(config_file);
+  int first = (int)models.size();
+
+  for (const auto &parameters : parameter_sets) {
+    int member = AddCatchment(config_file, false);
+    BmiLGAR *model = models[member].get();
+
+    for (size_t i=0; i<parameter_names.size(); i++) {
+      double value = parameters[i];
+      model->SetValue(parameter_names[i], &value);
+    }
+    model->get_model()->lgar_bmi_params.calib_params_flag = true;
+
+    forcing[member] = series;
+    model->SetForcingSeries(series->precipitation_mm_per_h, series->PET_mm_per_h, (int)series->num_steps);
+  }
+
+  return first;
+}
+
+
+/*
+  Records the given output variables (scalars, e.g. "total_discharge") of every catchment after each timestep. The sum
+  over the run is always kept, the series only if keep_series is true. Resets the recordings of previous calls.
+*/
+void LasamEnsemble::
+RecordOutputs(const std::vector<std::string> &names, bool keep_series)
+{
+  if (models.empty())
+    throw std::runtime_error("RecordOutputs: add the catchments before selecting the outputs");
+
+  recorded_handles.clear();
+  for (const auto &name : names) {
+    if (models.front()->GetVarGrid(name) != 1)
+      throw std::runtime_error("RecordOutputs: variable " + name + " is not a scalar double");
+    recorded_handles.push_back(models.front()->GetVarHandle(name));
+  }
+
+  recorded_names       = names;
+  keep_recorded_series = keep_series;
+  recorded_series.assign(models.size(), std::vector<std::vector<double>>(names.size()));
+  recorded_sums.assign(models.size(), std::vector<double>(names.size(), 0.0));
+}
+
+
+/*
+  Advances all catchments until time t. Rethrows the first exception thrown by a catchment, after all threads are done.
+*/
+void LasamEnsemble::
+UpdateUntil(double t)
+{
+  // deal the catchments to the threads, most expensive (in the previous run) first
+  std::vector<int> order(models.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+		   [this](int a, int b) { return stats[a].seconds_last > stats[b].seconds_last; });
+
+  for (int i=0; i<(int)order.size(); i++)
+    queues[i % num_threads]->catchments.push_back(order[i]);
+
+  error = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(pool_lock);
+    target_time_s = t;
+    num_running   = num_threads - 1;
+    run_number++;
+  }
+  run_started.notify_all();
+
+  run_queues(0);
+
+  {
+    std::unique_lock<std::mutex> guard(pool_lock);
+    run_finished.wait(guard, [this] { return num_running == 0; });
+  }
+
+  if (error)
+    std::rethrow_exception(error);
+}
+
+
+void LasamEnsemble::
+Finalize()
+{
+  for (auto &model : models)
+    model->Finalize();
+}
+
+
+int LasamEnsemble::
+GetNumCatchments()
+{
+  return (int)models.size();
+}
+
+
+int LasamEnsemble::
+GetNumThreads()
+{
+  return num_threads;
+}
+
+
+BmiLGAR* LasamEnsemble::
+GetCatchment(int index)
+{
+  return models.at(index).get();
+}
+
+
+const struct ensemble_catchment_stats& LasamEnsemble::
+GetCatchmentStats(int index)
+{
+  return stats.at(index);
+}
+
+
+long LasamEnsemble::
+GetNumSteals()
+{
+  std::lock_guard<std::mutex> guard(counters_lock);
+  return num_steals;
+}
+
+
+const std::vector<double>& LasamEnsemble::
+GetRecordedSeries(int index, std::string name)
+{
+  return recorded_series.at(index)[recorded_index(name)];
+}
+
+
+double LasamEnsemble::
+GetRecordedSum(int index, std::string name)
+{
+  return recorded_sums.at(index)[recorded_index(name)];
+}
+
+
+int LasamEnsemble::
+recorded_index(std::string name)
+{
+  auto it = std::find(recorded_names.begin(), recorded_names.end(), name);
+  if (it == recorded_names.end())
+    throw std::runtime_error("variable " + name + " is not recorded");
+  return (int)(it - recorded_names.begin());
+}
+
+
+// opens the forcing of the forcing_file in the config file (mapped if it is a binary forcing file); catchments with the
+// same forcing file share one series, which is opened once and stays open as long as the ensemble
+std::shared_ptr<struct forcing_series> LasamEnsemble::
+read_forcing_series(std::string config_file)
+{
+  std::string forcing_file = GetForcingFile(config_file);
+  std::shared_ptr<struct forcing_series> &series = forcing_files[forcing_file];
+  if (series)
+    return series;
+
+  std::shared_ptr<struct forcing_series> opened(new forcing_series(), [](struct forcing_series *s) {
+    CloseForcingSeries(s);
+    delete s;
+  });
+  OpenForcingSeries(forcing_file, opened.get());
+  series = opened;
+  return series;
+}
+
+
+// loop of the pool threads: wait for a run, work on the queues, report the end of the run
+void LasamEnsemble::
+worker_loop(int thread_num)
+{
+  long runs_done = 0;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> guard(pool_lock);
+      run_started.wait(guard, [&] { return stopping || run_number != runs_done; });
+      if (stopping)
+	return;
+      runs_done = run_number;
+    }
+
+    run_queues(thread_num);
+
+    {
+      std::lock_guard<std::mutex> guard(pool_lock);
+      num_running--;
+    }
+    run_finished.notify_one();
+  }
+}
+
+
+void LasamEnsemble::
+run_queues(int thread_num)
+{
+  int catchment;
+  while (next_catchment(thread_num, &catchment)) {
+    try {
+      advance_catchment(catchment);
+    }
+    catch (...) {
+      std::lock_guard<std::mutex> guard(counters_lock);
+      if (!error)
+	error = std::current_exception();
+    }
+  }
+}
+
+
+// takes the next catchment from the front of the thread's own queue, or steals one from the back of another queue
+bool LasamEnsemble::
+next_catchment(int thread_num, int *catchment)
+{
+  {
+    work_queue &own = *queues[thread_num];
+    std::lock_guard<std::mutex> guard(own.lock);
+    if (!own.catchments.empty()) {
+      *catchment = own.catchments.front();
+      own.catchments.pop_front();
+      return true;
+    }
+  }
+
+  for (int i=1; i<num_threads; i++) {
+    work_queue &victim = *queues[(thread_num + i) % num_threads];
+    std::lock_guard<std::mutex> guard(victim.lock);
+    if (!victim.catchments.empty()) {
+      *catchment = victim.catchments.back();
+      victim.catchments.pop_back();
+
+      std::lock_guard<std::mutex> steal_guard(counters_lock);
+      num_steals++;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+void LasamEnsemble::
+advance_catchment(int catchment)
+{
+  auto start = std::chrono::steady_clock::now();
+
+  BmiLGAR *model = models[catchment].get();
+  if (recorded_handles.empty())
+    model->UpdateUntil(target_time_s);
+  else
+    record_outputs(catchment);
+
+  struct ensemble_catchment_stats &s = stats[catchment];
+  s.seconds_last        = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  s.seconds_total      += s.seconds_last;
+  s.num_updates        ++;
+  s.max_wetting_fronts  = std::max(s.max_wetting_fronts, model->get_model()->lgar_bmi_params.num_wetting_fronts);
+}
+
+
+// advances a catchment one timestep at a time until the target time, recording the selected outputs after each step
+void LasamEnsemble::
+record_outputs(int catchment)
+{
+  BmiLGAR *model = models[catchment].get();
+  double timestep_s = model->GetTimeStep();
+
+  while (true) {
+    double time_s = model->GetCurrentTime();
+    model->UpdateUntil(std::min(time_s + timestep_s, target_time_s));
+    if (model->GetCurrentTime() == time_s)
+      break;  // target (or end time) reached
+
+    for (size_t i=0; i<recorded_handles.size(); i++) {
+      double value;
+      model->GetValueByHandle(recorded_handles[i], &value);
+      recorded_sums[catchment][i] += value;
+      if (keep_recorded_series)
+	recorded_series[catchment][i].push_back(value);
+    }
+  }
+}
@@ -63,11 +63,14 @@ using namespace std;
 #define THRESHOLD_NO_MOISTURE_DIFF 1.E-15      // threshold that will be used to check if adjacent WFs are redundant
 #define MBAL_ITERATIVE_TOLERANCE 1.E-10        // in the loops that close mass balance across multiple layers, the before and after masses (considering fluxes as well) must match by this number or less
 #define MAX_ITER_MBAL_LOOP 1.E5                // the loop that adjusts theta after WFs move (shich that psi will be equal across soil layer boundaries) will iterate this many times before accepting a mass balance error.
-#define MAX_ITER_SATURATION_MBAL_LOOP 1.E4     // the loop that adjusts the depth of a saturated WF after the WF becomes saturated to conserve mass has this maximum number of iterations before it just accepts that there will be a mass balance error
 #define TRUNCATION_DEPTH 1.E-9                 // when a WF exceeds the lower boundary, we want it to only slightly do this in order to keep the lower boundary condition effectively no flow but also correctly set psi for WFs that it passed
 #define FACTOR_LIMITS_LAYER_CROSSING_SPEED 2.0 // when a WF crosses a layer boundary, it shouldn't go too far into the next layer -- for example in the case of sand over clay, a WF in sand might have a large dzdt value that leads to crossing to an unrealistic depth in the clay below
 #define DEPTH_AVOIDS_SAME_WF_DEPTH 1.E-6       // in the event that multiple WFs all would cross a layer boundary and would each have their depth in the new layer limited by FACTOR_LIMITS_LAYER_CROSSING_SPEED, this just prevents these WFs from being exactly at the same depth.
 #define PSI_UPPER_LIM 1.E7                     // in loops that close the mass balance by iterating theta and psi, we impose an upper limit on capillary head because some values are just not physically realistic
+#define PSI_MAX_CM 1.E20                       // largest capillary head of the soil relations (calc_h_from_Se() caps h there)
+#define SUBSTEP_SAFETY 0.9                     // the error-controlled adaptive timestep aims a bit below the tolerance so that the next substep is less likely to be rejected
+#define SUBSTEP_MAX_GROWTH 2.0                 // the error-controlled adaptive timestep never grows a substep by more than this factor at once
+#define SUBSTEP_MAX_SHRINK 0.25                // and never shrinks it by more than this factor at once
 
 
 // ############################################################################################
@@ -88,9 +91,11 @@ extern void lgar_initialize(string config_file, struct model_state *state)
     state->lgar_bmi_params.shape[1] = state->lgar_bmi_params.num_wetting_fronts;
 
     // initial number of wetting fronts are same are number of layers
+    // the wetting front outputs are allocated once to full capacity, only the first num_wetting_fronts entries are valid;
+    // this keeps the pointers returned by GetValuePtr valid for the life of the model
     state->lgar_bmi_params.num_wetting_fronts           = state->lgar_bmi_params.num_layers;
-    state->lgar_bmi_params.soil_depth_wetting_fronts    = new double[state->lgar_bmi_params.num_wetting_fronts];
-    state->lgar_bmi_params.soil_moisture_wetting_fronts = new double[state->lgar_bmi_params.num_wetting_fronts];
+    state->lgar_bmi_params.soil_depth_wetting_fronts    = new double[MAX_NUM_WETTING_FRONTS];
+    state->lgar_bmi_params.soil_moisture_wetting_fronts = new double[MAX_NUM_WETTING_FRONTS];
 
     // initialize array for holding calibratable parameters
     // calibratabale parameters are scalars now not arrays
@@ -253,9 +258,20 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
     param_value = line.substr(loc_eq,loc_u - loc_eq);
 
     if (param_key == "verbosity") {
-      verbosity = param_value;
-      if (verbosity.compare("none") != 0) {
-	std::cerr<<"Verbosity is set to \' "<<verbosity<<"\' \n";
+      if (param_value == "none")
+	state->verbosity = VERBOSITY_NONE;
+      else if (param_value == "low")
+	state->verbosity = VERBOSITY_LOW;
+      else if (param_value == "high")
+	state->verbosity = VERBOSITY_HIGH;
+      else {
+	std::cerr<<"Invalid option: verbosity must be none, low, or high. \n";
+	abort();
+      }
+      verbosity = state->verbosity;
+
+      if (LGAR_LOG_LOW) {
+	std::cerr<<"Verbosity is set to \' "<<param_value<<"\' \n";
 	std::cerr<<"          *****         \n";
       }
 
@@ -268,17 +284,27 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
   fp.clear();
   fp.seekg(0, fp.beg);
 
-  if (verbosity.compare("none") != 0) {
+  if (LGAR_LOG_LOW) {
     std::cerr<<"------------- Initialization from config file ---------------------- \n";
   }
 
   // setting these options to false (defualt) 
   state->lgar_bmi_params.sft_coupled           = false;
   state->lgar_bmi_params.use_closed_form_G     = false;
+  state->lgar_bmi_params.use_vG_tables         = false;
+  state->lgar_bmi_params.vG_table_tolerance    = 1.E-10;
+  state->lgar_bmi_params.use_Geff_table        = false;
+  state->Geff_quadrature.rule                  = GEFF_QUADRATURE_TRAPEZOID;
+  state->Geff_quadrature.num_integrals         = 0;
+  state->Geff_quadrature.num_evals             = 0;
   state->lgar_bmi_params.adaptive_timestep     = false;
+  state->lgar_bmi_params.adaptive_error_control = false;
+  state->lgar_bmi_params.adaptive_front_tol_cm  = 0.1;
+  state->lgar_bmi_params.adaptive_mbal_tol_cm   = 1.E-6;
   state->lgar_bmi_params.runoff_in_prev_step   = false;
   state->lgar_bmi_params.PET_affects_precip    = false;
   state->lgar_bmi_params.allow_flux_caching    = false;
+  state->lgar_bmi_params.flux_caching_fast_forward = false;
   state->lgar_bmi_params.log_mode              = false;
   state->lgar_bmi_params.free_drainage_enabled = false;
   state->lgar_bmi_params.free_drainage_to_CR   = false;
@@ -309,6 +335,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
   bool is_giuh_ordinates_set        = false;
   bool is_soil_z_set                = false;
   bool is_ponded_depth_max_cm_set   = false;
+  bool is_maximum_timestep_set      = false;
 
   string soil_params_file;
 
@@ -355,7 +382,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
       state->lgar_bmi_params.soil_depth_cm = state->lgar_bmi_params.cum_layer_thickness_cm[state->lgar_bmi_params.num_layers];
       is_layer_thickness_set = true;
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	std::cerr<<"Number of layers : "<<state->lgar_bmi_params.num_layers<<"\n";
 	for (int i=1; i<=state->lgar_bmi_params.num_layers; i++)
 	  std::cerr<<"Thickness, cum. depth : "<<state->lgar_bmi_params.layer_thickness_cm[i]<<" , "
@@ -387,7 +414,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
 
       is_giuh_ordinates_set = true;
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	for (unsigned int i=1; i <= vec.size(); i++)
 	  std::cerr<<"GIUH ordinates (hourly) : "<<giuh_ordinates_temp[i]<<"\n";
 
@@ -408,7 +435,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
 
       is_soil_z_set = true;
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	for (int i=0; i<state->lgar_bmi_params.num_cells_temp; i++)
 	  std::cerr<<"Soil z (temperature resolution) : "<<state->lgar_bmi_params.soil_temperature_z[i]<<"\n";
 
@@ -421,7 +448,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
       state->lgar_bmi_params.initial_psi_cm = stod(param_value);
       is_initial_psi_set = true;
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	std::cerr<<"Initial Psi : "<<state->lgar_bmi_params.initial_psi_cm<<"\n";
 	std::cerr<<"          *****         \n";
       }
@@ -437,7 +464,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
       soil_params_file = param_value;
       is_soil_params_file_set = true;
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	std::cerr<<"Soil paramaters file : "<<soil_params_file<<"\n";
 	std::cerr<<"          *****         \n";
       }
@@ -448,7 +475,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
       state->lgar_bmi_params.wilting_point_psi_cm = stod(param_value);
       is_wilting_point_psi_cm_set = true;
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	std::cerr<<"Wilting point Psi [cm] : "<<state->lgar_bmi_params.wilting_point_psi_cm<<"\n";
 	std::cerr<<"          *****         \n";
       }
@@ -459,7 +486,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
       state->lgar_bmi_params.field_capacity_psi_cm = stod(param_value);
       is_field_capacity_psi_cm_set = true;
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	std::cerr<<"Field capacity Psi [cm] : "<<state->lgar_bmi_params.field_capacity_psi_cm<<"\n";
 	std::cerr<<"          *****         \n";
       }
@@ -470,7 +497,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
       state->lgar_bmi_params.a_con_res = stod(param_value);
       is_a_con_res_set = true;
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	std::cerr<<"a_con_res"<<(param_key == "a" ? " (using old name in config)" : "")<<" : "<<state->lgar_bmi_params.a_con_res<<"\n";
 	std::cerr<<"          *****         \n";
       }
@@ -480,7 +507,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
       state->lgar_bmi_params.b_con_res = stod(param_value);
       is_b_con_res_set = true;
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	std::cerr<<"b_con_res"<<(param_key == "b" ? " (using old name in config)" : "")<<" : "<<state->lgar_bmi_params.b_con_res<<"\n";
 	std::cerr<<"          *****         \n";
       }
@@ -490,7 +517,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
       state->lgar_bmi_params.frac_to_CR = stod(param_value);
       is_frac_to_CR_set = true;
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	std::cerr<<"frac_to_CR : "<<state->lgar_bmi_params.frac_to_CR<<"\n";
 	std::cerr<<"          *****         \n";
       }
@@ -500,7 +527,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
       state->lgar_bmi_params.a_con_res_slow = stod(param_value);
       is_a_con_res_slow_set = true;
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	std::cerr<<"a_con_res_slow"<<(param_key == "a_slow" ? " (using old name in config)" : "")<<" : "<<state->lgar_bmi_params.a_con_res_slow<<"\n";
 	std::cerr<<"          *****         \n";
       }
@@ -510,7 +537,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
       state->lgar_bmi_params.b_con_res_slow = stod(param_value);
       is_b_con_res_slow_set = true;
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	std::cerr<<"b_con_res_slow"<<(param_key == "b_slow" ? " (using old name in config)" : "")<<" : "<<state->lgar_bmi_params.b_con_res_slow<<"\n";
 	std::cerr<<"          *****         \n";
       }
@@ -520,7 +547,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
       state->lgar_bmi_params.frac_slow = stod(param_value);
       is_frac_slow_set = true;
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	std::cerr<<"frac_slow : "<<state->lgar_bmi_params.frac_slow<<"\n";
 	std::cerr<<"          *****         \n";
       }
@@ -530,7 +557,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
       state->lgar_bmi_params.interflow_psi_threshold_cm = stod(param_value);
       is_interflow_psi_threshold_set = true;
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	std::cerr<<"interflow_psi_threshold"<<(param_key.rfind("lateral_flow", 0) == 0 ? " (using old name in config)" : "")<<" [cm] : "<<state->lgar_bmi_params.interflow_psi_threshold_cm<<"\n";
 	std::cerr<<"          *****         \n";
       }
@@ -540,7 +567,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
       state->lgar_bmi_params.interflow_factor = stod(param_value);
       is_interflow_factor_set = true;
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	std::cerr<<"interflow_factor"<<(param_key == "lateral_flow_factor" ? " (using old name in config)" : "")<<" : "<<state->lgar_bmi_params.interflow_factor<<"\n";
 	std::cerr<<"          *****         \n";
       }
@@ -550,7 +577,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
       state->lgar_bmi_params.frac_to_CR = stod(param_value);
       is_frac_to_CR_set = true;
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	std::cerr<<"frac_to_CR (using old name in config): "<<state->lgar_bmi_params.frac_to_CR<<"\n";
 	std::cerr<<"          *****         \n";
       }
@@ -559,7 +586,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
     else if (param_key == "spf_factor") {
       state->lgar_bmi_params.spf_factor = stod(param_value);
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	std::cerr<<"spf_factor : "<<state->lgar_bmi_params.spf_factor<<"\n";
 	std::cerr<<"          *****         \n";
       }
@@ -579,6 +606,66 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
 
       continue;
     }
+    else if (param_key == "use_vG_tables") {
+      if (param_value == "false") {
+        state->lgar_bmi_params.use_vG_tables = false;
+      }
+      else if (param_value == "true") {
+        state->lgar_bmi_params.use_vG_tables = true;
+      }
+      else {
+	std::cerr<<"Invalid option: use_vG_tables must be true or false. \n";
+        abort();
+      }
+
+      continue;
+    }
+    else if (param_key == "vG_table_tolerance") {
+      state->lgar_bmi_params.vG_table_tolerance = stod(param_value);
+
+      if (state->lgar_bmi_params.vG_table_tolerance <= 0.0) {
+	stringstream errMsg;
+	errMsg << "The configuration file \'" << config_file <<"\' sets vG_table_tolerance <= 0. \n";
+	throw runtime_error(errMsg.str());
+      }
+
+      if (LGAR_LOG_HIGH) {
+	std::cerr<<"Lookup table tolerance : "<<state->lgar_bmi_params.vG_table_tolerance<<"\n";
+	std::cerr<<"          *****         \n";
+      }
+      continue;
+    }
+    else if (param_key == "use_Geff_table") {
+      if (param_value == "false") {
+        state->lgar_bmi_params.use_Geff_table = false;
+      }
+      else if (param_value == "true") {
+        state->lgar_bmi_params.use_Geff_table = true;
+      }
+      else {
+	std::cerr<<"Invalid option: use_Geff_table must be true or false. \n";
+        abort();
+      }
+
+      continue;
+    }
+    else if (param_key == "Geff_quadrature") {
+      if (param_value == "trapezoid") {
+        state->Geff_quadrature.rule = GEFF_QUADRATURE_TRAPEZOID;
+      }
+      else if (param_value == "gauss_legendre") {
+        state->Geff_quadrature.rule = GEFF_QUADRATURE_GAUSS_LEGENDRE;
+      }
+      else if (param_value == "tanh_sinh") {
+        state->Geff_quadrature.rule = GEFF_QUADRATURE_TANH_SINH;
+      }
+      else {
+	std::cerr<<"Invalid option: Geff_quadrature must be trapezoid, gauss_legendre, or tanh_sinh. \n";
+        abort();
+      }
+
+      continue;
+    }
     else if (param_key == "free_drainage_enabled") { 
       if (param_value == "false") {
         state->lgar_bmi_params.free_drainage_enabled = false;
@@ -635,13 +722,91 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
 
       continue;
     }
+    else if (param_key == "flux_caching_method") {
+      if (param_value == "freeze") {
+        state->lgar_bmi_params.flux_caching_fast_forward = false;
+      }
+      else if (param_value == "fast_forward") {
+        state->lgar_bmi_params.flux_caching_fast_forward = true;
+      }
+      else {
+	std::cerr<<"Invalid option: flux_caching_method must be freeze or fast_forward. \n";
+        abort();
+      }
+
+      continue;
+    }
+    else if (param_key == "flux_caching_precip_threshold") {
+      state->flux_caching.precip_threshold_mm_per_h = stod(param_value);
+      assert (state->flux_caching.precip_threshold_mm_per_h >= 0.0);
+      continue;
+    }
+    else if (param_key == "flux_caching_AET_PET_ratio_threshold") {
+      state->flux_caching.AET_PET_ratio_threshold = stod(param_value);
+      assert (state->flux_caching.AET_PET_ratio_threshold >= 0.0);
+      continue;
+    }
+    else if (param_key == "flux_caching_ponded_depth_threshold") {
+      state->flux_caching.ponded_depth_threshold_cm = stod(param_value);
+      assert (state->flux_caching.ponded_depth_threshold_cm >= 0.0);
+      continue;
+    }
+    else if (param_key == "flux_caching_bottom_flux_threshold") {
+      state->flux_caching.bottom_flux_threshold_cm = stod(param_value);
+      assert (state->flux_caching.bottom_flux_threshold_cm >= 0.0);
+      continue;
+    }
+    else if (param_key == "flux_caching_dzdt_threshold") {
+      state->flux_caching.dzdt_threshold_cm_per_h = stod(param_value);
+      assert (state->flux_caching.dzdt_threshold_cm_per_h >= 0.0);
+      continue;
+    }
+    else if (param_key == "flux_caching_horizon") {
+      state->flux_caching.horizon = stoi(param_value);
+      assert (state->flux_caching.horizon >= 1);
+      continue;
+    }
+    else if (param_key == "flux_caching_adaptive_horizon") {
+      if (param_value == "false") {
+        state->flux_caching.adaptive_horizon = false;
+      }
+      else if (param_value == "true") {
+        state->flux_caching.adaptive_horizon = true;
+      }
+      else {
+	std::cerr<<"Invalid option: flux_caching_adaptive_horizon must be true or false. \n";
+        abort();
+      }
+
+      continue;
+    }
+    else if (param_key == "flux_caching_min_horizon") {
+      state->flux_caching.min_horizon = stoi(param_value);
+      assert (state->flux_caching.min_horizon >= 1);
+      continue;
+    }
+    else if (param_key == "flux_caching_max_horizon") {
+      state->flux_caching.max_horizon = stoi(param_value);
+      assert (state->flux_caching.max_horizon >= 1);
+      continue;
+    }
+    else if (param_key == "flux_caching_storage_drift_tol") {
+      state->flux_caching.storage_drift_tol_cm = stod(param_value);
+      assert (state->flux_caching.storage_drift_tol_cm > 0.0);
+      continue;
+    }
+    else if (param_key == "flux_caching_dzdt_drift_tol") {
+      state->flux_caching.dzdt_drift_tol = stod(param_value);
+      assert (state->flux_caching.dzdt_drift_tol > 0.0);
+      continue;
+    }
     else if (param_key == "log_mode") { 
       if ((param_value == "false") || (param_value == "0")) {
         state->lgar_bmi_params.log_mode = false;
       }
       else if ( (param_value == "true") || (param_value == "1")) {
         state->lgar_bmi_params.log_mode = true;
-        if (verbosity.compare("high") == 0) {
+        if (LGAR_LOG_HIGH) {
           printf("log_mode enabled. So K_s for each layer, alpha for each layer, a_con_res for the nonlinear reservoir(s), interflow_psi_threshold, and interflow_factor will use the log of their input values. \n");
         }
       }
@@ -655,7 +820,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
     else if (param_key == "mbal_tol") {
       state->lgar_bmi_params.mbal_tol = stod(param_value);
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	std::cerr<<"Mass balance tolerance [cm] : "<<state->lgar_bmi_params.mbal_tol<<"\n";
 	std::cerr<<"          *****         \n";
       }
@@ -676,6 +841,63 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
 
       continue;
     }
+    else if (param_key == "adaptive_timestep_method") {
+      if (param_value == "precip_threshold") {
+        state->lgar_bmi_params.adaptive_error_control = false;
+      }
+      else if (param_value == "error_control") {
+        state->lgar_bmi_params.adaptive_error_control = true;
+      }
+      else {
+	std::cerr<<"Invalid option: adaptive_timestep_method must be precip_threshold or error_control. \n";
+        abort();
+      }
+
+      continue;
+    }
+    else if (param_key == "maximum_timestep") {
+      state->lgar_bmi_params.maximum_timestep_h = stod(param_value);
+
+      if (param_unit == "[s]" || param_unit == "[sec]" || param_unit == "") // defalut time unit is seconds
+	state->lgar_bmi_params.maximum_timestep_h /= 3600; // convert to hours
+      else if (param_unit == "[min]" || param_unit == "[minute]")
+	state->lgar_bmi_params.maximum_timestep_h /= 60; // convert to hours
+      else if (param_unit == "[h]" || param_unit == "[hr]")
+	state->lgar_bmi_params.maximum_timestep_h /= 1.0; // convert to hours
+
+      assert (state->lgar_bmi_params.maximum_timestep_h > 0);
+      is_maximum_timestep_set = true;
+
+      if (LGAR_LOG_HIGH) {
+	std::cerr<<"Maximum timestep [hours,seconds]: "<<state->lgar_bmi_params.maximum_timestep_h<<" , "
+		 <<state->lgar_bmi_params.maximum_timestep_h*3600<<"\n";
+	std::cerr<<"          *****         \n";
+      }
+
+      continue;
+    }
+    else if (param_key == "adaptive_front_tol") {
+      state->lgar_bmi_params.adaptive_front_tol_cm = stod(param_value);
+      assert (state->lgar_bmi_params.adaptive_front_tol_cm > 0);
+
+      if (LGAR_LOG_HIGH) {
+	std::cerr<<"Adaptive timestep wetting front depth tolerance [cm] : "<<state->lgar_bmi_params.adaptive_front_tol_cm<<"\n";
+	std::cerr<<"          *****         \n";
+      }
+
+      continue;
+    }
+    else if (param_key == "adaptive_mbal_tol") {
+      state->lgar_bmi_params.adaptive_mbal_tol_cm = stod(param_value);
+      assert (state->lgar_bmi_params.adaptive_mbal_tol_cm > 0);
+
+      if (LGAR_LOG_HIGH) {
+	std::cerr<<"Adaptive timestep mass balance tolerance [cm] : "<<state->lgar_bmi_params.adaptive_mbal_tol_cm<<"\n";
+	std::cerr<<"          *****         \n";
+      }
+
+      continue;
+    }
     else if (param_key == "timestep") {
       state->lgar_bmi_params.timestep_h = stod(param_value);
 
@@ -691,7 +913,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
 
       state->lgar_bmi_params.minimum_timestep_h = state->lgar_bmi_params.timestep_h;
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	std::cerr<<"Model timestep [hours,seconds]: "<<state->lgar_bmi_params.timestep_h<<" , "
 		 <<state->lgar_bmi_params.timestep_h*3600<<"\n";
 	std::cerr<<"          *****         \n";
@@ -713,7 +935,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
       assert (state->lgar_bmi_params.endtime_s > 0);
       is_endtime_set = true;
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	std::cerr<<"Endtime [days, hours]: "<< state->lgar_bmi_params.endtime_s/86400.0 <<" , "
 		 << state->lgar_bmi_params.endtime_s/3600.0<<"\n";
 	std::cerr<<"          *****         \n";
@@ -734,7 +956,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
       assert (state->lgar_bmi_params.forcing_resolution_h > 0);
       is_forcing_resolution_set = true;
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	std::cerr<<"Forcing resolution [hours]: "<<state->lgar_bmi_params.forcing_resolution_h<<"\n";
 	std::cerr<<"          *****         \n";
       }
@@ -759,7 +981,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
       state->lgar_bmi_params.ponded_depth_max_cm = fmax(stod(param_value), 0.0);
       is_ponded_depth_max_cm_set = true;
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	std::cerr<<"Maximum ponded depth [cm] : "<<state->lgar_bmi_params.ponded_depth_max_cm<<"\n";
 	std::cerr<<"          *****         \n";
       }
@@ -784,25 +1006,50 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
 
   fp.close();
 
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     std::string flag = state->lgar_bmi_params.use_closed_form_G == true ? "Yes" : "No";
     std::cerr<<"Using closed_form_G? "<< flag <<"\n";
     std::cerr<<"          *****         \n";
   }
 
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
+    std::string flag = state->lgar_bmi_params.use_vG_tables == true ? "Yes" : "No";
+    std::cerr<<"Using lookup tables for van Genuchten relations? "<< flag <<"\n";
+    std::cerr<<"          *****         \n";
+  }
+
+  if (LGAR_LOG_HIGH) {
+    std::string flag = (state->lgar_bmi_params.use_Geff_table && !state->lgar_bmi_params.use_closed_form_G) ? "Yes" : "No";
+    std::cerr<<"Using precomputed cumulative integral for numeric Geff? "<< flag <<"\n";
+    const char *rule_name[] = {"trapezoid", "gauss_legendre", "tanh_sinh"};
+    std::cerr<<"Quadrature rule for numeric Geff: "<< rule_name[state->Geff_quadrature.rule] <<"\n";
+    std::cerr<<"          *****         \n";
+  }
+
+  if (LGAR_LOG_HIGH) {
     std::string flag = state->lgar_bmi_params.PET_affects_precip == true ? "Yes" : "No";
     std::cerr<<"Does AET reduce precip? "<< flag <<"\n";
     std::cerr<<"          *****         \n";
   }
 
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     std::string flag = state->lgar_bmi_params.allow_flux_caching == true ? "Yes" : "No";
     std::cerr<<"Will fluxes be cached and used for subsequent time steps rather than computed during dry conditions? "<< flag <<"\n";
+    if (state->lgar_bmi_params.allow_flux_caching) {
+      std::string method = state->lgar_bmi_params.flux_caching_fast_forward == true ? "fast_forward" : "freeze";
+      std::string adaptive = state->flux_caching.adaptive_horizon == true ? "Yes" : "No";
+      std::cerr<<"Flux caching method: "<< method <<"\n";
+      std::cerr<<"Flux caching thresholds: precip [mm/h] = "<< state->flux_caching.precip_threshold_mm_per_h
+	       <<", AET/PET = "<< state->flux_caching.AET_PET_ratio_threshold
+	       <<", ponded depth [cm] = "<< state->flux_caching.ponded_depth_threshold_cm
+	       <<", bottom flux [cm] = "<< state->flux_caching.bottom_flux_threshold_cm
+	       <<", dzdt [cm/h] = "<< state->flux_caching.dzdt_threshold_cm_per_h <<"\n";
+      std::cerr<<"Flux caching horizon [timesteps] = "<< state->flux_caching.horizon <<", adaptive? "<< adaptive <<"\n";
+    }
     std::cerr<<"          *****         \n";
   }
 
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     std::string flag = state->lgar_bmi_params.sft_coupled == true ? "Yes" : "No";
     std::cerr<<"Coupled to SoilFreezeThaw? "<< flag <<"\n";
     std::cerr<<"          *****         \n";
@@ -811,7 +1058,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
   if(!is_max_valid_soil_types_set)
      state->lgar_bmi_params.num_soil_types = MAX_NUM_SOIL_TYPES;     // maximum number of valid soil types defaults to 25
 
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     std::cerr<<"Maximum number of soil types: "<<state->lgar_bmi_params.num_soil_types<<"\n";
     std::cerr<<"          *****         \n";
   }
@@ -881,7 +1128,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
       //assert (state->lgar_bmi_params.layer_soil_type[layer] <= max_num_soil_in_file);
       if (state->lgar_bmi_params.layer_soil_type[layer] > state->lgar_bmi_params.num_soil_types) {
 	state->lgar_bmi_params.is_invalid_soil_type = true;
-	if (verbosity.compare("high") == 0) {
+	if (LGAR_LOG_HIGH) {
 	  std::cerr << "Invalid soil type: "
 		    << state->lgar_bmi_params.layer_soil_type[layer]
 		    <<". Model returns input_precip = ouput_Qout. \n";
@@ -890,7 +1137,9 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
       }
     }
 
-    if ((verbosity.compare("high") == 0) && (!state->lgar_bmi_params.is_invalid_soil_type)) {
+    lgar_build_soil_tables(state);
+
+    if ((LGAR_LOG_HIGH) && (!state->lgar_bmi_params.is_invalid_soil_type)) {
       for (int layer=1; layer<=state->lgar_bmi_params.num_layers; layer++) {
 	int soil = state->lgar_bmi_params.layer_soil_type[layer];
 	std::cerr<<"Soil type/name : "<<state->lgar_bmi_params.layer_soil_type[layer]
@@ -970,6 +1219,34 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
     throw runtime_error(errMsg.str());
   }
 
+  if (state->flux_caching.adaptive_horizon) {
+    if (state->flux_caching.max_horizon < state->flux_caching.min_horizon) {
+      stringstream errMsg;
+      errMsg << "The configuration file \'" << config_file <<"\' sets flux_caching_max_horizon smaller than flux_caching_min_horizon. \n";
+      throw runtime_error(errMsg.str());
+    }
+    state->flux_caching.horizon = std::max(state->flux_caching.min_horizon, std::min(state->flux_caching.max_horizon, state->flux_caching.horizon));
+  }
+
+  // the error-controlled adaptive timestep varies the substep between the (minimum) timestep and maximum_timestep
+  if (!is_maximum_timestep_set)
+    state->lgar_bmi_params.maximum_timestep_h = state->lgar_bmi_params.forcing_resolution_h;
+
+  state->lgar_bmi_params.maximum_timestep_h = fmin(state->lgar_bmi_params.maximum_timestep_h,
+						   state->lgar_bmi_params.forcing_resolution_h);
+
+  if (state->lgar_bmi_params.maximum_timestep_h < state->lgar_bmi_params.minimum_timestep_h) {
+    stringstream errMsg;
+    errMsg << "The configuration file \'" << config_file <<"\' sets maximum_timestep smaller than timestep. \n";
+    throw runtime_error(errMsg.str());
+  }
+
+  if (LGAR_LOG_HIGH) {
+    std::string flag = (state->lgar_bmi_params.adaptive_timestep && state->lgar_bmi_params.adaptive_error_control) ? "Yes" : "No";
+    std::cerr<<"Error-controlled adaptive timestep? "<< flag <<"\n";
+    std::cerr<<"          *****         \n";
+  }
+
   if (is_giuh_ordinates_set) {
     int factor = int(1.0/state->lgar_bmi_params.forcing_resolution_h);
 
@@ -983,7 +1260,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
       }
     }
     
-    if (verbosity.compare("high") == 0) {
+    if (LGAR_LOG_HIGH) {
       for (int i=1; i<=state->lgar_bmi_params.num_giuh_ordinates; i++)
 	      std::cerr<<"GIUH ordinates (scaled) : "<<state->lgar_bmi_params.giuh_ordinates[i]<<"\n";
       
@@ -1024,12 +1301,14 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
   for (int i=0; i <= state->lgar_bmi_params.num_layers; i++)
     state->lgar_bmi_params.frozen_factor[i] = 1.0;
 
+  lgar_update_derived_constants(&state->lgar_bmi_params, state->soil_properties, &state->derived);
+
   state->head = NULL; //this will be updated if there are only valid soil types, but if there are any invalid soil types, it will remain null
   InitializeWettingFronts(state->lgar_bmi_params.is_invalid_soil_type, state->lgar_bmi_params.num_layers, state->lgar_bmi_params.initial_psi_cm,
         state->lgar_bmi_params.layer_soil_type, state->lgar_bmi_params.cum_layer_thickness_cm,
-        state->lgar_bmi_params.frozen_factor, &state->head, state->soil_properties);
+        state->lgar_bmi_params.frozen_factor, &state->head, &state->front_pool, state->soil_properties);
   
-  if (verbosity.compare("none") != 0) {
+  if (LGAR_LOG_LOW) {
     std::cerr<<"--- Initial state/conditions --- \n";
     listPrint(state->head);
     std::cerr<<"          *****         \n";
@@ -1054,7 +1333,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
   }
   
 
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     std::cerr<<"Initial ponded depth is set to zero. \n";
     std::cerr<<"No. of spatial intervals used in trapezoidal integration to compute G : "<<state->lgar_bmi_params.nint<<"\n";
   }
@@ -1063,7 +1342,7 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
   state->lgar_bmi_params.time_s    = 0.0;
   state->lgar_bmi_params.timesteps = 0.0;
 
-  if (verbosity.compare("none") != 0) {
+  if (LGAR_LOG_LOW) {
     std::cerr<<"------------- Initialization done! ---------------------- \n";
     std::cerr<<"--------------------------------------------------------- \n";
   }
@@ -1077,7 +1356,8 @@ extern void InitFromConfigFile(string config_file, struct model_state *state)
 */
 // #############################################################################
 extern void InitializeWettingFronts(bool is_invalid_soil_type, int num_layers, double initial_psi_cm, int *layer_soil_type, double *cum_layer_thickness_cm,
-				    double *frozen_factor, struct wetting_front** head, struct soil_properties_ *soil_properties)
+				    double *frozen_factor, struct wetting_front** head, struct wetting_front_pool *pool,
+				    struct soil_properties_ *soil_properties)
 {
   if (!is_invalid_soil_type){
     int soil;
@@ -1095,7 +1375,7 @@ extern void InitializeWettingFronts(bool is_invalid_soil_type, int num_layers, d
             soil_properties[soil].vg_m,soil_properties[soil].vg_n,
             soil_properties[soil].theta_e,soil_properties[soil].theta_r);
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
         printf("layer, theta, psi, alpha, m, n, theta_e, theta_r = %d, %6.6f, %6.6f, %6.6f, %6.6f, %6.6f, %6.6f, %6.6f \n",
         layer, theta_init, initial_psi_cm, soil_properties[soil].vg_alpha_per_cm, soil_properties[soil].vg_m,
         soil_properties[soil].vg_n,soil_properties[soil].theta_e,soil_properties[soil].theta_r);
@@ -1105,7 +1385,7 @@ extern void InitializeWettingFronts(bool is_invalid_soil_type, int num_layers, d
       bottom_flag = true;  // all initial wetting fronts are in contact with the bottom of the layer they exist in
       // NOTE: The listInsertFront function does lots of stuff.
 
-      current = listInsertFront(cum_layer_thickness_cm[layer],theta_init,front,layer,bottom_flag, head);
+      current = listInsertFront(cum_layer_thickness_cm[layer],theta_init,front,layer,bottom_flag, head, pool);
 
       current->psi_cm = initial_psi_cm;
       Se = calc_Se_from_theta(current->theta,soil_properties[soil].theta_e,soil_properties[soil].theta_r);
@@ -1118,6 +1398,74 @@ extern void InitializeWettingFronts(bool is_invalid_soil_type, int num_layers, d
 
 }
 
+// ##################################################################################
+/*
+  Builds the lookup tables (van Genuchten relations, cumulative integral for Geff) of the
+  soils of the layers, as enabled in the config file. Must be called again whenever the
+  soil parameters change (e.g., calibration); existing tables are rebuilt.
+*/
+// ##################################################################################
+extern void lgar_build_soil_tables(struct model_state *state)
+{
+  if (state->lgar_bmi_params.is_invalid_soil_type)
+    return;
+
+  bool build_Geff_table = state->lgar_bmi_params.use_Geff_table && !state->lgar_bmi_params.use_closed_form_G;
+
+  for (int layer=1; layer <= state->lgar_bmi_params.num_layers; layer++) {
+    struct soil_properties_ *soil = &state->soil_properties[state->lgar_bmi_params.layer_soil_type[layer]];
+
+    if (state->lgar_bmi_params.use_vG_tables)
+      lgar_build_vG_tables(soil, state->lgar_bmi_params.vG_table_tolerance);
+
+    if (build_Geff_table)
+      lgar_build_Geff_table(soil);
+  }
+}
+
+// ##################################################################################
+/*
+  Computes the per-layer constants derived from the soil parameters of the layers, the
+  frozen factor and the field capacity (see struct lgar_derived_constants). Must be
+  called again whenever any of these change (calibration, frozen factor).
+*/
+// ##################################################################################
+extern void lgar_update_derived_constants(const struct lgar_bmi_parameters *lgar_bmi_params,
+					  const struct soil_properties_ *soil_properties,
+					  struct lgar_derived_constants *derived)
+{
+  int num_layers = lgar_bmi_params->num_layers;
+
+  derived->Ksat_cm_per_h.assign(num_layers+1, 0.0);
+  derived->h_50_cm.assign(num_layers+1, 0.0);
+  derived->largest_Ksat_cm_per_h = 0.0;
+  derived->min_storage_cm = 0.0;
+  derived->max_storage_cm = 0.0;
+
+  if (lgar_bmi_params->is_invalid_soil_type)
+    return;
+
+  for (int layer=1; layer <= num_layers; layer++) {
+    const struct soil_properties_ *soil = &soil_properties[lgar_bmi_params->layer_soil_type[layer]];
+    double thickness_cm = lgar_bmi_params->cum_layer_thickness_cm[layer] - lgar_bmi_params->cum_layer_thickness_cm[layer-1];
+
+    derived->Ksat_cm_per_h[layer]    = soil->Ksat_cm_per_h * lgar_bmi_params->frozen_factor[layer];
+    derived->largest_Ksat_cm_per_h   = fmax(soil->Ksat_cm_per_h, derived->largest_Ksat_cm_per_h);
+    derived->min_storage_cm         += soil->theta_r * thickness_cm;
+    derived->max_storage_cm         += soil->theta_e * thickness_cm;
+
+    // AET = 0.5 * PET at the capillary head of the water content halfway between the field capacity and the wilting point
+    double theta_fc = calc_theta_from_h(lgar_bmi_params->field_capacity_psi_cm, soil->vg_alpha_per_cm, soil->vg_m,
+					soil->vg_n, soil->theta_e, soil->theta_r);
+    double wp_head_theta = calc_theta_from_h(lgar_bmi_params->wilting_point_psi_cm, soil->vg_alpha_per_cm, soil->vg_m,
+					     soil->vg_n, soil->theta_e, soil->theta_r);
+    double theta_50 = (theta_fc - wp_head_theta)*1/2 + wp_head_theta;
+    double Se = calc_Se_from_theta(theta_50, soil->theta_e, soil->theta_r);
+
+    derived->h_50_cm[layer] = calc_h_from_Se(Se, soil->vg_alpha_per_cm, soil->vg_m, soil->vg_n);
+  }
+}
+
 // ##################################################################################
 /*
   Reads 1D data from the config file
@@ -1161,7 +1509,9 @@ ReadVectorData(string key)
   for each layer
  */
 // ############################################################################################
-extern void frozen_factor_hydraulic_conductivity(struct lgar_bmi_parameters lgar_bmi_params)
+extern void frozen_factor_hydraulic_conductivity(struct lgar_bmi_parameters lgar_bmi_params,
+						 const struct soil_properties_ *soil_properties,
+						 struct lgar_derived_constants *derived)
 {
 
   int c = 0, count;
@@ -1196,13 +1546,93 @@ extern void frozen_factor_hydraulic_conductivity(struct lgar_bmi_parameters lgar
 
   }
 
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     for (int i=1; i <= lgar_bmi_params.num_layers; i++)
       std::cerr<<"frozen factor = "<< lgar_bmi_params.frozen_factor[i]<<"\n";
   }
 
+  // the effective Ksat of the layers depends on the frozen factor
+  lgar_update_derived_constants(&lgar_bmi_params, soil_properties, derived);
+
 }
 
+// #########################################################################################
+/*
+  estimates the local error of a substep for the error-controlled adaptive timestep, as a fraction of the tolerance
+  (error <= 1 means the substep is accepted). Two indicators are used: the substep mass balance error, and, if the
+  number of wetting fronts did not change during the substep, the difference between the trapezoid and the Euler
+  estimate of each front's displacement, 0.5*dt*|dzdt_end - dzdt_start|.
+  @param start                : wetting fronts at the start of the substep
+  @param local_mass_balance_cm : mass balance error of the substep
+*/
+// #########################################################################################
+extern double lgar_substep_error(const struct wetting_front_store *start, struct wetting_front* head, double timestep_h,
+				 double local_mass_balance_cm, double front_tol_cm, double mbal_tol_cm)
+{
+  double error = fabs(local_mass_balance_cm) / mbal_tol_cm;
+
+  if (storeLength(start) != listLength(head))
+    return error;
+
+  // the store is indexed by front number (1..num_fronts)
+  struct wetting_front *current = head;
+  for (int i = 1; current != NULL; i++, current = current->next) {
+    if (current->to_bottom || start->to_bottom[i])
+      continue;
+
+    double front_error = 0.5 * timestep_h * fabs(current->dzdt_cm_per_h - start->dzdt_cm_per_h[i]) / front_tol_cm;
+    error = fmax(error, front_error);
+  }
+
+  return error;
+}
+
+
+// #########################################################################################
+/*
+  proposes the next substep size from the error of the current one (first order step size control), limited to a
+  growth/shrink factor per substep and to [minimum_timestep_h, maximum_timestep_h]
+*/
+// #########################################################################################
+extern double lgar_substep_next_size(double timestep_h, double error, double minimum_timestep_h, double maximum_timestep_h)
+{
+  double factor = SUBSTEP_MAX_GROWTH;
+
+  if (error > 0.0)
+    factor = fmin(SUBSTEP_MAX_GROWTH, fmax(SUBSTEP_MAX_SHRINK, SUBSTEP_SAFETY * sqrt(1.0 / error)));
+
+  return fmin(maximum_timestep_h, fmax(minimum_timestep_h, timestep_h * factor));
+}
+
+
+// #########################################################################################
+/*
+  adapts the flux caching horizon at the end of a cache window that lasted the full horizon: halves it if the soil
+  storage or the speed of the top wetting front drifted more than tolerated over the window, and doubles it if both
+  drifted less than half of that, within [min_horizon, max_horizon]
+  @param storage_cm     : soil storage at the end of the window
+  @param dzdt_cm_per_h  : speed of the top wetting front at the end of the window
+*/
+// #########################################################################################
+extern void lgar_adapt_flux_caching_horizon(struct flux_caching_policy *policy, double storage_cm, double dzdt_cm_per_h)
+{
+  double storage_drift = fabs(storage_cm - policy->window_storage_cm) / policy->storage_drift_tol_cm;
+  double dzdt_drift    = fabs(dzdt_cm_per_h - policy->window_dzdt_cm_per_h)
+                         / (fmax(fabs(dzdt_cm_per_h), fabs(policy->window_dzdt_cm_per_h)) + 1.E-9) / policy->dzdt_drift_tol;
+  double drift = fmax(storage_drift, dzdt_drift);
+
+  int horizon = policy->horizon;
+  if (drift > 1.0)
+    policy->horizon = std::max(policy->min_horizon, policy->horizon / 2);
+  else if (drift < 0.5)
+    policy->horizon = std::min(policy->max_horizon, 2 * policy->horizon);
+
+  if (LGAR_LOG_HIGH && policy->horizon != horizon)
+    std::cerr<<"Flux caching horizon changed from "<< horizon <<" to "<< policy->horizon <<" timesteps (storage drift = "
+	     << storage_drift <<", dzdt drift = "<< dzdt_drift <<" of the tolerance)\n";
+}
+
+
 /*
 extern void lgar_update(struct model_state *state)
 { if we ever decided to run this version without the bmi then we simply need to copy `update method` from the bmi here.}
@@ -1303,7 +1733,7 @@ extern int wetting_front_free_drainage(struct wetting_front* head) {
   if (wf_that_supplies_free_drainage_demand > number_of_wetting_fronts)
     wf_that_supplies_free_drainage_demand--;
 
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     printf("wetting_front_free_drainage = %d \n", wf_that_supplies_free_drainage_demand);
   }
 
@@ -1361,48 +1791,54 @@ double lgar_interflow_support_depth_cm(double layer_top_cm, double layer_bottom_
 */
 static void lgar_calc_interflow_fluxes_by_front(double timestep_h, int num_layers, double interflow_psi_threshold_cm,
 					      double interflow_factor, double *cum_layer_thickness_cm,
-					      struct wetting_front* head, std::vector<double>& interflow_flux_cm_by_front)
+					      const struct wetting_front_store* fronts, std::vector<double>& interflow_flux_cm_by_front)
 {
-  if (interflow_factor <= 0.0 || head == NULL)
+  if (interflow_factor <= 0.0 || fronts == NULL || fronts->num_fronts == 0)
     return;
 
   double column_depth_cm = cum_layer_thickness_cm[num_layers];
   if (column_depth_cm <= 0.0)
     return;
 
-  for (struct wetting_front *previous = NULL, *current = head; current != NULL; previous = current, current = current->next) {
+  struct wetting_front previous, current;
+
+  for (int wf = 1; wf <= fronts->num_fronts; wf++) {
     double interflow_flux_cm_per_h = 0.0;
 
-    if (current->psi_cm <= interflow_psi_threshold_cm) {
-      double layer_top_cm = cum_layer_thickness_cm[current->layer_num - 1];
-      double layer_bottom_cm = cum_layer_thickness_cm[current->layer_num];
-      double support_depth_cm = lgar_interflow_support_depth_cm(layer_top_cm, layer_bottom_cm, previous, current);
+    storeGetFront(fronts, wf, &current);
+
+    if (current.psi_cm <= interflow_psi_threshold_cm) {
+      double layer_top_cm = cum_layer_thickness_cm[current.layer_num - 1];
+      double layer_bottom_cm = cum_layer_thickness_cm[current.layer_num];
+      double support_depth_cm = lgar_interflow_support_depth_cm(layer_top_cm, layer_bottom_cm,
+								 wf > 1 ? storeGetFront(fronts, wf-1, &previous) : NULL,
+								 &current);
 
       support_depth_cm = fmax(0.0, fmin(support_depth_cm, column_depth_cm));
       double vadose_fraction = support_depth_cm / column_depth_cm;
 
-      interflow_flux_cm_per_h = fmax(0.0, current->K_cm_per_h) * interflow_factor * vadose_fraction;
+      interflow_flux_cm_per_h = fmax(0.0, current.K_cm_per_h) * interflow_factor * vadose_fraction;
     }
 
     if (interflow_flux_cm_per_h <= 0.0)
       continue;
 
-    struct wetting_front *target = current;
+    int target = wf;
 
-    if (current->to_bottom && current->layer_num < num_layers) {
-      target = current->next;
-      while (target != NULL && target->to_bottom)
-	target = target->next;
+    if (current.to_bottom && current.layer_num < num_layers) {
+      target = wf + 1;
+      while (target <= fronts->num_fronts && fronts->to_bottom[target])
+	target++;
     }
 
-    if (target == NULL)
+    if (target > fronts->num_fronts)
       continue;
 
-    if (target->front_num >= 0 && target->front_num < (int)interflow_flux_cm_by_front.size()) {
-      interflow_flux_cm_by_front[target->front_num] += interflow_flux_cm_per_h * timestep_h;
-      if (verbosity.compare("high") == 0) {
+    if (target < (int)interflow_flux_cm_by_front.size()) {
+      interflow_flux_cm_by_front[target] += interflow_flux_cm_per_h * timestep_h;
+      if (LGAR_LOG_HIGH) {
 	printf("Interflow assigned from WF %d to WF %d: rate = %.10e cm/h, amount = %.10e cm\n",
-	       current->front_num, target->front_num, interflow_flux_cm_per_h, interflow_flux_cm_per_h * timestep_h);
+	       wf, target, interflow_flux_cm_per_h, interflow_flux_cm_per_h * timestep_h);
       }
     }
   }
@@ -1426,9 +1862,7 @@ static double lgar_prior_mass_for_psi(double psi_cm, int layer_num, double *delt
 
   for (int k = 1; k <= layer_num; k++) {
     int soil_num = soil_type[k];
-    double theta = calc_theta_from_h(psi_cm, soil_properties[soil_num].vg_alpha_per_cm,
-				     soil_properties[soil_num].vg_m, soil_properties[soil_num].vg_n,
-				     soil_properties[soil_num].theta_e, soil_properties[soil_num].theta_r);
+    double theta = soil_theta_from_h(&soil_properties[soil_num], psi_cm);
     prior_mass += delta_thickness[k] * (theta - delta_theta[k]);
   }
 
@@ -1512,21 +1946,20 @@ double lgar_to_bottom_stack_layer_mass_cm(int layer_num, double layer_top_cm, do
   The returned value is an equivalent water depth in cm over the model column.
 */
 static double lgar_to_bottom_stack_mass_from_profile(int stack_start_front_num, int stack_end_front_num,
-						     double *cum_layer_thickness_cm, struct wetting_front* head)
+						     double *cum_layer_thickness_cm, const struct wetting_front_store* fronts)
 {
   double stack_mass_cm = 0.0;
+  struct wetting_front previous_front;
 
   for (int front_num = stack_start_front_num; front_num <= stack_end_front_num; front_num++) {
-    struct wetting_front *front = listFindFront(front_num, head, NULL);
-    if (front == NULL)
+    if (front_num < 1 || front_num > fronts->num_fronts)
       return 0.0;
 
-    int layer_num = front->layer_num;
+    int layer_num = fronts->layer_num[front_num];
     double layer_top_cm = cum_layer_thickness_cm[layer_num - 1];
     double layer_bottom_cm = cum_layer_thickness_cm[layer_num];
-    struct wetting_front *previous_front = front_num > 1 ? listFindFront(front_num - 1, head, NULL) : NULL;
-    stack_mass_cm += lgar_to_bottom_stack_layer_mass_cm(layer_num, layer_top_cm, layer_bottom_cm,
-							front->theta, previous_front);
+    stack_mass_cm += lgar_to_bottom_stack_layer_mass_cm(layer_num, layer_top_cm, layer_bottom_cm, fronts->theta[front_num],
+							front_num > 1 ? storeGetFront(fronts, front_num - 1, &previous_front) : NULL);
   }
 
   return stack_mass_cm;
@@ -1555,9 +1988,7 @@ static double lgar_to_bottom_stack_mass_for_psi(double psi_cm, int stack_start_f
     double layer_top_cm = cum_layer_thickness_cm[layer_num - 1];
     double layer_bottom_cm = cum_layer_thickness_cm[layer_num];
     struct wetting_front *previous_front = front_num > 1 ? listFindFront(front_num - 1, head, NULL) : NULL;
-    double theta = calc_theta_from_h(psi_cm, soil_properties[soil_num].vg_alpha_per_cm,
-				     soil_properties[soil_num].vg_m, soil_properties[soil_num].vg_n,
-				     soil_properties[soil_num].theta_e, soil_properties[soil_num].theta_r);
+    double theta = soil_theta_from_h(&soil_properties[soil_num], psi_cm);
     stack_mass_cm += lgar_to_bottom_stack_layer_mass_cm(layer_num, layer_top_cm, layer_bottom_cm,
 							theta, previous_front);
   }
@@ -1598,7 +2029,7 @@ static double lgar_apply_interflow_flux_to_deepest_to_bottom_stack(double reques
 								 int num_layers, double *cum_layer_thickness_cm,
 								 int *soil_type, double *frozen_factor,
 								 struct wetting_front** head,
-								 struct wetting_front* state_previous,
+								 const struct wetting_front_store* state_previous,
 								 struct soil_properties_ *soil_properties,
 								 double *interflow_subtimestep_cm,
 								 std::vector<int> *interflow_stack_changed_by_front)
@@ -1650,14 +2081,11 @@ static double lgar_apply_interflow_flux_to_deepest_to_bottom_stack(double reques
 
     int layer_num = front->layer_num;
     int soil_num = soil_type[layer_num];
-    front->theta = calc_theta_from_h(psi_new_cm, soil_properties[soil_num].vg_alpha_per_cm,
-				     soil_properties[soil_num].vg_m, soil_properties[soil_num].vg_n,
-				     soil_properties[soil_num].theta_e, soil_properties[soil_num].theta_r);
+    front->theta = soil_theta_from_h(&soil_properties[soil_num], psi_new_cm);
     front->psi_cm = psi_new_cm;
 
     double Se = calc_Se_from_theta(front->theta, soil_properties[soil_num].theta_e, soil_properties[soil_num].theta_r);
-    front->K_cm_per_h = calc_K_from_Se(Se, frozen_factor[layer_num] * soil_properties[soil_num].Ksat_cm_per_h,
-				       soil_properties[soil_num].vg_m);
+    front->K_cm_per_h = soil_K_from_Se(&soil_properties[soil_num], Se, frozen_factor[layer_num] * soil_properties[soil_num].Ksat_cm_per_h);
 
     if (interflow_stack_changed_by_front != NULL && front->front_num >= 0
 	&& front->front_num < (int)interflow_stack_changed_by_front->size())
@@ -1676,8 +2104,8 @@ static double lgar_apply_interflow_flux_to_deepest_to_bottom_stack(double reques
   @param current : wetting front pointing to the current node of the current state
   @param next    : wetting front pointing to the next node of the current state
   @param previous    : wetting front pointing to the previous node of the current state
-  @param current_old : wetting front pointing to the current node of the previous state
-  @param next_old    : wetting front pointing to the next node of the previous state
+  @param state_previous : snapshot of the previous state; state_previous->xxx[wf] and state_previous->xxx[wf+1]
+                          are the current and next wetting fronts of the previous state
   @param head : pointer to the first wetting front in the list of the current state
 
   Note: '_old' denotes the wetting_front or variables at the previous timestep (or state)
@@ -1686,11 +2114,11 @@ static double lgar_apply_interflow_flux_to_deepest_to_bottom_stack(double reques
 extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_subtimestep_cm, double *interflow_subtimestep_cm,
 				     double interflow_psi_threshold_cm, double interflow_factor, double *volin_cm, int wf_free_drainage_demand,
 				     double old_mass, double mass_correction_for_cached_free_drainage_fluxes, int num_layers, double *AET_demand_cm, double *cum_layer_thickness_cm,
-				     int *soil_type, double *frozen_factor, struct wetting_front** head,
-				     struct wetting_front* state_previous, struct soil_properties_ *soil_properties)
+				     int *soil_type, double *frozen_factor, struct wetting_front** head, struct wetting_front_pool *pool,
+				     const struct wetting_front_store* state_previous, struct soil_properties_ *soil_properties)
 {
 
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     printf("State before moving wetting fronts...\n");
     listPrint(*head);
   }
@@ -1699,17 +2127,19 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
   struct wetting_front *next;
   struct wetting_front *previous;
 
-  struct wetting_front *current_old;
-  struct wetting_front *next_old;
+  // the previous state is read from the snapshot by front number (state_previous->xxx[wf] is the front wf of the
+  // previous state); the current state is accessed through an index of the list nodes that is rebuilt whenever a
+  // front is deleted
+  struct wetting_front *fronts[MAX_NUM_WETTING_FRONTS+2];
 
   double column_depth = cum_layer_thickness_cm[num_layers];
 
   previous = *head;
   double theta_e,theta_r;
-  double vg_a, vg_m, vg_n;
   int layer_num, soil_num;
 
-  int number_of_wetting_fronts = listLength(*head);
+  int number_of_wetting_fronts = listIndex(*head, fronts);
+  fronts[number_of_wetting_fronts+1] = NULL;
   std::vector<double> interflow_flux_cm_by_front(number_of_wetting_fronts + 1, 0.0);
   std::vector<int> interflow_stack_changed_by_front(number_of_wetting_fronts + 1, 0);
   lgar_calc_interflow_fluxes_by_front(timestep_h, num_layers, interflow_psi_threshold_cm,
@@ -1736,48 +2166,38 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
 
   for (int wf = number_of_wetting_fronts; wf != 0; wf--) {
 
-    if (verbosity.compare("high") == 0) {
+    if (LGAR_LOG_HIGH) {
       printf("Moving |******** Wetting Front = %d *********| \n", wf);
     }
 
+    assert (wf <= state_previous->num_fronts); // the previous state is a snapshot of the current state taken before the fronts are moved
+
     if (wf == 1 && number_of_wetting_fronts >0) {
-      current = listFindFront(wf, *head, NULL);
-      next = listFindFront(wf+1, *head, NULL);
+      current = fronts[wf];
+      next = fronts[wf+1];
       previous = NULL;
-
-      current_old = listFindFront(wf, *head, state_previous);
-      next_old = listFindFront(wf+1, *head, state_previous);
     }
     else if (wf < number_of_wetting_fronts) {
-      current = listFindFront(wf, *head, NULL);
-      next = listFindFront(wf+1, *head, NULL);
-      previous = listFindFront(wf-1, *head, NULL);
-
-      current_old = listFindFront(wf, *head, state_previous);
-      next_old = listFindFront(wf+1, *head, state_previous);
+      current = fronts[wf];
+      next = fronts[wf+1];
+      previous = fronts[wf-1];
     }
     else if (wf == number_of_wetting_fronts) {
-      current = listFindFront(wf, *head, NULL);
+      current = fronts[wf];
       next = NULL;
-      previous = listFindFront(wf-1, *head, NULL);
-
-      current_old = listFindFront(wf, *head, state_previous);
-      next_old = NULL;
+      previous = fronts[wf-1];
     }
 
     layer_num   = current->layer_num;
     soil_num    = soil_type[layer_num];
     theta_e     = soil_properties[soil_num].theta_e;
     theta_r     = soil_properties[soil_num].theta_r;
-    vg_a        = soil_properties[soil_num].vg_alpha_per_cm;
-    vg_m        = soil_properties[soil_num].vg_m;
-    vg_n        = soil_properties[soil_num].vg_n;
 
     // find indices of above and below layers
     layer_num_above = (wf == 1) ? layer_num : previous->layer_num;
     layer_num_below = (wf == last_wetting_front_index) ? layer_num + 1 : next->layer_num;
 
-    if (verbosity.compare("high") == 0) {
+    if (LGAR_LOG_HIGH) {
        printf ("Layers (current, above, below) == %d %d %d \n", layer_num, layer_num_above, layer_num_below);
        listPrint(*head);
     }
@@ -1802,11 +2222,11 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
     /*************************************************************************************/
     if ( (wf < last_wetting_front_index) && (layer_num_below != layer_num) ) {
       
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	printf("case (deepest wetting front within layer) : layer_num (%d) != layer_num_below (%d) \n", layer_num, layer_num_below);
       }
 
-      current->theta = calc_theta_from_h(next->psi_cm, vg_a,vg_m, vg_n, theta_e, theta_r);
+      current->theta = soil_theta_from_h(&soil_properties[soil_num], next->psi_cm);
       current->psi_cm = next->psi_cm;
     }
 
@@ -1826,47 +2246,40 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
 
     if (wf == number_of_wetting_fronts && layer_num_below != layer_num && number_of_wetting_fronts == num_layers) {
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	printf("case (number_of_wetting_fronts equal to num_layers) : l (%d) == num_layers (%d) == num_wetting_fronts(%d) \n", wf, num_layers,number_of_wetting_fronts);
       }
 
       // local variables
-      double vg_a_k, vg_m_k, vg_n_k;
-      double theta_e_k, theta_r_k;
 
       current->depth_cm += current->dzdt_cm_per_h * timestep_h; // this is probably not needed, as dz/dt = 0 for the deepest wetting front
 
       double *delta_thetas = (double *) malloc(sizeof(double)*(layer_num+1));
       double *delta_thickness = (double *) malloc(sizeof(double)*(layer_num+1));
 
-      double psi_cm_old = current_old->psi_cm;
+      double psi_cm_old = state_previous->psi_cm[wf];
       //double psi_cm_below_old = 0.0;
 
       double psi_cm = current->psi_cm;
       //double psi_cm_below = 0.0;
 
       // mass = delta(depth) * delta(theta)
-      double prior_mass = (current_old->depth_cm - cum_layer_thickness_cm[layer_num-1]) * (current_old->theta - 0.0); // 0.0 = next_old->theta
+      double prior_mass = (state_previous->depth_cm[wf] - cum_layer_thickness_cm[layer_num-1]) * (state_previous->theta[wf] - 0.0); // 0.0 = state_previous->theta[wf+1]
 
       double new_mass = (current->depth_cm - cum_layer_thickness_cm[layer_num-1]) * (current->theta - 0.0); // 0.0 = next->theta;
 
       for (int k=1; k<layer_num; k++) {
 	int soil_num_k  = soil_type[k];
-	theta_e_k = soil_properties[soil_num_k].theta_e;
-	theta_r_k = soil_properties[soil_num_k].theta_r;
-	vg_a_k    = soil_properties[soil_num_k].vg_alpha_per_cm;
-	vg_m_k    = soil_properties[soil_num_k].vg_m;
-	vg_n_k    = soil_properties[soil_num_k].vg_n;
 
 	// using psi_cm_old for all layers because the psi is constant across layers in this particular case
-	double theta_old             = calc_theta_from_h(psi_cm_old, vg_a_k, vg_m_k, vg_n_k, theta_e_k,theta_r_k);
+	double theta_old             = soil_theta_from_h(&soil_properties[soil_num_k], psi_cm_old);
 	double theta_below_old       = 0.0;
 	double local_delta_theta_old = theta_old - theta_below_old;
 	double layer_thickness       = cum_layer_thickness_cm[k] - cum_layer_thickness_cm[k-1];
 
 	prior_mass += (layer_thickness * local_delta_theta_old);
 
-	double theta       = calc_theta_from_h(psi_cm, vg_a_k, vg_m_k, vg_n_k, theta_e_k, theta_r_k);
+	double theta       = soil_theta_from_h(&soil_properties[soil_num_k], psi_cm);
 	double theta_below = 0.0;
 
 	new_mass += layer_thickness * (theta - theta_below);
@@ -1889,13 +2302,13 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
       double applied_interflow_flux_cm = lgar_apply_interflow_flux_to_prior_mass(interflow_flux_cm_by_front[wf], &prior_mass,
 									     minimum_prior_mass_cm,
 									     interflow_subtimestep_cm);
-      if (applied_interflow_flux_cm > 0.0 && verbosity.compare("high") == 0) {
+      if (applied_interflow_flux_cm > 0.0 && LGAR_LOG_HIGH) {
 	printf("Applied interflow to WF %d mass balance: %.10e cm\n", wf, applied_interflow_flux_cm);
       }
 
       // theta mass balance computes new theta that conserves the mass; new theta is assigned to the current wetting front
 
-      double theta_new = lgar_theta_mass_balance(layer_num, soil_num, psi_cm, new_mass, prior_mass, precip_mass_to_add, AET_demand_cm,
+      double theta_new = lgar_theta_mass_balance(layer_num, soil_num, psi_cm, new_mass, prior_mass, AET_demand_cm,
 						 delta_thetas, delta_thickness, soil_type, soil_properties);
       actual_ET_demand = *AET_demand_cm;
       //done with delta_thetas and delta_thickness, cleanup memory
@@ -1904,7 +2317,7 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
       current->theta = fmax(theta_r, fmin(theta_new, theta_e));
 
       double Se = calc_Se_from_theta(current->theta,theta_e,theta_r);
-      current->psi_cm = calc_h_from_Se(Se, vg_a, vg_m, vg_n);
+      current->psi_cm = soil_h_from_Se(&soil_properties[soil_num], Se);
 
       /* note: theta and psi of the current wetting front are updated here based on the wetting front's mass balance,
 	 upper wetting fronts will be updated later in the lgar_merge_ module (the place where all state
@@ -1927,7 +2340,7 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
 											  state_previous, soil_properties,
 											  interflow_subtimestep_cm,
 											  &interflow_stack_changed_by_front);
-      if (applied_interflow_flux_cm > 0.0 && verbosity.compare("high") == 0) {
+      if (applied_interflow_flux_cm > 0.0 && LGAR_LOG_HIGH) {
 	printf("Applied interflow to deepest to_bottom WF %d stack mass balance: %.10e cm\n", wf, applied_interflow_flux_cm);
       }
     }
@@ -1942,7 +2355,7 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
     if ( (wf < last_wetting_front_index) && (layer_num == layer_num_below) ) {
 
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
 	printf("case (wetting front within a layer) : layer_num (%d) == layer_num_below (%d) \n", layer_num,layer_num_below);
       }
 
@@ -1951,8 +2364,8 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
 
 	// double free_drainage_demand = 0;
 	// prior mass = mass contained in the current old wetting front
-	double next_reference_theta = lgar_front_changed_by_interflow_stack(next, interflow_stack_changed_by_front) ? next->theta : next_old->theta;
-	double prior_mass = current_old->depth_cm * (current_old->theta -  next_reference_theta);
+	double next_reference_theta = lgar_front_changed_by_interflow_stack(next, interflow_stack_changed_by_front) ? next->theta : state_previous->theta[wf+1];
+	double prior_mass = state_previous->depth_cm[wf] * (state_previous->theta[wf] -  next_reference_theta);
 
 	if (wf_free_drainage_demand == wf)
 	  prior_mass += precip_mass_to_add - (free_drainage_demand + mass_correction_for_cached_free_drainage_fluxes + actual_ET_demand);
@@ -1960,12 +2373,12 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
 	double depth_after_movement_cm = current->depth_cm + current->dzdt_cm_per_h * timestep_h;
 	if (depth_after_movement_cm > column_depth)
 	  depth_after_movement_cm = column_depth + TRUNCATION_DEPTH;
-	double minimum_theta = calc_theta_from_h(interflow_psi_cap_cm, vg_a, vg_m, vg_n, theta_e, theta_r);
+	double minimum_theta = soil_theta_from_h(&soil_properties[soil_num], interflow_psi_cap_cm);
 	double minimum_prior_mass_cm = depth_after_movement_cm * (minimum_theta - next->theta);
 	double applied_interflow_flux_cm = lgar_apply_interflow_flux_to_prior_mass(interflow_flux_cm_by_front[wf], &prior_mass,
 									       minimum_prior_mass_cm,
 									       interflow_subtimestep_cm);
-	if (applied_interflow_flux_cm > 0.0 && verbosity.compare("high") == 0) {
+	if (applied_interflow_flux_cm > 0.0 && LGAR_LOG_HIGH) {
 	  printf("Applied interflow to WF %d mass balance: %.10e cm\n", wf, applied_interflow_flux_cm);
 	}
 
@@ -1983,7 +2396,7 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
 	  current->theta = current->theta;
 	else {
       if ((prior_mass/current->depth_cm + next->theta)<theta_r){
-        if (verbosity.compare("high") == 0) {
+        if (LGAR_LOG_HIGH) {
           printf("Deleting WF (%d) that will go below theta_r (before)...\n", current->front_num);
           listPrint(*head);
         }
@@ -1991,8 +2404,9 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
         //the idea here is that in some cases, the reduction in theta via WF movement or AET will be intense enough such that theta goes below theta_r.
         //it requires a fairly unusual soil, which I encountered during random parameter sampling.
         double mass_before_theta_went_below_theta_r = lgar_calc_mass_bal(cum_layer_thickness_cm, *head) - current->depth_cm*(current->theta - (prior_mass/current->depth_cm + next->theta));
-        current = listDeleteFront(current->front_num, head, soil_type, soil_properties);
+        current = listDeleteFront(current->front_num, head, pool, soil_type, soil_properties);
         current = next;
+        fronts[listIndex(*head, fronts)+1] = NULL; // front numbers below the deleted front have changed
         double mass_after_theta_went_below_theta_r = lgar_calc_mass_bal(cum_layer_thickness_cm, *head);
         // Reduce free drainage first so deleting this tiny front does not force negative AET.
         double removal_correction_cm = fabs(mass_before_theta_went_below_theta_r - mass_after_theta_went_below_theta_r);
@@ -2003,7 +2417,7 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
         removal_correction_cm -= free_drainage_reduction_cm;
         *AET_demand_cm = *AET_demand_cm - removal_correction_cm;
         actual_ET_demand = *AET_demand_cm;
-        if (verbosity.compare("high") == 0) {
+        if (LGAR_LOG_HIGH) {
           printf("Deleting WF that will go below theta_r (after)...\n");
           listPrint(*head);
         }
@@ -2031,8 +2445,6 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
 	  - LGAR paper (https://agupubs.onlinelibrary.wiley.com/doi/full/10.1029/2022WR033742) has a better description, using diagrams, of the mass balance of wetting fronts
 	*/
 
-	double vg_a_k, vg_m_k, vg_n_k;
-	double theta_e_k, theta_r_k;
 
 	current->depth_cm += current->dzdt_cm_per_h * timestep_h;
 
@@ -2044,17 +2456,17 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
 	double *delta_thickness = (double *)malloc(sizeof(double)*(layer_num+1));
 
 
-	double psi_cm_old = current_old->psi_cm;
+	double psi_cm_old = state_previous->psi_cm[wf];
 	bool next_changed_by_interflow_stack = lgar_front_changed_by_interflow_stack(next, interflow_stack_changed_by_front);
-	double psi_cm_below_old = next_changed_by_interflow_stack ? next->psi_cm : current_old->next->psi_cm;
+	double psi_cm_below_old = next_changed_by_interflow_stack ? next->psi_cm : state_previous->psi_cm[wf+1];
 
 	double psi_cm = current->psi_cm;
 	double psi_cm_below = next->psi_cm;
 
 	// mass = delta(depth) * delta(theta)
 	//      = difference in current and next wetting front thetas times depth of the current wetting front
-	double next_reference_theta = next_changed_by_interflow_stack ? next->theta : next_old->theta;
-	double prior_mass = (current_old->depth_cm - cum_layer_thickness_cm[layer_num-1]) * (current_old->theta - next_reference_theta);
+	double next_reference_theta = next_changed_by_interflow_stack ? next->theta : state_previous->theta[wf+1];
+	double prior_mass = (state_previous->depth_cm[wf] - cum_layer_thickness_cm[layer_num-1]) * (state_previous->theta[wf] - next_reference_theta);
 	double new_mass = (current->depth_cm - cum_layer_thickness_cm[layer_num-1]) * (current->theta - next->theta);
 
 	// compute mass in the layers above the current wetting front
@@ -2062,14 +2474,9 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
 	// the respective layers to get the total mass above the current wetting front
 	for (int k=1; k<layer_num; k++) {
 	  int soil_num_k  = soil_type[k];
-	  theta_e_k = soil_properties[soil_num_k].theta_e;
-	  theta_r_k = soil_properties[soil_num_k].theta_r;
-	  vg_a_k    = soil_properties[soil_num_k].vg_alpha_per_cm;
-	  vg_m_k    = soil_properties[soil_num_k].vg_m;
-	  vg_n_k    = soil_properties[soil_num_k].vg_n;
-
-	  double theta_old = calc_theta_from_h(psi_cm_old, vg_a_k, vg_m_k, vg_n_k, theta_e_k,theta_r_k);
-	  double theta_below_old = calc_theta_from_h(psi_cm_below_old, vg_a_k, vg_m_k, vg_n_k, theta_e_k, theta_r_k);
+
+	  double theta_old = soil_theta_from_h(&soil_properties[soil_num_k], psi_cm_old);
+	  double theta_below_old = soil_theta_from_h(&soil_properties[soil_num_k], psi_cm_below_old);
 	  double local_delta_theta_old = theta_old - theta_below_old;
 	  double layer_thickness = (cum_layer_thickness_cm[k] - cum_layer_thickness_cm[k-1]);
 
@@ -2077,9 +2484,9 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
 
 	  //-------------------------------------------
 	  // do the same for the current state
-	  double theta = calc_theta_from_h(psi_cm, vg_a_k, vg_m_k, vg_n_k, theta_e_k, theta_r_k);
+	  double theta = soil_theta_from_h(&soil_properties[soil_num_k], psi_cm);
 
-	  double theta_below = calc_theta_from_h(psi_cm_below, vg_a_k, vg_m_k, vg_n_k, theta_e_k, theta_r_k);
+	  double theta_below = soil_theta_from_h(&soil_properties[soil_num_k], psi_cm_below);
 
 	  new_mass += layer_thickness * (theta - theta_below);
 
@@ -2101,11 +2508,11 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
 	double applied_interflow_flux_cm = lgar_apply_interflow_flux_to_prior_mass(interflow_flux_cm_by_front[wf], &prior_mass,
 									       minimum_prior_mass_cm,
 									       interflow_subtimestep_cm);
-	if (applied_interflow_flux_cm > 0.0 && verbosity.compare("high") == 0) {
+	if (applied_interflow_flux_cm > 0.0 && LGAR_LOG_HIGH) {
 	  printf("Applied interflow to WF %d mass balance: %.10e cm\n", wf, applied_interflow_flux_cm);
 	}
   // theta mass balance computes new theta that conserves the mass; new theta is assigned to the current wetting front
-	double theta_new = lgar_theta_mass_balance(layer_num, soil_num, psi_cm, new_mass, prior_mass, precip_mass_to_add, AET_demand_cm,
+	double theta_new = lgar_theta_mass_balance(layer_num, soil_num, psi_cm, new_mass, prior_mass, AET_demand_cm,
 						   delta_thetas, delta_thickness, soil_type, soil_properties);
   actual_ET_demand = *AET_demand_cm;
   //done with delta_thetas and delta_thickness, cleanup memory
@@ -2116,7 +2523,7 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
       }
 
       double Se = calc_Se_from_theta(current->theta,theta_e,theta_r);
-      current->psi_cm = calc_h_from_Se(Se, vg_a, vg_m, vg_n);
+      current->psi_cm = soil_h_from_Se(&soil_properties[soil_num], Se);
 
     }
   
@@ -2128,7 +2535,7 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
     if (wf == 1) { 
 
       wf_free_drainage_demand = wetting_front_free_drainage(*head);
-      struct wetting_front *wf_free_drainage = listFindFront(wf_free_drainage_demand, *head, NULL);
+      struct wetting_front *wf_free_drainage = fronts[wf_free_drainage_demand];
     // if ((wf == wf_free_drainage_demand) && (current->theta>=theta_e) ) {
       int soil_num_k1  = soil_type[wf_free_drainage->layer_num];
       double theta_e_k1 = soil_properties[soil_num_k1].theta_e;
@@ -2144,67 +2551,57 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
 
       double mass_balance_error = fabs(current_mass - mass_timestep); // mass error
 
-      double factor = 1.0;
-      if (wf_free_drainage->next!=NULL){
-        if (fabs(wf_free_drainage->theta - wf_free_drainage->next->theta)<0.01){// if two adjacent theta values are quite close, an initial factor of 1.0 might not make the mass balance close within 10000 iterations
-          factor = factor / fabs(wf_free_drainage->theta - wf_free_drainage->next->theta);
-        }
-      }
-
-      // double factor = fmax(1,current->psi_cm/100); speed optimization should look at optimal factor values 
-      bool switched = false;
-
       double depth_new = wf_free_drainage->depth_cm;
-
-      // loop to adjust the depth for mass balance
-      int iter = 0;
-      bool iter_aug_flag = FALSE;
       bool break_flag = FALSE;
-      int speedup_thresh = MAX_ITER_SATURATION_MBAL_LOOP/10;
 
       if (fabs(mass_balance_error) > MBAL_ITERATIVE_TOLERANCE){
-        if (verbosity.compare("high") == 0) {
+        if (LGAR_LOG_HIGH) {
           printf("start WF depth adjustment due to saturation");
           listPrint(*head);
         }
       }
 
-      while (fabs(mass_balance_error) > MBAL_ITERATIVE_TOLERANCE) {
-        iter++;
-        if (iter>MAX_ITER_SATURATION_MBAL_LOOP) {
+      if ( (wf_free_drainage->to_bottom==TRUE) && (wf_free_drainage->layer_num==num_layers) ){
+        // the front is pinned to the bottom of the domain, so its depth cannot close the mass balance
+        depth_new = cum_layer_thickness_cm[num_layers];
+        wf_free_drainage->depth_cm = depth_new;
+
+        current_mass = lgar_calc_mass_bal(cum_layer_thickness_cm, *head);
+        mass_balance_error = fabs(current_mass - mass_timestep);
+
+        if (mass_balance_error > MBAL_ITERATIVE_TOLERANCE) {
           break_flag = TRUE;
           *AET_demand_cm = *AET_demand_cm + mass_balance_error;
           actual_ET_demand = *AET_demand_cm;
-          break;
-        }
-
-        if ((iter>speedup_thresh) && (!iter_aug_flag)){
-          factor = factor * 100;
-          iter_aug_flag = TRUE;
-        }
-
-        if (current_mass < mass_timestep) {
-          depth_new += 0.01 * factor;
-          switched = false;
         }
-        else {
-          if (!switched) {
-            switched = true;
-            factor = factor * 0.1;
-          }
-          depth_new -= 0.01 * factor;
-
+      }
+      else {
+        // the profile mass is linear in the depth of this front (see lgar_calc_mass_bal), with slope equal to
+        // its theta minus the theta of the next front if that front is in the same layer, so the depth that
+        // closes the mass balance is found directly; the extra steps only remove round-off
+        struct wetting_front *next_wf = wf_free_drainage->next;
+        double dmass_ddepth = wf_free_drainage->theta;
+        if ( (next_wf != NULL) && (next_wf->layer_num == wf_free_drainage->layer_num) )
+          dmass_ddepth -= next_wf->theta;
+
+        for (int iter = 0; (iter < 3) && (mass_balance_error > MBAL_ITERATIVE_TOLERANCE); iter++) {
+          depth_new += (mass_timestep - current_mass) / dmass_ddepth; // infinite if dmass_ddepth is 0, handled below
+          wf_free_drainage->depth_cm = depth_new;
+
+          if (isinf(depth_new))
+            break;
+
+          current_mass = lgar_calc_mass_bal(cum_layer_thickness_cm, *head);
+          mass_balance_error = fabs(current_mass - mass_timestep);
         }
 
-        if ( (wf_free_drainage->to_bottom==TRUE) && (wf_free_drainage->layer_num==num_layers) ){
-          depth_new = cum_layer_thickness_cm[num_layers];
+        if ( !isinf(depth_new) && (mass_balance_error > MBAL_ITERATIVE_TOLERANCE) ) {
+          // the depth could not close the mass balance (e.g. the slope is tiny and round-off dominates); as when the
+          // earlier iterative search ran out of iterations, the remaining error goes to AET
+          break_flag = TRUE;
+          *AET_demand_cm = *AET_demand_cm + mass_balance_error;
+          actual_ET_demand = *AET_demand_cm;
         }
-
-        wf_free_drainage->depth_cm = depth_new;
-
-        current_mass = lgar_calc_mass_bal(cum_layer_thickness_cm, *head);
-        mass_balance_error = fabs(current_mass - mass_timestep);
-
       }
 
       if (depth_new<TRUNCATION_DEPTH){ // extremely rare error where, if the WFs below this one are extremely dry (psi values > 1.E7) and WF below have layer n values close to 1 (say 1.02 or so),
@@ -2246,7 +2643,7 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
   /*******************************************************************/
 
 
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     printf("State after moving but before merging wetting fronts...\n");
     listPrint(*head);
   }
@@ -2267,7 +2664,7 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
   while (correction_type_surf!=0){
 
     if (correction_type_surf==1){
-      lgar_merge_wetting_fronts(soil_type, frozen_factor, head, soil_properties);
+      lgar_merge_wetting_fronts(soil_type, frozen_factor, head, pool, soil_properties);
     }
 
     if (correction_type_surf==2){
@@ -2281,7 +2678,7 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
 
     if (correction_type_surf==3){
       // bottom_boundary_flux_cm += lgar_wetting_front_cross_domain_boundary(TO_enabled, cum_layer_thickness_cm, soil_type, frozen_factor, head, soil_properties);
-      bottom_boundary_flux_cm += lgar_wetting_front_cross_domain_boundary(cum_layer_thickness_cm[num_layers], soil_type, frozen_factor, head, soil_properties);
+      bottom_boundary_flux_cm += lgar_wetting_front_cross_domain_boundary(cum_layer_thickness_cm[num_layers], soil_type, frozen_factor, head, pool, soil_properties);
           if (isnan(bottom_boundary_flux_cm)){
             bottom_boundary_flux_cm = 0.0;
           }
@@ -2289,12 +2686,12 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
 
     if (correction_type_surf==4){
       mass_change = 0.0;
-      lgar_fix_dry_over_wet_wetting_fronts(&mass_change, cum_layer_thickness_cm, soil_type, head, soil_properties);
+      lgar_fix_dry_over_wet_wetting_fronts(&mass_change, cum_layer_thickness_cm, soil_type, head, pool, soil_properties);
       *AET_demand_cm = *AET_demand_cm - mass_change;
     }
 
     correction_type_surf =  lgarto_correction_type_surf(num_layers, cum_layer_thickness_cm, head);
-    if (verbosity.compare("high") == 0) {
+    if (LGAR_LOG_HIGH) {
       printf("correction_type_surf at end of iteration in while loop: %d \n", correction_type_surf);
     }
   }
@@ -2315,25 +2712,22 @@ extern double lgar_move_wetting_fronts(double timestep_h, double *free_drainage_
 
     double theta_e_k   = soil_properties[soil_num_k].theta_e;
     double theta_r_k   = soil_properties[soil_num_k].theta_r;
-    double vg_a_k      = soil_properties[soil_num_k].vg_alpha_per_cm;
-    double vg_m_k      = soil_properties[soil_num_k].vg_m;
-    double vg_n_k      = soil_properties[soil_num_k].vg_n;
 
     double Ksat_cm_per_h_k  = frozen_factor[current->layer_num] * soil_properties[soil_num_k].Ksat_cm_per_h;
 
     double Se = calc_Se_from_theta(current->theta,theta_e_k,theta_r_k);
     if (current->psi_cm>1.0){
-      current->psi_cm = calc_h_from_Se(Se, vg_a_k, vg_m_k, vg_n_k); 
+      current->psi_cm = soil_h_from_Se(&soil_properties[soil_num_k], Se); 
     }
 
-    current->K_cm_per_h = calc_K_from_Se(Se, Ksat_cm_per_h_k, vg_m_k);
+    current->K_cm_per_h = soil_K_from_Se(&soil_properties[soil_num_k], Se, Ksat_cm_per_h_k);
 
     current = current->next;
 
   }
 
 
-  if (verbosity.compare("high") == 0){
+  if (LGAR_LOG_HIGH){
     printf("Moving/merging wetting fronts done... \n");
     listPrint(*head);
   }
@@ -2392,7 +2786,7 @@ static bool lgar_wetting_fronts_can_merge(struct wetting_front *current)
 }
 
 extern void lgar_merge_wetting_fronts(int *soil_type, double *frozen_factor, struct wetting_front** head,
-				      struct soil_properties_ *soil_properties)
+				      struct wetting_front_pool *pool, struct soil_properties_ *soil_properties)
 {
   
   struct wetting_front *current;
@@ -2400,7 +2794,7 @@ extern void lgar_merge_wetting_fronts(int *soil_type, double *frozen_factor, str
   struct wetting_front *next_to_next;
   current = *head;
 
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     printf("State before merging wetting fronts...\n");
     listPrint(*head);
     printf("Merging wetting fronts... \n");
@@ -2408,13 +2802,12 @@ extern void lgar_merge_wetting_fronts(int *soil_type, double *frozen_factor, str
 
   // local variables
   double theta_e,theta_r;
-  double vg_a, vg_m, vg_n;
   double Se, Ksat_cm_per_h;
   int layer_num, soil_num;
     
   for (int wf=1; wf != listLength(*head); wf++) {
     
-    if (verbosity.compare("high") == 0) {
+    if (LGAR_LOG_HIGH) {
       printf("Merge | ********* Wetting Front = %d *********\n", wf);
     }
 
@@ -2438,24 +2831,21 @@ extern void lgar_merge_wetting_fronts(int *soil_type, double *frozen_factor, str
       soil_num  = soil_type[layer_num];
       theta_e   = soil_properties[soil_num].theta_e;
       theta_r   = soil_properties[soil_num].theta_r;
-      vg_a      = soil_properties[soil_num].vg_alpha_per_cm;
-      vg_m      = soil_properties[soil_num].vg_m;
-      vg_n      = soil_properties[soil_num].vg_n;
       Se        = calc_Se_from_theta(current->theta,theta_e,theta_r);
 
       Ksat_cm_per_h  = soil_properties[soil_num].Ksat_cm_per_h * frozen_factor[current->layer_num];
 
-      current->psi_cm     = calc_h_from_Se(Se, vg_a, vg_m, vg_n);
-      current->K_cm_per_h = calc_K_from_Se(Se, Ksat_cm_per_h, vg_m);
+      current->psi_cm     = soil_h_from_Se(&soil_properties[soil_num], Se);
+      current->K_cm_per_h = soil_K_from_Se(&soil_properties[soil_num], Se, Ksat_cm_per_h);
       
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
         printf ("Deleting wetting front (before)... \n");
         listPrint(*head);
       }
       
-      next = listDeleteFront(next->front_num, head, soil_type, soil_properties);;
+      next = listDeleteFront(next->front_num, head, pool, soil_type, soil_properties);;
       
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
         printf ("Deleting wetting front (after) ... \n");
         listPrint(*head);
       }
@@ -2466,7 +2856,7 @@ extern void lgar_merge_wetting_fronts(int *soil_type, double *frozen_factor, str
     current = current->next;
   }
 
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     printf("State after merging wetting fronts...\n");
     listPrint(*head);
   }
@@ -2494,7 +2884,7 @@ extern void lgar_wetting_fronts_cross_layer_boundary(int num_layers,
   bool theta_correction_necessary = false;
   int front_for_cross = -1;
 
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     printf("Layer boundary crossing... \n");
     printf("States before wetting fronts cross layer boundary...\n");
     listPrint(*head);
@@ -2504,7 +2894,6 @@ extern void lgar_wetting_fronts_cross_layer_boundary(int num_layers,
     
     // local variables
     double theta_e,theta_r;
-    double vg_a, vg_m, vg_n;
     int layer_num, soil_num;
 
 
@@ -2512,9 +2901,6 @@ extern void lgar_wetting_fronts_cross_layer_boundary(int num_layers,
     soil_num    = soil_type[layer_num];
     theta_e     = soil_properties[soil_num].theta_e;
     theta_r     = soil_properties[soil_num].theta_r;
-    vg_a        = soil_properties[soil_num].vg_alpha_per_cm;
-    vg_m        = soil_properties[soil_num].vg_m;
-    vg_n        = soil_properties[soil_num].vg_n;
     double Ksat_cm_per_h  = soil_properties[soil_num].Ksat_cm_per_h * frozen_factor[current->layer_num]; //PTL addition to make K_cm_per_h for this conditon to be correct
     
     next = current->next;
@@ -2523,7 +2909,7 @@ extern void lgar_wetting_fronts_cross_layer_boundary(int num_layers,
     if (current->depth_cm > cum_layer_thickness_cm[layer_num] && (next->depth_cm == cum_layer_thickness_cm[layer_num]) && (next->to_bottom)
 	&& (layer_num!=num_layers) ) {
 
-      if (verbosity.compare("high") == 0) {
+      if (LGAR_LOG_HIGH) {
         printf("Boundary Crossing | ******* Wetting Front = %d ****** \n", wf);
       }
 
@@ -2531,20 +2917,15 @@ extern void lgar_wetting_fronts_cross_layer_boundary(int num_layers,
       double overshot_depth = current->depth_cm - next->depth_cm;
       int soil_num_next = soil_type[layer_num+1];
 
-      double next_theta_e   = soil_properties[soil_num_next].theta_e;
-      double next_theta_r   = soil_properties[soil_num_next].theta_r;
-      double next_vg_a      = soil_properties[soil_num_next].vg_alpha_per_cm;
-      double next_vg_m      = soil_properties[soil_num_next].vg_m;
-      double next_vg_n      = soil_properties[soil_num_next].vg_n;
       //double next_Ksat_cm_per_h  = soil_properties[soil_num_next].Ksat_cm_per_h * frozen_factor[current->layer_num]; 
 
       double Se = calc_Se_from_theta(current->theta,theta_e, theta_r);
-      current->psi_cm = calc_h_from_Se(Se, vg_a, vg_m, vg_n);
+      current->psi_cm = soil_h_from_Se(&soil_properties[soil_num], Se);
 
-      current->K_cm_per_h = calc_K_from_Se(Se, Ksat_cm_per_h, vg_m);
+      current->K_cm_per_h = soil_K_from_Se(&soil_properties[soil_num], Se, Ksat_cm_per_h);
       
       // current psi with van Gunechten properties of the next layer to get new theta
-      double theta_new = calc_theta_from_h(current->psi_cm, next_vg_a, next_vg_m, next_vg_n, next_theta_e, next_theta_r);
+      double theta_new = soil_theta_from_h(&soil_properties[soil_num_next], current->psi_cm);
 
       double mbal_correction = overshot_depth * (current_theta - next->theta);
       double mbal_Z_correction = mbal_correction / (theta_new - next_to_next->theta); // this is the new wetting front depth
@@ -2587,25 +2968,21 @@ extern void lgar_wetting_fronts_cross_layer_boundary(int num_layers,
         int soil_num_k1 = soil_type[current_temp->layer_num]; 
         double theta_e_k   = soil_properties[soil_num_k1].theta_e;
         double theta_r_k   = soil_properties[soil_num_k1].theta_r;
-        double vg_a_k      = soil_properties[soil_num_k1].vg_alpha_per_cm;
-        double vg_m_k      = soil_properties[soil_num_k1].vg_m;
-        double vg_n_k      = soil_properties[soil_num_k1].vg_n;
-        current_temp->theta = calc_theta_from_h(current_temp->psi_cm, vg_a_k, vg_m_k, vg_n_k,theta_e_k,theta_r_k);
+        current_temp->theta = soil_theta_from_h(&soil_properties[soil_num_k1], current_temp->psi_cm);
         double Ksat_cm_per_h_k  = soil_properties[soil_num_k1].Ksat_cm_per_h;
         double Se = calc_Se_from_theta(current_temp->theta,theta_e_k, theta_r_k);
-        current_temp->K_cm_per_h = calc_K_from_Se(Se, Ksat_cm_per_h_k, vg_m_k);
+        current_temp->K_cm_per_h = soil_K_from_Se(&soil_properties[soil_num_k1], Se, Ksat_cm_per_h_k);
       }
       else{
         int soil_num_k1 = soil_type[current_temp->layer_num]; 
         double theta_e_k   = soil_properties[soil_num_k1].theta_e;
         double theta_r_k   = soil_properties[soil_num_k1].theta_r;
-        double vg_m_k      = soil_properties[soil_num_k1].vg_m;
         double Ksat_cm_per_h_k  = soil_properties[soil_num_k1].Ksat_cm_per_h;
         double Se = calc_Se_from_theta(current_temp->theta,theta_e_k, theta_r_k);
-        current_temp->K_cm_per_h = calc_K_from_Se(Se, Ksat_cm_per_h_k, vg_m_k);
+        current_temp->K_cm_per_h = soil_K_from_Se(&soil_properties[soil_num_k1], Se, Ksat_cm_per_h_k);
       }
     }
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     printf("States after wetting fronts cross layer boundary before theta correction...\n");
     listPrint(*head);
   }
@@ -2619,7 +2996,7 @@ extern void lgar_wetting_fronts_cross_layer_boundary(int num_layers,
           int front_num_correction = current->front_num;
           // first, lgar_theta_mass_balance_correction will attempt to close the mass balance by adjusting the theta value of the WF that crossed the layer boundary and other WFs sharing a psi value with it.
           lgar_theta_mass_balance_correction(false, front_num_correction, prior_mass, head, cum_layer_thickness_cm, soil_type, soil_properties); 
-            if (verbosity.compare("high") == 0) {
+            if (LGAR_LOG_HIGH) {
               printf("States after wetting fronts cross layer boundary and after theta correction...\n");
               listPrint(*head);
             }
@@ -2682,7 +3059,7 @@ extern void lgar_wetting_fronts_cross_layer_boundary(int num_layers,
     } 
   }
 
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     printf("States after wetting fronts cross layer boundary...\n");
     listPrint(*head);
   }
@@ -2698,7 +3075,7 @@ extern void lgar_wetting_fronts_cross_layer_boundary(int num_layers,
 
 extern double lgar_wetting_front_cross_domain_boundary(double domain_depth_cm, int *soil_type,
 						       double *frozen_factor, struct wetting_front** head,
-						       struct soil_properties_ *soil_properties)
+						       struct wetting_front_pool *pool, struct soil_properties_ *soil_properties)
 {
   struct wetting_front *current;
   struct wetting_front *next;
@@ -2707,19 +3084,18 @@ extern double lgar_wetting_front_cross_domain_boundary(double domain_depth_cm, i
   double bottom_flux_cm = 0.0;
   int length = listLength(*head);
   
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     printf("Domain boundary crossing (bottom flux calc.) \n");
   }
 
   // local variables
   double theta_e,theta_r;
-  double vg_a, vg_m, vg_n;
   double bottom_flux_cm_temp;
   int layer_num, soil_num;
     
   for (int wf=1; wf != length; wf++) {
 
-    if (verbosity.compare("high") == 0) {
+    if (LGAR_LOG_HIGH) {
       printf("Domain boundary crossing | ***** Wetting Front = %d ****** \n", wf);
     }
 
@@ -2742,16 +3118,13 @@ extern double lgar_wetting_front_cross_domain_boundary(double domain_depth_cm, i
       bottom_flux_cm_temp = (current->theta - next->theta) *  (current->depth_cm - next->depth_cm);
       theta_e   = soil_properties[soil_num].theta_e;
       theta_r   = soil_properties[soil_num].theta_r;
-      vg_a      = soil_properties[soil_num].vg_alpha_per_cm;
-      vg_m      = soil_properties[soil_num].vg_m;
-      vg_n      = soil_properties[soil_num].vg_n;
       double Ksat_cm_per_h  = soil_properties[soil_num].Ksat_cm_per_h * frozen_factor[current->layer_num];
 
       next->theta = current->theta;
       double Se_k = calc_Se_from_theta(current->theta,theta_e,theta_r);
-      next->psi_cm = calc_h_from_Se(Se_k, vg_a, vg_m, vg_n);
-      next->K_cm_per_h = calc_K_from_Se(Se_k, Ksat_cm_per_h, vg_m);
-      current = listDeleteFront(current->front_num, head, soil_type, soil_properties);
+      next->psi_cm = soil_h_from_Se(&soil_properties[soil_num], Se_k);
+      next->K_cm_per_h = soil_K_from_Se(&soil_properties[soil_num], Se_k, Ksat_cm_per_h);
+      current = listDeleteFront(current->front_num, head, pool, soil_type, soil_properties);
       bottom_flux_cm += bottom_flux_cm_temp; 
       break;
     }
@@ -2763,7 +3136,7 @@ extern double lgar_wetting_front_cross_domain_boundary(double domain_depth_cm, i
     }
   }
 
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     printf("State after lowest wetting front contributes to flux through the bottom boundary...\n");
     listPrint(*head);
     printf("Bottom boundary flux = %lf \n",bottom_flux_cm);
@@ -2781,12 +3154,13 @@ extern double lgar_wetting_front_cross_domain_boundary(double domain_depth_cm, i
   drainage is enabled it can do the same thing */
 // ############################################################################################
 extern void lgar_fix_dry_over_wet_wetting_fronts(double *mass_change, double* cum_layer_thickness_cm, int *soil_type,
-					 struct wetting_front** head, struct soil_properties_ *soil_properties)
+					 struct wetting_front** head, struct wetting_front_pool *pool,
+					 struct soil_properties_ *soil_properties)
 {
   // This function will delete the wetting front that is drier than the WF below it that is in the same layer, and then it will 
   // iteratively adjust the psi and theta values of the region of the soil column that should have just 1 psi value now that a WF was deleted.
   // mass_change will return any mass balance error and should usually be 0.0
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     printf("Fix Dry over Wet Wetting Front (before) ... \n");
     listPrint(*head);
   }
@@ -2806,7 +3180,7 @@ extern void lgar_fix_dry_over_wet_wetting_fronts(double *mass_change, double* cu
       if ( (current->theta <= next->theta) && (current->layer_num == next->layer_num) ) {
 
         double prior_mass = lgar_calc_mass_bal(cum_layer_thickness_cm, *head);
-        current = listDeleteFront(current->front_num, head, soil_type, soil_properties); //current will be the WF directly after the one that got deleted
+        current = listDeleteFront(current->front_num, head, pool, soil_type, soil_properties); //current will be the WF directly after the one that got deleted
         int front_num_correction = current->front_num;
         lgar_theta_mass_balance_correction(true, front_num_correction, prior_mass, head, cum_layer_thickness_cm, soil_type, soil_properties);
         double mass_after = lgar_calc_mass_bal(cum_layer_thickness_cm, *head);
@@ -2824,7 +3198,7 @@ extern void lgar_fix_dry_over_wet_wetting_fronts(double *mass_change, double* cu
 
     }
   }
-if (verbosity.compare("high") == 0) {
+if (LGAR_LOG_HIGH) {
   printf("Fix Dry over Wet Wetting Front (after) ... \n");
   listPrint(*head);
 }
@@ -2869,19 +3243,17 @@ extern bool lgar_check_dry_over_wet_wetting_fronts(struct wetting_front* head)
    in the current timestep, that is precipitation in the current and previous
    timesteps was greater than zero */
 // ############################################################################################
-extern double lgar_insert_water(bool use_closed_form_G, int nint, double timestep_h, double AET_demand_cm, double free_drainage_subtimestep_cm, double *ponded_depth_cm,
+extern double lgar_insert_water(bool use_closed_form_G, int nint, struct Geff_quadrature *quadrature, double timestep_h, double AET_demand_cm, double free_drainage_subtimestep_cm, double *ponded_depth_cm,
 				double *volin_this_timestep, double precip_timestep_cm, int wf_free_drainage_demand,
 			        int num_layers, double ponded_depth_max_cm, int *soil_type,
-				double *cum_layer_thickness_cm, double *frozen_factor,
+				double *cum_layer_thickness_cm, const struct lgar_derived_constants *derived,
 				struct wetting_front* head, struct soil_properties_ *soil_properties)
 {
   // note ponded_depth_cm is a pointer.   Access its value as (*ponded_depth_cm).
   int wf_that_supplies_free_drainage_demand = wf_free_drainage_demand;
   // local vars
-  double theta_e, theta_r;
-  double vg_a, vg_m, vg_n,Ksat_cm_per_h;
-  double h_min_cm;
-  struct wetting_front *current;
+  double theta_e;
+  double Ksat_cm_per_h;
   struct wetting_front *current_free_drainage;
   struct wetting_front *current_free_drainage_next;
   int soil_num;
@@ -2890,7 +3262,6 @@ extern double lgar_insert_water(bool use_closed_form_G, int nint, double timeste
 
   double h_p = fmax(*ponded_depth_cm - precip_timestep_cm * timestep_h, 0.0); // water ponded on the surface
 
-  current = head;
   current_free_drainage      = listFindFront(wf_that_supplies_free_drainage_demand, head, NULL);
   current_free_drainage_next = listFindFront(wf_that_supplies_free_drainage_demand+1, head, NULL);
 
@@ -2904,8 +3275,7 @@ extern double lgar_insert_water(bool use_closed_form_G, int nint, double timeste
 
   if (number_of_wetting_fronts == num_layers) {
     Geff = 0.0; // i.e., case of no capillary suction, dz/dt is also zero for all wetting fronts
-    soil_num = soil_type[layer_num_fp];
-    Ksat_cm_per_h = soil_properties[soil_num].Ksat_cm_per_h * frozen_factor[current->layer_num]; //23 feb 2024
+    Ksat_cm_per_h = derived->Ksat_cm_per_h[layer_num_fp]; //23 feb 2024
   }
   else {
 
@@ -2915,19 +3285,12 @@ extern double lgar_insert_water(bool use_closed_form_G, int nint, double timeste
     soil_num = soil_type[layer_num_fp];
 
     theta_e = soil_properties[soil_num].theta_e;  // rhs of the new front, assumes theta_e as per Peter
-    theta_r = soil_properties[soil_num].theta_r;
-    h_min_cm = soil_properties[soil_num].h_min_cm;
-    vg_a     = soil_properties[soil_num].vg_alpha_per_cm;
-    vg_m     = soil_properties[soil_num].vg_m;
-    vg_n     = soil_properties[soil_num].vg_n;
-    double lambda = soil_properties[soil_num].bc_lambda;
-    double bc_psib_cm = soil_properties[soil_num].bc_psib_cm;
-    Ksat_cm_per_h = soil_properties[soil_num].Ksat_cm_per_h * frozen_factor[current->layer_num];
+    Ksat_cm_per_h = derived->Ksat_cm_per_h[layer_num_fp];
 
     // Se = calc_Se_from_theta(theta,theta_e,theta_r);
     // psi_cm = calc_h_from_Se(Se, vg_a, vg_m, vg_n);
 
-    Geff = calc_Geff(use_closed_form_G, theta_below, theta_e, theta_e, theta_r, vg_a, vg_n, vg_m, h_min_cm, Ksat_cm_per_h, nint, lambda, bc_psib_cm); 
+    Geff = soil_Geff(&soil_properties[soil_num], use_closed_form_G, theta_below, theta_e, Ksat_cm_per_h, nint, quadrature);
 
   }
 
@@ -2940,8 +3303,7 @@ extern double lgar_insert_water(bool use_closed_form_G, int nint, double timeste
     double bottom_sum = (current_free_drainage->depth_cm - cum_layer_thickness_cm[layer_num_fp-1])/Ksat_cm_per_h;
 
     for (int k = 1; k < layer_num_fp; k++) {
-      int soil_num_k = soil_type[layer_num_fp-k];
-      double Ksat_cm_per_h_k = soil_properties[soil_num_k].Ksat_cm_per_h * frozen_factor[layer_num_fp - k];
+      double Ksat_cm_per_h_k = derived->Ksat_cm_per_h[layer_num_fp - k];
 
       bottom_sum += (cum_layer_thickness_cm[layer_num_fp - k] - cum_layer_thickness_cm[layer_num_fp - (k+1)])/ Ksat_cm_per_h_k;
     }
@@ -2952,12 +3314,7 @@ extern double lgar_insert_water(bool use_closed_form_G, int nint, double timeste
 
   //this code checks if there is enough storage available for infiltrating water. That is, f_p can only be as big as there is room for water, but also considering that some water will leave via AET and free drainage. 
   double current_mass = lgar_calc_mass_bal(cum_layer_thickness_cm, head);
-  double max_storage = 0.0;
-  for (int k = 1; k < num_layers+1; k++) {
-    int layer_num = k;
-    soil_num = soil_type[layer_num];
-    max_storage += soil_properties[soil_num].theta_e * (cum_layer_thickness_cm[k]-cum_layer_thickness_cm[k-1]);
-  }
+  double max_storage = derived->max_storage_cm;
 
   if (f_p > (max_storage + free_drainage_subtimestep_cm + AET_demand_cm - current_mass)/timestep_h){
     f_p = (max_storage + free_drainage_subtimestep_cm + AET_demand_cm - current_mass)/timestep_h;
@@ -3013,14 +3370,15 @@ extern double lgar_insert_water(bool use_closed_form_G, int nint, double timeste
 // ######################################################################################
 extern void lgar_create_surficial_front(int num_layers, double *ponded_depth_cm, double *volin, double dry_depth,
 					double theta1, int *soil_type, double *cum_layer_thickness_cm,
-					double *frozen_factor, struct wetting_front** head, struct soil_properties_ *soil_properties)
+					double *frozen_factor, struct wetting_front** head, struct wetting_front_pool *pool,
+					struct soil_properties_ *soil_properties)
 {
   // into the soil.  Note ponded_depth_cm is a pointer.   Access its value as (*ponded_depth_cm).
 
   // local vars
   double theta_e,Se,theta_r;
   double delta_theta;
-  double vg_alpha_per_cm, vg_m, vg_n, Ksat_cm_per_h;
+  double Ksat_cm_per_h;
 
   bool to_bottom = FALSE;
   struct wetting_front *current;
@@ -3042,7 +3400,7 @@ extern void lgar_create_surficial_front(int num_layers, double *ponded_depth_cm,
     {
       *volin = *ponded_depth_cm;
       theta_new = fmin(theta1 + (*ponded_depth_cm) /dry_depth, theta_e);
-      listInsertFirst(dry_depth, theta_new, front_num, layer_num, to_bottom, head);
+      listInsertFirst(dry_depth, theta_new, front_num, layer_num, to_bottom, head, pool);
       *ponded_depth_cm = 0.0;
       //hp_cm =0.0;
     }
@@ -3052,23 +3410,20 @@ extern void lgar_create_surficial_front(int num_layers, double *ponded_depth_cm,
       *ponded_depth_cm -= dry_depth * delta_theta;
       theta_new = theta_e; //fmin(theta1 + (*ponded_depth_cm) /dry_depth, theta_e);
       if (dry_depth < cum_layer_thickness_cm[1])
-	listInsertFirst(dry_depth, theta_e, front_num, layer_num, to_bottom, head);
+	listInsertFirst(dry_depth, theta_e, front_num, layer_num, to_bottom, head, pool);
       else
-	// listInsertFirst(dry_depth, theta_e, front_num, layer_num, 1, head);
-  listInsertFirst(dry_depth, theta_e, front_num, layer_num, to_bottom, head); //the idea here is that a new WF should never have to_bottom as 1 -- if it needs to merge with the one below it, it will
+	// listInsertFirst(dry_depth, theta_e, front_num, layer_num, 1, head, pool);
+  listInsertFirst(dry_depth, theta_e, front_num, layer_num, to_bottom, head, pool); //the idea here is that a new WF should never have to_bottom as 1 -- if it needs to merge with the one below it, it will
       //hp_cm = *ponded_depth_cm;
     }
 
   current = *head;  // must do this again because listInsertFirst() created a new *head
-  vg_alpha_per_cm    = soil_properties[soil_num].vg_alpha_per_cm;
-  vg_m               = soil_properties[soil_num].vg_m;
-  vg_n               = soil_properties[soil_num].vg_n;
   Ksat_cm_per_h      = soil_properties[soil_num].Ksat_cm_per_h * frozen_factor[layer_num];
 
   Se = calc_Se_from_theta(theta_new,theta_e,theta_r);
-  current->psi_cm = calc_h_from_Se(Se, vg_alpha_per_cm , vg_m, vg_n);
+  current->psi_cm = soil_h_from_Se(&soil_properties[soil_num], Se);
 
-  current->K_cm_per_h = calc_K_from_Se(Se, Ksat_cm_per_h, vg_m) * frozen_factor[layer_num]; // AJ - K_temp in python version for 1st layer
+  current->K_cm_per_h = soil_K_from_Se(&soil_properties[soil_num], Se, Ksat_cm_per_h) * frozen_factor[layer_num]; // AJ - K_temp in python version for 1st layer
 
   current->dzdt_cm_per_h = 0.0; //for now assign 0 to dzdt as it will be computed/updated in lgar_dzdt_calc function
 
@@ -3078,7 +3433,7 @@ extern void lgar_create_surficial_front(int num_layers, double *ponded_depth_cm,
       // Technically this should be replaced with the function that iteratively checks for merging, layer crossing, lower boundary crossing, and dry over wet, 
       // but because all we are doing is adding a new WF onto a linked list that will not need correction because correction was just done on it, it could be that all we need to do here is merge
       // because the resulting depths should all be in the top layer
-      lgar_merge_wetting_fronts(soil_type, frozen_factor, head, soil_properties);
+      lgar_merge_wetting_fronts(soil_type, frozen_factor, head, pool, soil_properties);
       had_to_merge = true;
       current = *head;
     }
@@ -3099,15 +3454,15 @@ extern void lgar_create_surficial_front(int num_layers, double *ponded_depth_cm,
    described in the 2015 GARTO paper (Lai et al., An efficient and guaranteed stable numerical method ffor
    continuous modeling of infiltration and redistribution with a shallow dynamic water table). */
 // ############################################################################################
-extern double lgar_calc_dry_depth(bool use_closed_form_G, int nint, double timestep_h, double *delta_theta, int *soil_type,
-				  double *cum_layer_thickness_cm, double *frozen_factor,
+extern double lgar_calc_dry_depth(bool use_closed_form_G, int nint, struct Geff_quadrature *quadrature, double timestep_h, double *delta_theta, int *soil_type,
+				  double *cum_layer_thickness_cm, const struct lgar_derived_constants *derived,
 				  struct wetting_front* head, struct soil_properties_ *soil_properties)
 {
 
   // local variables
   struct wetting_front *current;
-  double theta1,theta2,theta_e,theta_r;
-  double vg_alpha_per_cm,vg_n,vg_m,Ksat_cm_per_h,h_min_cm;
+  double theta1,theta2,theta_e;
+  double Ksat_cm_per_h;
   double tau;
   double Geff;
   double dry_depth;
@@ -3120,14 +3475,7 @@ extern double lgar_calc_dry_depth(bool use_closed_form_G, int nint, double times
   soil_num   = soil_type[layer_num];
 
   // copy values of soil properties into shorter variable names to improve readability
-  theta_r         = soil_properties[soil_num].theta_r;
-  vg_alpha_per_cm = soil_properties[soil_num].vg_alpha_per_cm;
-  vg_m            = soil_properties[soil_num].vg_m;
-  vg_n            = soil_properties[soil_num].vg_n;
-  Ksat_cm_per_h   = soil_properties[soil_num].Ksat_cm_per_h * frozen_factor[layer_num];
-  h_min_cm        = soil_properties[soil_num].h_min_cm;
-  double lambda = soil_properties[soil_num].bc_lambda;
-  double bc_psib_cm = soil_properties[soil_num].bc_psib_cm;
+  Ksat_cm_per_h   = derived->Ksat_cm_per_h[layer_num];
 
   // these are the limits of integration
   theta1   = current->theta;                 // water content of the first (most surficial) existing wetting front
@@ -3138,7 +3486,7 @@ extern double lgar_calc_dry_depth(bool use_closed_form_G, int nint, double times
 
   tau  = timestep_h * Ksat_cm_per_h/(theta_e-current->theta); //3600
 
-  Geff = calc_Geff(use_closed_form_G, theta1, theta2, theta_e, theta_r, vg_alpha_per_cm, vg_n, vg_m, h_min_cm, Ksat_cm_per_h, nint, lambda, bc_psib_cm); 
+  Geff = soil_Geff(&soil_properties[soil_num], use_closed_form_G, theta1, theta2, Ksat_cm_per_h, nint, quadrature);
 
   // note that dry depth originally has a factor of 0.5 in front
   dry_depth = 0.5 * (tau + sqrt( tau*tau + 4.0*tau*Geff) );
@@ -3200,7 +3548,7 @@ extern int lgar_read_vG_param_file(char const* vG_param_file_name, int num_soil_
 				    struct soil_properties_ *soil_properties, bool log_mode)
 {
 
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     std::cerr<<"Reading van Genuchten parameters files...\n";
   }
 
@@ -3269,6 +3617,7 @@ extern int lgar_read_vG_param_file(char const* vG_param_file_name, int num_soil_
     /* psi should not be less than this value.  */
     lambda=soil_properties[soil].bc_lambda;
     soil_properties[soil].h_min_cm = soil_properties[soil].bc_psib_cm*(2.0+3.0/lambda)/(1.0+3.0/lambda);
+    lgar_calc_soil_constants(&soil_properties[soil]);
     num_soils_in_file++;
     soil++;
 
@@ -3286,21 +3635,20 @@ extern int lgar_read_vG_param_file(char const* vG_param_file_name, int num_soil_
 /* code to calculate velocity of fronts
    equations with full description are provided in the lgar paper (currently under review) */
 // ############################################################################################
-extern void lgar_dzdt_calc(bool use_closed_form_G, int nint, int num_layers, double h_p, double subtimestep_h, int *soil_type, double *cum_layer_thickness_cm,
-			   double *frozen_factor, struct wetting_front* head, struct soil_properties_ *soil_properties, bool switch_caching, int cache_count, int new_front)
+extern void lgar_dzdt_calc(bool use_closed_form_G, int nint, struct Geff_quadrature *quadrature, double h_p, double subtimestep_h, int *soil_type, double *cum_layer_thickness_cm,
+			   const struct lgar_derived_constants *derived, struct wetting_front* head, struct soil_properties_ *soil_properties, bool switch_caching, int cache_count, int new_front)
 {
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     std::cerr<<"Calculating dz/dt .... \n";
   }
 
   struct wetting_front* current;
   struct wetting_front* next;
 
-  double vg_alpha_per_cm,vg_n,vg_m,Ksat_cm_per_h,theta_e,theta_r;  // local variables to make things clearer
+  double Ksat_cm_per_h;  // local variables to make things clearer
   double delta_theta;
   double Geff;
   double depth_cm;    // the absolute depth down to a wetting front from the surface
-  double h_min_cm;
   double K_cm_per_h;  // unsaturated hydraulic conductivity K(theta) at the RHS of the current wetting front (cm/h)
   double theta1, theta2;  // limits of integration on Geff from theta1 to theta2
   double bottom_sum;  // store a running sum of L_n/K(theta_n) n increasing from 1 to N-1, as we go down in layers N
@@ -3340,15 +3688,7 @@ extern void lgar_dzdt_calc(bool use_closed_form_G, int nint, int num_layers, dou
 
     // SOIL PROPERTIES
     soil_num        = soil_type[layer_num];
-    vg_alpha_per_cm = soil_properties[soil_num].vg_alpha_per_cm;
-    vg_n            = soil_properties[soil_num].vg_n;
-    vg_m            = soil_properties[soil_num].vg_m;
-    theta_e         = soil_properties[soil_num].theta_e;
-    theta_r         = soil_properties[soil_num].theta_r;
-    h_min_cm        = soil_properties[soil_num].h_min_cm;
-    Ksat_cm_per_h   = soil_properties[soil_num].Ksat_cm_per_h * frozen_factor[current->layer_num];
-    double lambda = soil_properties[soil_num].bc_lambda;
-    double bc_psib_cm = soil_properties[soil_num].bc_psib_cm;
+    Ksat_cm_per_h   = derived->Ksat_cm_per_h[layer_num];
 
     next = current->next;    // the next element in the linked list
     if (next == NULL) break; // we're done calculating dZ/dt's because we're at the end of the list
@@ -3377,7 +3717,7 @@ extern void lgar_dzdt_calc(bool use_closed_form_G, int nint, int num_layers, dou
       exit(0);
     }
 
-    Geff = calc_Geff(use_closed_form_G, theta1, theta2, theta_e, theta_r, vg_alpha_per_cm, vg_n, vg_m, h_min_cm, Ksat_cm_per_h, nint, lambda, bc_psib_cm); 
+    Geff = soil_Geff(&soil_properties[soil_num], use_closed_form_G, theta1, theta2, Ksat_cm_per_h, nint, quadrature);
     delta_theta = current->theta - next->theta;
 
     if(current->layer_num == 1) { // this front is in the upper layer
@@ -3391,16 +3731,12 @@ extern void lgar_dzdt_calc(bool use_closed_form_G, int nint, int num_layers, dou
 
       for (int k = 1; k < layer_num; k++) {
 	int soil_num_loc = soil_type[layer_num-k]; // _loc denotes the soil_num is local to this loop
-	double theta_prev_loc = calc_theta_from_h(current->psi_cm, soil_properties[soil_num_loc].vg_alpha_per_cm,
-						  soil_properties[soil_num_loc].vg_m,
-						  soil_properties[soil_num_loc].vg_n,soil_properties[soil_num_loc].theta_e,
-						  soil_properties[soil_num_loc].theta_r);
+	double theta_prev_loc = soil_theta_from_h(&soil_properties[soil_num_loc], current->psi_cm);
 
 
 	double Se_prev_loc = calc_Se_from_theta(theta_prev_loc,soil_properties[soil_num_loc].theta_e,soil_properties[soil_num_loc].theta_r);
 
-	double K_cm_per_h_prev_loc = calc_K_from_Se(Se_prev_loc,soil_properties[soil_num_loc].Ksat_cm_per_h * frozen_factor[layer_num-k],
-						    soil_properties[soil_num_loc].vg_m);
+	double K_cm_per_h_prev_loc = soil_K_from_Se(&soil_properties[soil_num_loc], Se_prev_loc, derived->Ksat_cm_per_h[layer_num-k]);
 
 	denominator += (cum_layer_thickness_cm[k] - cum_layer_thickness_cm[k-1])/ K_cm_per_h_prev_loc;
 
@@ -3425,12 +3761,7 @@ extern void lgar_dzdt_calc(bool use_closed_form_G, int nint, int num_layers, dou
       dzdt = 1e4;
     }
     
-    double largest_K_s = 0.0;
-    for (int ii=1; ii<=num_layers; ii++) {
-      int soil_num = soil_type[ii];
-      double temp_K_s = soil_properties[soil_num].Ksat_cm_per_h;
-      largest_K_s = fmax(temp_K_s, largest_K_s);
-    }
+    double largest_K_s = derived->largest_Ksat_cm_per_h;
 
     if (dzdt>100*largest_K_s){//insanity check; was 1E4 but now addtionally defining based on K_s
       dzdt = 100*largest_K_s;
@@ -3469,163 +3800,156 @@ extern void lgar_dzdt_calc(bool use_closed_form_G, int nint, int num_layers, dou
 
 }
 
+// ############################################################################################
+/* Mass (and its derivative with respect to psi) of the expression that lgar_theta_mass_balance
+   closes, for a common capillary head psi_cm across layers 1..layer_num. The mass decreases
+   monotonically with psi_cm. */
+// ############################################################################################
+static double lgar_theta_mass_and_slope(double psi_cm, int layer_num, int soil_num, double *delta_theta,
+					double *delta_thickness, int *soil_type, struct soil_properties_ *soil_properties,
+					double *theta, double *dmass_dpsi)
+{
+  double mass  = 0.0;
+  double slope = 0.0;
+
+  for (int k=1; k<=layer_num; k++) {
+    int soil_num_loc = (k == layer_num) ? soil_num : soil_type[k]; // _loc denotes the variable is local to the loop
+    double vg_a    = soil_properties[soil_num_loc].vg_alpha_per_cm;
+    double vg_m    = soil_properties[soil_num_loc].vg_m;
+    double vg_n    = soil_properties[soil_num_loc].vg_n;
+    double theta_e = soil_properties[soil_num_loc].theta_e;
+    double theta_r = soil_properties[soil_num_loc].theta_r;
+
+    double theta_layer = soil_theta_from_h(&soil_properties[soil_num_loc], psi_cm);
+
+    mass  += delta_thickness[k] * (theta_layer - delta_theta[k]);
+    slope += delta_thickness[k] * calc_dtheta_dh_from_h(psi_cm, vg_a, vg_m, vg_n, theta_e, theta_r);
+
+    if (k == layer_num)
+      *theta = theta_layer;
+  }
+
+  *dmass_dpsi = slope;
+  return mass;
+}
+
 // ############################################################################################
 /* The function does mass balance for a wetting front to get an updated theta.
-   The head (psi) value is iteratively altered until the error between prior mass and new mass
-   is within a tolerance. This is only used updating WF theta after it moves.*/
+   The head (psi) value is solved for such that the error between prior mass and new mass
+   is within a tolerance. This is only used updating WF theta after it moves.
+   The mass is monotone in psi, so the root is kept in a bracket [psi_lo, psi_hi] between
+   saturation (psi = 0) and PSI_UPPER_LIM; a front that is already drier than PSI_UPPER_LIM
+   may converge beyond it (bracket up to PSI_MAX_CM), as the earlier incremental loop allowed
+   a few iterations above the limit. Newton steps are taken in log(psi) using the
+   analytic d(theta)/dpsi of the van Genuchten curve; a step that leaves the bracket is
+   replaced by bisection, so the solve always converges. */
 // ############################################################################################
 extern double lgar_theta_mass_balance(int layer_num, int soil_num, double psi_cm, double new_mass,
-				      double prior_mass, double precip_mass_to_add, double *AET_demand_cm, double *delta_theta, double *delta_thickness,
+				      double prior_mass, double *AET_demand_cm, double *delta_theta, double *delta_thickness,
 				      int *soil_type, struct soil_properties_ *soil_properties)
 {
 
   double psi_cm_loc = psi_cm; // location psi
   double delta_mass = fabs(new_mass - prior_mass); // mass different between the new and prior
-  // double original_delta_mass = delta_mass; 
-
-  double factor = fmax(1.0,psi_cm/10.0);//was 1.0 previously. This code is far faster and seems to avoid loops with >10000 iterations.
-  if (psi_cm>1.E4){ // in very dry cases, mass conservation will take longer to achieve if using a small factor
-    factor = psi_cm;
-  }
-  bool switched = false; // flag that determines capillary head to be incremented or decremented
 
   double theta             = 0; // this will be updated and returned
-  double psi_cm_loc_prev   = psi_cm_loc;
-  double delta_mass_prev   = delta_mass;
-  int count_no_mass_change = 0;
-  int break_no_mass_change = 5;
+  double dmass_dpsi        = 0.0;
   bool wanted_to_saturate_flag = FALSE;
-  
+
   // check if the difference is less than the tolerance
   if (delta_mass <= MBAL_ITERATIVE_TOLERANCE) {
-    theta = calc_theta_from_h(psi_cm_loc, soil_properties[soil_num].vg_alpha_per_cm,
-			      soil_properties[soil_num].vg_m, soil_properties[soil_num].vg_n,
-			      soil_properties[soil_num].theta_e,soil_properties[soil_num].theta_r);
+    theta = soil_theta_from_h(&soil_properties[soil_num], psi_cm_loc);
     return theta;
   }
 
-  // the loop increments/decrements the capillary head until mass difference between
-  // the new and prior is within the tolerance
-  int iter = 0;
-  bool iter_aug_flag = FALSE;
-  bool iter_aug_flag_extreme = FALSE;
-  int first_speedup_thresh = MAX_ITER_MBAL_LOOP/100;
-  int second_speedup_thresh = MAX_ITER_MBAL_LOOP/10;
-
-  while (delta_mass > MBAL_ITERATIVE_TOLERANCE) {
-    iter++;
+  // bracket the root: the mass at saturation is the largest mass possible, the mass at PSI_UPPER_LIM
+  // is the smallest mass allowed (unrealistic pressures beyond that) unless the front is already drier
+  double psi_lo = 0.0;
+  double psi_hi = (psi_cm > PSI_UPPER_LIM) ? PSI_MAX_CM : PSI_UPPER_LIM;
+  double theta_hi;
+  double mass_hi;
 
-    if (iter>first_speedup_thresh && iter_aug_flag==FALSE){
-      factor = factor*100;
-      iter_aug_flag = TRUE;
-    }
+  new_mass = lgar_theta_mass_and_slope(psi_lo, layer_num, soil_num, delta_theta, delta_thickness, soil_type,
+				       soil_properties, &theta, &dmass_dpsi);
 
-    if (iter>second_speedup_thresh && iter_aug_flag_extreme==FALSE){
-      factor = factor*100;
-      iter_aug_flag_extreme = TRUE;
-    }
-
-    if (new_mass > prior_mass) {
-      psi_cm_loc += 0.1 * factor;
-      switched = false;
-    }
-    else {
-      if (!switched) {
-	switched = true;
-	factor = factor * 0.1;
-      }
-      
-      psi_cm_loc_prev = psi_cm_loc;
-      psi_cm_loc -= 0.1 * factor;
-
-      if (psi_cm_loc<0.0){
-        wanted_to_saturate_flag = TRUE;
-      }
-      
-      if (psi_cm_loc < 0 && psi_cm_loc_prev != 0) {
-	/* this is for the extremely rare case when iterative psi_cm_loc calculation temporarily
-	   yields a negative value and the actual answer for psi_cm_loc is nonzero. For example
-	   when a completely saturated wetting front with a tiny amount of ET should yield a resulting
-	   theta that is slightly below saturation. */
-        psi_cm_loc = psi_cm_loc_prev * 0.1;
-      }
-      
-    }
-
-    if (psi_cm_loc<0.0){ // addresses the case where psi_cm_loc was 0 at the start so psi_cm_loc_prev is 0
-      psi_cm_loc = 0.0;
-      factor = factor * 0.5; // allow factor to smoothly approach 0 in case the solution is slightly above psi = 0
-    }
-
-    double theta_layer;
-    double mass_layers= 0.0;
+  if (new_mass <= prior_mass) {
+    // closing the mass balance would need psi < 0; the wetting front saturates and the extra water goes
+    // into runoff or recharge (handled elsewhere) rather than AET
+    psi_cm_loc = 0.0;
+    delta_mass = fabs(new_mass - prior_mass);
+    wanted_to_saturate_flag = (delta_mass > MBAL_ITERATIVE_TOLERANCE);
+  }
+  else if ((mass_hi = lgar_theta_mass_and_slope(psi_hi, layer_num, soil_num, delta_theta, delta_thickness, soil_type,
+						soil_properties, &theta_hi, &dmass_dpsi)) >= prior_mass) {
+    // closing the mass balance would need psi > psi_hi; return the dry-limit mass
+    psi_cm_loc = psi_hi;
+    theta = theta_hi;
+    delta_mass = fabs(mass_hi - prior_mass);
+  }
+  else {
+    // start from the current psi of the wetting front, which is usually close to the solution
+    psi_cm_loc = (psi_cm > psi_lo && psi_cm < psi_hi) ? psi_cm : 0.5*(psi_lo + psi_hi);
 
-    theta = calc_theta_from_h(psi_cm_loc, soil_properties[soil_num].vg_alpha_per_cm, soil_properties[soil_num].vg_m,
-			      soil_properties[soil_num].vg_n,soil_properties[soil_num].theta_e,
-			      soil_properties[soil_num].theta_r);
+    double psi_cm_best = psi_cm_loc;
+    double delta_mass_best = HUGE_VAL;
+    double theta_best = theta;
 
-    mass_layers += delta_thickness[layer_num] * (theta - delta_theta[layer_num]);
+    for (int iter = 1; iter <= MAX_ITER_MBAL_LOOP; iter++) {
 
-    for (int k=1; k<layer_num; k++) {
-      int soil_num_loc =  soil_type[k]; // _loc denotes the variable is local to the loop
+      new_mass = lgar_theta_mass_and_slope(psi_cm_loc, layer_num, soil_num, delta_theta, delta_thickness, soil_type,
+					   soil_properties, &theta, &dmass_dpsi);
+      delta_mass = fabs(new_mass - prior_mass);
 
-      theta_layer = calc_theta_from_h(psi_cm_loc, soil_properties[soil_num_loc].vg_alpha_per_cm,
-				      soil_properties[soil_num_loc].vg_m, soil_properties[soil_num_loc].vg_n,
-				      soil_properties[soil_num_loc].theta_e, soil_properties[soil_num_loc].theta_r);
+      if (delta_mass < delta_mass_best) {
+	psi_cm_best = psi_cm_loc;
+	delta_mass_best = delta_mass;
+	theta_best = theta;
+      }
 
-      mass_layers += delta_thickness[k] * (theta_layer - delta_theta[k]);
-    }
+      if (delta_mass <= MBAL_ITERATIVE_TOLERANCE)
+	break;
 
-    new_mass = mass_layers;
-    delta_mass = fabs(new_mass - prior_mass);
+      // too much mass means psi is too small (too wet)
+      if (new_mass > prior_mass)
+	psi_lo = psi_cm_loc;
+      else
+	psi_hi = psi_cm_loc;
 
-    // stop the loop if the error between the current and previous psi is less than 10^-15
-    // 1. enough accuracy, 2. the algorithm can't improve the error further,
-    // 3. avoid infinite loop, 4. handles case where theta is very close to theta_r and convergence might be possible but would be extremely slow
-    // 5. handles a corner case when prior mass is tiny (e.g., <1.E-5)
-    // printf("A1 = %.20f, %.18f %.18f %.18f %.18f \n ",fabs(psi_cm_loc - psi_cm_loc_prev) , psi_cm_loc, psi_cm_loc_prev, factor, delta_mass);
-    
-    if (fabs(psi_cm_loc - psi_cm_loc_prev) < 1E-15 && factor < 1E-13) break;
+      // the bracket cannot be narrowed any further in double precision; accept the remaining error
+      if (psi_hi - psi_lo <= 1.E-15 * fmax(1.0, psi_hi))
+	break;
 
-    // another condition to avoid infinite loop when the error does not improve
-    if (fabs(delta_mass - delta_mass_prev) < 1E-15)
-      count_no_mass_change++;
-    else
-      count_no_mass_change = 0;
+      // Newton step in log(psi): d(mass)/d(log psi) = psi * d(mass)/dpsi
+      double dmass_dlogpsi = psi_cm_loc * dmass_dpsi;
+      double psi_cm_next = -1.0;
 
-    // break the loop if the mass does not change in the five consecutive iterations.
-    if (count_no_mass_change == break_no_mass_change && precip_mass_to_add < 1.E-12){ // made it so that this check only occurs if there is no infiltration, because there is a case where precip on a very dry wetting front will need more than 5 iterations to have its mass change at all
-      break;
-    }
+      if (dmass_dlogpsi < 0.0 && isfinite(dmass_dlogpsi)) {
+	double step = (new_mass - prior_mass) / dmass_dlogpsi;
+	if (fabs(step) < 10.0) // limits the step to a factor of e^10 in psi
+	  psi_cm_next = psi_cm_loc * exp(-step);
+      }
 
-    if (iter>MAX_ITER_MBAL_LOOP){ //limit the total number of iterations 
-      break;
-    }
+      // bisection if the Newton step is not strictly inside the bracket (geometric if the bracket spans decades)
+      if ( !(psi_cm_next > psi_lo && psi_cm_next < psi_hi) ) {
+	if (psi_lo > 0.0 && psi_hi > 4.0*psi_lo)
+	  psi_cm_next = sqrt(psi_lo * psi_hi);
+	else
+	  psi_cm_next = 0.5*(psi_lo + psi_hi);
+      }
 
-    if ( (psi_cm_loc > PSI_UPPER_LIM) && (iter > first_speedup_thresh) ){ //unrealistic pressures, but there are some cases where convergence is possible even at large psi values, and there is a case where AET, free drainage, or WF movement can bring psi above PSI_UPPER_LIM, so we do want to allow a few iterations
-      // Return the dry-limit mass, not the slightly drier mass from the last trial step.
-      psi_cm_loc = PSI_UPPER_LIM;
-      theta = calc_theta_from_h(psi_cm_loc, soil_properties[soil_num].vg_alpha_per_cm, soil_properties[soil_num].vg_m,
-				soil_properties[soil_num].vg_n,soil_properties[soil_num].theta_e,
-				soil_properties[soil_num].theta_r);
-      new_mass = lgar_prior_mass_for_psi(psi_cm_loc, layer_num, delta_theta, delta_thickness, soil_type, soil_properties);
-      delta_mass = fabs(new_mass - prior_mass);
-      break;
+      psi_cm_loc = psi_cm_next;
     }
 
-    // -ve pressure will return NAN, so terminate the loop if previous psi is way small and current psi is zero
-    // the wetting front is almost saturated
-    if (psi_cm_loc <= 0 && psi_cm_loc_prev < 0) break;
-
-    delta_mass_prev = delta_mass;
-
+    psi_cm_loc = psi_cm_best;
+    delta_mass = delta_mass_best;
+    theta = theta_best;
   }
 
   //There is a rare case where mass balance closure would require that theta<theta_r. 
-  //However, the above loop can never increase psi to the point where theta<theta_r, because theta must always be between theta_r and theta_r, because of the van Genuchten model (calc_theta_from_h).
-  //If we get to the case where theta<theta_r would be necessary for mass balance closure, then the above loop will break before delta_mass <= tolerance.
+  //However, the above solve can never increase psi to the point where theta<theta_r, because theta must always be between theta_r and theta_r, because of the van Genuchten model (calc_theta_from_h).
+  //If we get to the case where theta<theta_r would be necessary for mass balance closure, then the above solve will stop before delta_mass <= tolerance.
   //In this case, the remaining mass balance error is put into AET. This should usually be acceptable, because it will often be the AET flux that would have been the trigger for theta < theta_r for mass conservation, so reducing AET works in this case.
-  if ((delta_mass > MBAL_ITERATIVE_TOLERANCE) && (!wanted_to_saturate_flag)){//the second condition is necessary because count_no_mass_change == break_no_mass_change in the loop above will trigger when the model approaches saturation; in this event the extra water should go into runoff or recharge (handled elsewhere), because the soil saturates, rather than AET
+  if ((delta_mass > MBAL_ITERATIVE_TOLERANCE) && (!wanted_to_saturate_flag)){//the second condition is necessary because the model can approach saturation; in this event the extra water should go into runoff or recharge (handled elsewhere), because the soil saturates, rather than AET
     *AET_demand_cm = *AET_demand_cm - fabs(delta_mass - MBAL_ITERATIVE_TOLERANCE);
   }
 
@@ -3694,14 +4018,14 @@ extern int lgarto_correction_type_surf(int num_layers, double* cum_layer_thickne
     }
   }
 
-  if (verbosity.compare("high") == 0){
+  if (LGAR_LOG_HIGH){
     printf("computed correction type for surface WFs: %d \n", correction_type_surf);
   }
   return correction_type_surf;
 }
 
-extern void lgar_clean_redundant_fronts(struct wetting_front** head, int *soil_type, struct soil_properties_ *soil_properties){
-  if (verbosity.compare("high") == 0) {
+extern void lgar_clean_redundant_fronts(struct wetting_front** head, struct wetting_front_pool *pool, int *soil_type, struct soil_properties_ *soil_properties){
+  if (LGAR_LOG_HIGH) {
     printf("before lgar_clean_redundant_fronts: \n");
     listPrint(*head);
   }
@@ -3712,7 +4036,7 @@ extern void lgar_clean_redundant_fronts(struct wetting_front** head, int *soil_t
   for (int wf = 1; wf != (listLength(*head)); wf++) {
     if ( ((current->layer_num==next->layer_num) && (fabs(current->theta - next->theta)<THRESHOLD_NO_MOISTURE_DIFF)) ){ // here, we only delete wetting fronts if they are very close in moisture. 
                                                                                                                        // Theta can become extremely sensitive with respect to psi for small psi. This approach avoids errors due to that sensitivity. 
-      current = listDeleteFront(current->front_num, head, soil_type, soil_properties); 
+      current = listDeleteFront(current->front_num, head, pool, soil_type, soil_properties); 
       break;
     }
 
@@ -3720,7 +4044,7 @@ extern void lgar_clean_redundant_fronts(struct wetting_front** head, int *soil_t
     next = current->next;
   }
 
-  if (verbosity.compare("high") == 0) {
+  if (LGAR_LOG_HIGH) {
     printf("after lgar_clean_redundant_fronts: \n");
     listPrint(*head);
   }
@@ -3738,20 +4062,10 @@ extern double calc_min_water_possible_for_free_drainage_wetting_front(int wf_fre
   current = *head;
   int layer_num;
   int soil_num;
-  double theta_r;
-  double theta_e;
-  double vg_n;
-  double vg_m;
-  double vg_a;
   while (current!=NULL){
     layer_num  = current->layer_num;
     soil_num   = soil_type[layer_num];
-    theta_r    = soil_properties[soil_num].theta_r;
-    theta_e    = soil_properties[soil_num].theta_e;
-    vg_a       = soil_properties[soil_num].vg_alpha_per_cm;
-    vg_m       = soil_properties[soil_num].vg_m;
-    vg_n       = soil_properties[soil_num].vg_n;
-    double min_theta = calc_theta_from_h(PSI_UPPER_LIM, vg_a, vg_m, vg_n, theta_e, theta_r);
+    double min_theta = soil_theta_from_h(&soil_properties[soil_num], PSI_UPPER_LIM);
     min_storage += min_theta*(current->depth_cm - previous_depth);
     if (current->front_num==wf_free_drainage){
       break;
@@ -3881,9 +4195,7 @@ extern void lgar_theta_mass_balance_correction(bool use_dry_over_wet, int front_
     int soil_num   = soil_type[layer_num];
 
     current->psi_cm = psi_cm_loc;
-    current->theta = calc_theta_from_h(psi_cm_loc, soil_properties[soil_num].vg_alpha_per_cm, soil_properties[soil_num].vg_m,
-            soil_properties[soil_num].vg_n,soil_properties[soil_num].theta_e,
-            soil_properties[soil_num].theta_r);
+    current->theta = soil_theta_from_h(&soil_properties[soil_num], psi_cm_loc);
 
     struct wetting_front *next = current->next;
     struct wetting_front *before_next = current;
@@ -3895,22 +4207,12 @@ extern void lgar_theta_mass_balance_correction(bool use_dry_over_wet, int front_
     if (next && !skip_bottom_chain_below){ // current was previously selected as the top most WF in the region that we want to iteratively adjust. The lowest will be either the lowest WF, or the first WF below current that is not to_bottom.
       // use_dry_over_wet included because this function is generally used to correct "chains" of WFs that should have the same psi value across layers, including to_bottom WFs below the one that is being corrected. 
       // In the case of fixing dry over wet WFs this is only desired if the WF being corrected is itself to_bottom. If it is not, it should not attempt to also include the next to_bottom WF in its mass update.
-      double theta_e;
-      double theta_r;
-      double vg_a;
-      double vg_m;
-      double vg_n;
       while (next->to_bottom){
         next->psi_cm = before_next->psi_cm;
         layer_num  = next->layer_num;
         soil_num   = soil_type[layer_num];
-        theta_e    = soil_properties[soil_num].theta_e;
-        theta_r    = soil_properties[soil_num].theta_r;
-        vg_a       = soil_properties[soil_num].vg_alpha_per_cm;
-        vg_m       = soil_properties[soil_num].vg_m;
-        vg_n       = soil_properties[soil_num].vg_n;
 
-        next->theta = calc_theta_from_h(next->psi_cm, vg_a,vg_m, vg_n, theta_e, theta_r);
+        next->theta = soil_theta_from_h(&soil_properties[soil_num], next->psi_cm);
 
         before_next = next;
         next = next->next;
@@ -3923,13 +4225,8 @@ extern void lgar_theta_mass_balance_correction(bool use_dry_over_wet, int front_
           next->psi_cm = before_next->psi_cm;
           layer_num  = next->layer_num;
           soil_num   = soil_type[layer_num];
-          theta_e = soil_properties[soil_num].theta_e;
-          theta_r = soil_properties[soil_num].theta_r;
-          vg_a    = soil_properties[soil_num].vg_alpha_per_cm;
-          vg_m    = soil_properties[soil_num].vg_m;
-          vg_n    = soil_properties[soil_num].vg_n;
 
-          next->theta = calc_theta_from_h(next->psi_cm, vg_a,vg_m, vg_n, theta_e, theta_r);
+          next->theta = soil_theta_from_h(&soil_properties[soil_num], next->psi_cm);
 
         }
       }
@@ -26,17 +26,82 @@
 //___________________________________________________________
 
 
+/*###########################################################*/
+/* poolAlloc() - takes a wetting front node from the pool.   */
+/* Freed nodes are reused first (LIFO), otherwise the next   */
+/* unused node of the preallocated block is carved off. With */
+/* pool == NULL the node is malloc'ed instead                */
+/*###########################################################*/
+extern struct wetting_front* poolAlloc(struct wetting_front_pool *pool)
+{
+  if (pool == NULL)
+    return (struct wetting_front*) malloc(sizeof(struct wetting_front));
+
+  struct wetting_front *node = pool->free_list;
+
+  if (node != NULL) {
+    pool->free_list = node->next;
+  }
+  else if (pool->num_carved < MAX_NUM_WETTING_FRONTS) {
+    node = &pool->nodes[pool->num_carved++];
+  }
+  else {
+    fprintf(stderr, "ERROR: number of wetting fronts exceeds MAX_NUM_WETTING_FRONTS (%d). Program stopped.\n", MAX_NUM_WETTING_FRONTS);
+    abort();
+  }
+
+  pool->num_in_use++;
+  if (pool->num_in_use > pool->high_water_mark)
+    pool->high_water_mark = pool->num_in_use;
+
+  return node;
+}
+
+/*###########################################################*/
+/* poolFree() - returns a node taken with poolAlloc() to the */
+/* pool; with pool == NULL the node is free'd instead        */
+/*###########################################################*/
+extern void poolFree(struct wetting_front_pool *pool, struct wetting_front *node)
+{
+  if (pool == NULL) {
+    free(node);
+    return;
+  }
+
+  if (node < &pool->nodes[0] || node >= &pool->nodes[pool->num_carved]) {
+    fprintf(stderr, "ERROR: wetting front node does not belong to the pool. Program stopped.\n");
+    abort();
+  }
+
+  node->next = pool->free_list;
+  pool->free_list = node;
+  pool->num_in_use--;
+}
+
+/*###########################################################*/
+/* poolReset() - returns all nodes to the pool at once. Any  */
+/* list built from the pool is invalid afterwards; the       */
+/* high water mark is kept                                   */
+/*###########################################################*/
+extern void poolReset(struct wetting_front_pool *pool)
+{
+  pool->free_list  = NULL;
+  pool->num_carved = 0;
+  pool->num_in_use = 0;
+}
+
+
 /*###########################################################*/
 /* listDelete() - deletes memory allocated to a linked list  */
 /* This function must be called on any list to deallocate    */
 /* the dynamic memory used in creating and manipultating the */
 /* list. (added by NJF)                                                     */
 /*###########################################################*/
-extern void listDelete(struct wetting_front* head)
+extern void listDelete(struct wetting_front* head, struct wetting_front_pool *pool)
 {
   while (head != NULL) {
     struct wetting_front *next = head->next;
-    free( head );
+    poolFree(pool, head);
     head = next;
   }
 }
@@ -62,43 +127,15 @@ extern void listPrint(struct wetting_front* head)
 
 }
 
-/*###########################################################*/
-/* listCopy() - copies a linked list to another linked list  */
-/*###########################################################*/
-extern struct wetting_front* listCopy(struct wetting_front* current, struct wetting_front* state_previous)
-{
-  if (current == NULL) {
-    return NULL;
-  }
-  else {
-
-    struct wetting_front* wf = (struct wetting_front*)malloc(sizeof(struct wetting_front));
-
-    wf->depth_cm = current->depth_cm;
-    wf->theta = current->theta;
-    wf->psi_cm = current->psi_cm;
-    wf->K_cm_per_h = current->K_cm_per_h;
-    wf->layer_num = current->layer_num;
-    wf->front_num = current->front_num;
-    wf->to_bottom = current->to_bottom;
-    wf->dzdt_cm_per_h = current->dzdt_cm_per_h;
-    wf->next = listCopy(current->next, NULL);
-
-    if (state_previous == NULL)
-      state_previous = wf;
-    return wf;
-  }
-}
-
-
 /*#######################################################*/
 /* listInsertFirst - adds a list entry to start of list  */
 /*#######################################################*/
-extern void listInsertFirst(double depth, double theta, int front_num, int layer_num, bool bottom_flag, struct wetting_front** head)
+extern void listInsertFirst(double depth, double theta, int front_num, int layer_num, bool bottom_flag, struct wetting_front** head,
+			    struct wetting_front_pool *pool)
 {
 
   //create a link
-  struct wetting_front *link = (struct wetting_front*) malloc(sizeof(struct wetting_front));
+  struct wetting_front *link = poolAlloc(pool);
 
   link->depth_cm = depth;
   link->theta = theta;
@@ -202,10 +239,33 @@ extern struct wetting_front* listFindFront(int key, struct wetting_front* head,
 }
 
 
+/*################################################################################*/
+/* listIndex -fills index[1..n] with pointers to the fronts of the list so that a   */
+/* front can be accessed by its front number without walking the list; returns n    */
+/* index must hold at least MAX_NUM_WETTING_FRONTS+1 entries                        */
+/*################################################################################*/
+extern int listIndex(struct wetting_front* head, struct wetting_front** index)
+{
+  int wf = 0;
+
+  for (struct wetting_front *current = head; current != NULL; current = current->next) {
+    wf++;
+    if (wf > MAX_NUM_WETTING_FRONTS) {
+      fprintf(stderr, "ERROR: number of wetting fronts exceeds MAX_NUM_WETTING_FRONTS (%d). Program stopped.\n", MAX_NUM_WETTING_FRONTS);
+      abort();
+    }
+    index[wf] = current;
+  }
+
+  return wf;
+}
+
+
 /*##############################################################*/
 /* listDeleteFront -delete the front with a particular front number */
 /*##############################################################*/
-extern struct wetting_front* listDeleteFront(int front_num, struct wetting_front** head, int *soil_type, struct soil_properties_ *soil_properties)
+extern struct wetting_front* listDeleteFront(int front_num, struct wetting_front** head, struct wetting_front_pool *pool,
+					     int *soil_type, struct soil_properties_ *soil_properties)
 {
   //start from the first link
   struct wetting_front* current = *head;
@@ -254,7 +314,7 @@ extern struct wetting_front* listDeleteFront(int front_num, struct wetting_front
     previous = current->next;
 
   }
-  if( current != NULL ) free( current );
+  if( current != NULL ) poolFree(pool, current);
   current = previous;
 
   while(previous != NULL) { // decrement all front numbers
@@ -266,8 +326,10 @@ extern struct wetting_front* listDeleteFront(int front_num, struct wetting_front
 
   // ensure that psi is preserved across layer boundaries and theta is updated accordingly
   if (front_num!=1){
-    for (int wf = listLength(*head)-1; wf != 0; wf--) {
-      struct wetting_front *current_temp = listFindFront(wf, *head, NULL);
+    struct wetting_front *fronts[MAX_NUM_WETTING_FRONTS+1];
+    int num_fronts = listIndex(*head, fronts);
+    for (int wf = num_fronts-1; wf != 0; wf--) {
+      struct wetting_front *current_temp = fronts[wf];
       struct wetting_front *next_temp = current_temp->next;
       if ( (current_temp->to_bottom) ){
         // current_temp->is_WF_GW = next_temp->is_WF_GW; // LGARTO thing
@@ -276,13 +338,10 @@ extern struct wetting_front* listDeleteFront(int front_num, struct wetting_front
         int soil_num_k1 = soil_type[current_temp->layer_num]; 
         double theta_e_k   = soil_properties[soil_num_k1].theta_e;
         double theta_r_k   = soil_properties[soil_num_k1].theta_r;
-        double vg_a_k      = soil_properties[soil_num_k1].vg_alpha_per_cm;
-        double vg_m_k      = soil_properties[soil_num_k1].vg_m;
-        double vg_n_k      = soil_properties[soil_num_k1].vg_n;
-        current_temp->theta = calc_theta_from_h(current_temp->psi_cm, vg_a_k, vg_m_k, vg_n_k,theta_e_k,theta_r_k);
+        current_temp->theta = soil_theta_from_h(&soil_properties[soil_num_k1], current_temp->psi_cm);
         double Ksat_cm_per_h_k  = soil_properties[soil_num_k1].Ksat_cm_per_h;
         double Se = calc_Se_from_theta(current_temp->theta,theta_e_k, theta_r_k);
-        current_temp->K_cm_per_h = calc_K_from_Se(Se, Ksat_cm_per_h_k, vg_m_k);
+        current_temp->K_cm_per_h = soil_K_from_Se(&soil_properties[soil_num_k1], Se, Ksat_cm_per_h_k);
       }
     }
   }
@@ -299,7 +358,8 @@ extern struct wetting_front* listDeleteFront(int front_num, struct wetting_front
 /* new front number by 1.                                             */
 /*####################################################################*/
 extern struct wetting_front* listInsertFront(double depth, double theta, int new_front_num,
-                                             int layer_num, bool bottom_flag, struct wetting_front** head)
+                                             int layer_num, bool bottom_flag, struct wetting_front** head,
+                                             struct wetting_front_pool *pool)
 {
   //start from the first link
   struct wetting_front* current = NULL;
@@ -309,7 +369,7 @@ extern struct wetting_front* listInsertFront(double depth, double theta, int new
     
     if(new_front_num==1) { // create it
       //create a link
-      struct wetting_front *link = (struct wetting_front*) malloc(sizeof(struct wetting_front));
+      struct wetting_front *link = poolAlloc(pool);
 
       link->depth_cm = depth;
       link->theta = theta;
@@ -331,7 +391,7 @@ extern struct wetting_front* listInsertFront(double depth, double theta, int new
   do {
     if (previous->front_num == new_front_num-1) { // this is where we want to insert it
       //create a new link
-      struct wetting_front *link = (struct wetting_front*) malloc(sizeof(struct wetting_front));
+      struct wetting_front *link = poolAlloc(pool);
 
       link->depth_cm = depth;
       link->theta = theta;
@@ -357,131 +417,6 @@ extern struct wetting_front* listInsertFront(double depth, double theta, int new
 
 }
 
-/*############################################################################*/
-/* listInsertFrontAtDepth -creates a new front at specified depth in the soil */
-/* and increase all front numbers greater than or equal to the                */
-/* new front number by 1. Determines layer number, front number and           */
-/* determine if the new front is at the bottom of the layer                   */
-/*############################################################################*/
-extern struct wetting_front* listInsertFrontAtDepth(int num_layers, double *cum_layer_thickness,
-                                                    double depth, double theta, struct wetting_front* head)
-{
-  int el_layer=0;
-  bool extends_to_bottom_flag = FALSE;
-  bool layer_found_flag = FALSE;
-
-  struct wetting_front *link = NULL;
-
-  //start from the first link
-  struct wetting_front* current = head;
-  struct wetting_front* previous = NULL;
-
-  if(head == NULL) { // list is empty
-    // Kinda weird.  Shouldn't call this function to start a list.  Create link in the first position
-
-    link = (struct wetting_front*) malloc(sizeof(struct wetting_front));
-
-    link->depth_cm = depth;
-    link->theta = theta;
-    link->to_bottom = FALSE;
-
-    layer_found_flag = listFindLayer(link,num_layers,cum_layer_thickness, &el_layer, &extends_to_bottom_flag);
-
-    if(layer_found_flag ==FALSE) {
-      return NULL; // this should never happen, unless it asks to create a front not in the soil
-    }
-
-    link->layer_num = el_layer;
-    link->to_bottom = extends_to_bottom_flag;
-    link->dzdt_cm_per_h = (double)(-1.0);
-    link->next = NULL;   // because this is the first link.
-    head = link;  // don't forget this.  Must keep head current with the beginning of the list.
-    return link;
-  }
-  else {
-    // list is not empty, so search through list fo find where this front fits in.  Might be first though...
-    if(depth < current->depth_cm) {
-      // yep.  It's first
-      //create a link and put it at the beginning of the list
-
-      link = (struct wetting_front*) malloc(sizeof(struct wetting_front));
-
-      link->depth_cm = depth;
-      link->theta = theta;
-      link->to_bottom = FALSE;
-
-      layer_found_flag = listFindLayer(link,num_layers,cum_layer_thickness, &el_layer, &extends_to_bottom_flag);
-
-      if(layer_found_flag ==FALSE) {
-	return NULL; // this should never happen, unless it asks to create a front not in the soil
-      }
-
-      link->layer_num = el_layer;
-      link->to_bottom = extends_to_bottom_flag;
-      link->dzdt_cm_per_h = (double)(-1.0);
-      link->next = head;   // point to the old first list entry
-      head=link;  // don't forget this.  Must keep head point to the beginning of the list
-      return link;
-    }
-    else {
-      // the new one is not the first wetting front in the list sorted by depth, search to see where it fits.
-
-      previous=current;
-      current=current->next;
-      do {
-	if((depth > previous->depth_cm ) && (depth <= current->depth_cm) ) {
-	  // it is in this interval
-
-	  // create a link
-	  link = (struct wetting_front*) malloc(sizeof(struct wetting_front));
-
-	  link->depth_cm = depth;
-	  link->theta = theta;
-	  link->to_bottom = FALSE;
-
-	  layer_found_flag = listFindLayer(link,num_layers,cum_layer_thickness,
-					   &el_layer, &extends_to_bottom_flag);
-
-	  if(layer_found_flag ==FALSE) {
-	    return NULL; // this should never happen, unless it asks to create a front not in the soil
-	  }
-
-	  link->layer_num = el_layer;
-	  link->to_bottom = extends_to_bottom_flag;
-	  link->dzdt_cm_per_h = (double)(-1.0);
-	  link->front_num = current->front_num;
-	  link->next = current;   // point to one replaced
-	  previous->next = link;  // make the previous one point to this new one
-	  current = previous->next;
-	  break;
-	}
-
-	previous=current;
-	current=previous->next;
-      } while ( current != NULL );
-
-      if (layer_found_flag == TRUE && current->next != NULL) {
-	//re-number the links that follow the current link
-	current=current->next;
-
-	while (current != NULL) { // increment all front numbers
-	  //printf("front number: %3d, current->next=%p\n",current->front_num,current->next);
-	  current->front_num++;
-	  previous = current;
-	  current = current->next;
-        }
-
-	return link;
-      }
-      else {
-	return NULL;
-      }
-    }
-  }
-
-}
-
-
 /*##############################################################*/
 /* listFindLayer -find what layer a newly created link lives in */
 /*###############################################################*/
@@ -0,0 +1,576 @@
+#include "../include/output_writer.hxx"
+#include <cstdint>
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+
+//#####################################################################################
+/* - The file contains the output writer of the standalone driver. The model thread
+     only copies the outputs of a timestep into a preallocated row of a ring and
+     publishes it (WriteStep); formatting and writing happen on the writer thread.
+   - The ring is a single-producer single-consumer queue without locks: the model
+     thread advances write_index, the writer thread advances read_index. The writer
+     thread sleeps while the ring is empty and is woken when half of the ring is
+     queued (and at Close), so that it runs in batches instead of once per timestep.
+   - Text output is the same as the fprintf output of the driver before (variables
+     with %6.15f, fronts with %lf); format_fixed produces the printf digits from the
+     exact binary value of the double with integer arithmetic.
+   - Binary output (OUTPUT_BINARY):
+       variables file: "LASAMOUT", uint32 version, uint32 number of variables, the
+                       names (uint32 length and characters each), then per row
+                       float64 time [s] and the float64 values.
+       layers file   : "LASAMLYR", uint32 version, uint32 values per front (5), then
+                       per row int32 timestep, int32 number of fronts and per front
+                       float64 depth [mm], theta, layer, front number, psi [mm].
+     Binary output files are not portable across byte orders.
+   - OutputAggregator aggregates the output variables over the output interval (mean,
+     sum, max, min or last value of each variable).
+   - ReadOutputConfig reads the output_* keys of the config file, which select the
+     variables, the output interval and aggregation and the layers output of the
+     standalone driver; the model itself ignores these keys.                         */
+//#####################################################################################
+
+static const uint32_t output_version   = 1;
+static const size_t   output_block_len = 1 << 20;  // the buffers are written in blocks of about this size
+
+
+// writes the digits of value (at least one) and returns the end of the text
+static char* format_integer(char *out, unsigned long long value)
+{
+  char digits[24];
+  int num_digits = 0;
+  do {
+    digits[num_digits++] = '0' + (char)(value % 10);
+    value /= 10;
+  } while (value > 0);
+
+  while (num_digits > 0)
+    *out++ = digits[--num_digits];
+  return out;
+}
+
+
+// writes an int as printf("%d")
+static char* format_int(char *out, int value)
+{
+  if (value < 0)
+    *out++ = '-';
+  return format_integer(out, value < 0 ? -(unsigned long long)value : (unsigned long long)value);
+}
+
+
+/*
+  The double is mantissa * 2^exponent, so value * 10^precision is an integer times a power of two, which is computed
+  exactly in 128 bits and rounded to an integer (half to even, as printf) for the digits. Values outside the range of
+  the integer arithmetic (|value| >= 2^77, inf, nan) and compilers without 128-bit integers use snprintf. out must have
+  room for the snprintf text of value.
+*/
+extern char*
+format_fixed(char *out, double value, int precision)
+{
+#ifdef __SIZEOF_INT128__
+  static const unsigned long long powers_of_ten[16] = {1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+						       10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+						       100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+						       100000000000000ULL, 1000000000000000ULL};
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  int biased_exponent = (int)((bits >> 52) & 0x7ff);
+  uint64_t mantissa = bits & ((1ULL << 52) - 1);
+  int exponent = biased_exponent == 0 ? -1074 : biased_exponent - 1075;
+  if (biased_exponent != 0)
+    mantissa |= 1ULL << 52;
+
+  if (precision >= 0 && precision <= 15 && biased_exponent != 0x7ff && exponent <= 24) {
+    // value * 10^precision < 2^53 * 2^50 * 2^24 fits in 128 bits
+    unsigned __int128 scaled = (unsigned __int128)mantissa * powers_of_ten[precision];
+    if (exponent >= 0)
+      scaled <<= exponent;
+    else if (exponent > -128) {
+      int shift = -exponent;
+      unsigned __int128 quotient = scaled >> shift;
+      unsigned __int128 remainder = scaled - (quotient << shift);
+      unsigned __int128 half = (unsigned __int128)1 << (shift - 1);
+      if (remainder > half || (remainder == half && (quotient & 1)))
+	quotient++;
+      scaled = quotient;
+    }
+    else
+      scaled = 0; // below 2^103 * 2^-128, rounds to zero
+
+    if (bits >> 63)
+      *out++ = '-';
+
+    unsigned __int128 integer_part = scaled / powers_of_ten[precision];
+    unsigned long long fraction = (unsigned long long)(scaled % powers_of_ten[precision]);
+
+    if (integer_part >> 64) {
+      // at least 2^64, write the lower 19 digits separately
+      const unsigned long long ten_to_19 = 10000000000000000000ULL;
+      out = format_integer(out, (unsigned long long)(integer_part / ten_to_19));
+      char digits[24];
+      char *end = format_integer(digits, (unsigned long long)(integer_part % ten_to_19));
+      for (long pad = 19 - (end - digits); pad > 0; pad--)
+	*out++ = '0';
+      memcpy(out, digits, end - digits);
+      out += end - digits;
+    }
+    else
+      out = format_integer(out, (unsigned long long)integer_part);
+
+    if (precision > 0) {
+      *out++ = '.';
+      for (int i=precision-1; i>=0; i--) {
+	out[i] = '0' + (char)(fraction % 10);
+	fraction /= 10;
+      }
+      out += precision;
+    }
+    return out;
+  }
+#endif
+
+  return out + sprintf(out, "%.*f", precision, value);
+}
+
+
+OutputWriter::
+OutputWriter(std::string variables_file, std::string layers_file, const std::vector<std::string> &variable_names,
+	     enum output_format format, int queue_rows)
+  : variable_names(variable_names), format(format), variables_file(variables_file), layers_file(layers_file)
+{
+  if (!variables_file.empty())
+    variables_fp = fopen(variables_file.c_str(), "wb");
+  if (!layers_file.empty())
+    layers_fp = fopen(layers_file.c_str(), "wb");
+  if ((variables_fp == NULL && !variables_file.empty()) || (layers_fp == NULL && !layers_file.empty())) {
+    if (variables_fp)
+      fclose(variables_fp);
+    if (layers_fp)
+      fclose(layers_fp);
+    std::stringstream errMsg;
+    errMsg << "cannot open output files " << variables_file << " and " << layers_file;
+    throw std::runtime_error(errMsg.str());
+  }
+
+  variables_buffer.reserve(output_block_len + 4096);
+  layers_buffer.reserve(output_block_len + 4096);
+
+  // headings
+  if (format == OUTPUT_TEXT) {
+    variables_buffer += "Time,";
+    for (size_t j=0; j<variable_names.size(); j++)
+      variables_buffer += variable_names[j] + (j + 1 == variable_names.size() ? "\n" : ",");
+  }
+  else {
+    uint32_t num_variables = (uint32_t)variable_names.size();
+    uint32_t values_per_front = 5;
+    variables_buffer.append("LASAMOUT", 8);
+    variables_buffer.append((const char*)&output_version, sizeof(output_version));
+    variables_buffer.append((const char*)&num_variables, sizeof(num_variables));
+    for (size_t j=0; j<variable_names.size(); j++) {
+      uint32_t length = (uint32_t)variable_names[j].size();
+      variables_buffer.append((const char*)&length, sizeof(length));
+      variables_buffer += variable_names[j];
+    }
+    layers_buffer.append("LASAMLYR", 8);
+    layers_buffer.append((const char*)&output_version, sizeof(output_version));
+    layers_buffer.append((const char*)&values_per_front, sizeof(values_per_front));
+  }
+
+  queue_rows = std::max(queue_rows, 2);
+  rows.resize(queue_rows);
+  for (auto &row : rows) {
+    row.values.resize(variable_names.size());
+    row.fronts.reserve(5 * 16);
+  }
+  wake_rows = queue_rows / 2;
+
+  writer = std::thread(&OutputWriter::writer_loop, this);
+}
+
+
+OutputWriter::
+~OutputWriter()
+{
+  try {
+    Close();
+  }
+  catch (const std::runtime_error &e) {
+    std::cerr<<e.what()<<"\n";
+  }
+}
+
+
+void OutputWriter::
+WriteStep(int step, double time_s, const double *values, double values_time_s, const struct wetting_front *head)
+{
+  size_t write = write_index.load(std::memory_order_relaxed);
+
+  // the ring is full: wait for the writer thread to free a row
+  while (write - read_index.load(std::memory_order_acquire) >= rows.size()) {
+    if (writer_sleeping.load()) {
+      std::lock_guard<std::mutex> guard(sleep_lock);
+      rows_queued.notify_one();
+    }
+    std::this_thread::yield();
+  }
+
+  struct output_row &row = rows[write % rows.size()];
+  row.step = step;
+  row.time_s = time_s;
+  row.values_time_s = values_time_s;
+  row.has_values = (values != NULL && variables_fp != NULL);
+  row.has_fronts = (head != NULL && layers_fp != NULL);
+  if (row.has_values)
+    std::copy(values, values + variable_names.size(), row.values.begin());
+  row.fronts.clear();
+  for (const struct wetting_front *current = row.has_fronts ? head : NULL; current != NULL; current = current->next) {
+    row.fronts.push_back(current->depth_cm * 10.);
+    row.fronts.push_back(current->theta);
+    row.fronts.push_back(current->layer_num);
+    row.fronts.push_back(current->front_num);
+    row.fronts.push_back(current->psi_cm * 10.);
+  }
+
+  write_index.store(write + 1);
+
+  if (write + 1 - read_index.load() >= wake_rows && writer_sleeping.load()) {
+    std::lock_guard<std::mutex> guard(sleep_lock);
+    rows_queued.notify_one();
+  }
+}
+
+
+void OutputWriter::
+Close()
+{
+  if (!writer.joinable())
+    return;
+
+  {
+    std::lock_guard<std::mutex> guard(sleep_lock);
+    closing.store(true);
+    rows_queued.notify_one();
+  }
+  writer.join();
+
+  if (variables_fp)
+    write_failed |= (fclose(variables_fp) != 0);
+  if (layers_fp)
+    write_failed |= (fclose(layers_fp) != 0);
+  variables_fp = layers_fp = NULL;
+
+  if (write_failed) {
+    std::stringstream errMsg;
+    errMsg << "cannot write output files " << variables_file << " and " << layers_file;
+    throw std::runtime_error(errMsg.str());
+  }
+}
+
+
+// loop of the writer thread: format the queued rows, write the buffers in blocks, sleep while the ring is empty
+void OutputWriter::
+writer_loop()
+{
+  while (true) {
+    size_t read = read_index.load(std::memory_order_relaxed);
+    size_t write = write_index.load(std::memory_order_acquire);
+
+    if (write == read) {
+      if (closing.load()) {
+	if (write_index.load() == read)
+	  break;
+	continue;
+      }
+      std::unique_lock<std::mutex> guard(sleep_lock);
+      writer_sleeping.store(true);
+      rows_queued.wait(guard, [&] { return write_index.load() - read_index.load() >= wake_rows || closing.load(); });
+      writer_sleeping.store(false);
+      continue;
+    }
+
+    for (; read != write; read++) {
+      if (format == OUTPUT_TEXT)
+	format_text(rows[read % rows.size()]);
+      else
+	format_binary(rows[read % rows.size()]);
+      read_index.store(read + 1, std::memory_order_release);
+      flush_buffers(false);
+    }
+  }
+
+  flush_buffers(true);
+}
+
+
+void OutputWriter::
+format_text(const struct output_row &row)
+{
+  // longest text of a value: sign, 20 digits for |value| < 2^77 (larger values are rare, see below), '.', 15 digits
+  char line[96];
+
+  if (row.has_values) {
+    variables_buffer += forcing_time_string(row.values_time_s);
+    variables_buffer += ',';
+  }
+  for (size_t j=0; j<row.values.size() && row.has_values; j++) {
+    if (fabs(row.values[j]) < 1e20) {
+      char *end = format_fixed(line, row.values[j], 15);
+      *end++ = (j + 1 == row.values.size()) ? '\n' : ',';
+      variables_buffer.append(line, end - line);
+    }
+    else {
+      std::vector<char> text(snprintf(NULL, 0, "%6.15f", row.values[j]) + 1);
+      snprintf(text.data(), text.size(), "%6.15f", row.values[j]);
+      variables_buffer += text.data();
+      variables_buffer += (j + 1 == row.values.size()) ? '\n' : ',';
+    }
+  }
+
+  if (!row.has_fronts)
+    return;
+
+  char *end = line + sprintf(line, "# Timestep = %d, ", row.step);
+  layers_buffer.append(line, end - line);
+  layers_buffer += forcing_time_string(row.time_s) + " \n[";
+
+  // the fronts are depths, water contents and capillary heads, printed as %lf; other magnitudes take the snprintf path
+  for (size_t k=0; k<row.fronts.size(); k+=5) {
+    const double *front = &row.fronts[k];
+    if (fabs(front[0]) < 1e20 && fabs(front[1]) < 1e20 && fabs(front[4]) < 1e20) {
+      end = line;
+      if (k > 0)
+	*end++ = '|';
+      *end++ = '(';
+      end = format_fixed(end, front[0], 6);
+      *end++ = ',';
+      end = format_fixed(end, front[1], 6);
+      *end++ = ',';
+      end = format_int(end, (int)front[2]);
+      *end++ = ',';
+      end = format_int(end, (int)front[3]);
+      *end++ = ',';
+      end = format_fixed(end, front[4], 6);
+      *end++ = ')';
+      layers_buffer.append(line, end - line);
+    }
+    else {
+      std::vector<char> text(snprintf(NULL, 0, "%s(%lf,%lf,%d,%d,%lf)", k > 0 ? "|" : "", front[0], front[1],
+				       (int)front[2], (int)front[3], front[4]) + 1);
+      snprintf(text.data(), text.size(), "%s(%lf,%lf,%d,%d,%lf)", k > 0 ? "|" : "", front[0], front[1],
+	       (int)front[2], (int)front[3], front[4]);
+      layers_buffer += text.data();
+    }
+  }
+  layers_buffer += "]\n";
+}
+
+
+void OutputWriter::
+format_binary(const struct output_row &row)
+{
+  if (row.has_values) {
+    variables_buffer.append((const char*)&row.values_time_s, sizeof(double));
+    variables_buffer.append((const char*)row.values.data(), row.values.size() * sizeof(double));
+  }
+
+  if (!row.has_fronts)
+    return;
+
+  int32_t header[2] = {row.step, (int32_t)(row.fronts.size() / 5)};
+  layers_buffer.append((const char*)header, sizeof(header));
+  layers_buffer.append((const char*)row.fronts.data(), row.fronts.size() * sizeof(double));
+}
+
+
+void OutputWriter::
+flush_buffers(bool force)
+{
+  if (variables_fp && (force || variables_buffer.size() >= output_block_len)) {
+    write_failed |= (fwrite(variables_buffer.data(), 1, variables_buffer.size(), variables_fp) != variables_buffer.size());
+    variables_buffer.clear();
+  }
+  if (layers_fp && (force || layers_buffer.size() >= output_block_len)) {
+    write_failed |= (fwrite(layers_buffer.data(), 1, layers_buffer.size(), layers_fp) != layers_buffer.size());
+    layers_buffer.clear();
+  }
+}
+
+
+OutputAggregator::
+OutputAggregator(const std::vector<enum output_aggregation> &aggregation)
+  : aggregation(aggregation), aggregates(aggregation.size()), row(aggregation.size())
+{
+}
+
+
+void OutputAggregator::
+Add(const double *values, double time_s)
+{
+  if (count == 0)
+    interval_time_s = time_s;
+  count++;
+
+  for (size_t j = 0; j < aggregation.size(); j++) {
+    double &aggregate = aggregates[j];
+
+    if (count == 1 || aggregation[j] == AGGREGATE_LAST)
+      aggregate = values[j];
+    else if (aggregation[j] == AGGREGATE_MAX)
+      aggregate = std::max(aggregate, values[j]);
+    else if (aggregation[j] == AGGREGATE_MIN)
+      aggregate = std::min(aggregate, values[j]);
+    else
+      aggregate += values[j];
+  }
+}
+
+
+const double* OutputAggregator::
+CompleteRow(double *interval_time_s)
+{
+  if (count == 0)
+    return NULL;
+
+  for (size_t j = 0; j < aggregation.size(); j++)
+    row[j] = aggregation[j] == AGGREGATE_MEAN ? aggregates[j] / count : aggregates[j];
+
+  *interval_time_s = this->interval_time_s;
+  count = 0;
+  return row.data();
+}
+
+
+// converts an output interval (value with a time unit, or [timesteps]) to a number of timesteps of timestep_s seconds
+static int output_interval_steps(std::string param_key, std::string param_value, std::string param_unit,
+				 double timestep_s)
+{
+  double interval = stod(param_value);
+  double steps;
+
+  if (param_unit == "[timesteps]" || param_unit == "[steps]")
+    steps = interval;
+  else if (param_unit == "[s]" || param_unit == "[sec]" || param_unit == "") // default time unit is seconds
+    steps = interval / timestep_s;
+  else if (param_unit == "[min]" || param_unit == "[minute]")
+    steps = interval * 60.0 / timestep_s;
+  else if (param_unit == "[h]" || param_unit == "[hr]")
+    steps = interval * 3600.0 / timestep_s;
+  else if (param_unit == "[d]" || param_unit == "[day]")
+    steps = interval * 86400.0 / timestep_s;
+  else
+    steps = -1.0;
+
+  if (steps < 0.5 || fabs(steps - round(steps)) > 1e-9 * steps) {
+    std::cerr<<"Invalid option: "<<param_key<<" must be a positive multiple of the timestep ("<<timestep_s
+	     <<" s) with the unit [s], [min], [h], [d] or [timesteps]. \n";
+    abort();
+  }
+
+  return (int)round(steps);
+}
+
+
+static enum output_aggregation parse_aggregation(std::string param_key, std::string name)
+{
+  if (name == "mean")
+    return AGGREGATE_MEAN;
+  else if (name == "sum")
+    return AGGREGATE_SUM;
+  else if (name == "max")
+    return AGGREGATE_MAX;
+  else if (name == "min")
+    return AGGREGATE_MIN;
+  else if (name == "last")
+    return AGGREGATE_LAST;
+
+  std::cerr<<"Invalid option: "<<param_key<<" aggregation must be mean, sum, max, min, or last. \n";
+  abort();
+}
+
+
+/*
+  Reads the output options of the standalone driver:
+    output_variables       = comma-separated variables, each optionally with its aggregation (e.g.
+                             total_discharge:sum,soil_storage:last), or none for no variables file
+    output_interval        = timesteps per row of the variables file (e.g. 1[d], 6[h], 24[timesteps])
+    output_aggregation     = aggregation of the variables without their own (mean, sum, max, min, last)
+    output_layers          = true or false, write the wetting fronts to the layers file
+    output_layers_interval = timesteps between the rows of the layers file (defaults to output_interval)
+  The defaults are the outputs of every timestep, as without these keys.
+*/
+extern void
+ReadOutputConfig(std::string config_file, double timestep_s, struct output_config *config)
+{
+  std::ifstream fp;
+  fp.open(config_file);
+  if (!fp) {
+    std::stringstream errMsg;
+    errMsg << config_file << " does not exist";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  config->variable_names = {"precipitation", "potential_evapotranspiration", "actual_evapotranspiration",
+			    "surface_runoff", "giuh_runoff", "soil_storage", "total_discharge", "infiltration",
+			    "percolation", "conceptual_reservoir_to_stream_discharge", "mass_balance"};
+  config->interval_steps = 1;
+  config->write_layers = true;
+  config->layers_interval_steps = 0;  // set to interval_steps below unless given
+
+  std::vector<std::string> aggregation_names(config->variable_names.size());
+  enum output_aggregation default_aggregation = AGGREGATE_MEAN;
+
+  while (fp) {
+    std::string line, param_key, param_value, param_unit;
+    getline(fp, line);
+
+    int loc_eq = line.find("=") + 1;
+    int loc_u = line.find("[");
+    param_key = line.substr(0,line.find("="));
+
+    if (line.find("[") != std::string::npos)
+      param_unit = line.substr(loc_u,line.find("]")+1);
+    param_value = line.substr(loc_eq,loc_u - loc_eq);
+
+    if (param_key == "output_variables") {
+      config->variable_names.clear();
+      aggregation_names.clear();
+      std::stringstream names(param_value);
+      std::string name;
+      while (param_value != "none" && getline(names, name, ',')) {
+	size_t loc_colon = name.find(":");
+	config->variable_names.push_back(name.substr(0, loc_colon));
+	aggregation_names.push_back(loc_colon == std::string::npos ? "" : name.substr(loc_colon + 1));
+      }
+    }
+    else if (param_key == "output_interval") {
+      config->interval_steps = output_interval_steps(param_key, param_value, param_unit, timestep_s);
+    }
+    else if (param_key == "output_aggregation") {
+      default_aggregation = parse_aggregation(param_key, param_value);
+    }
+    else if (param_key == "output_layers") {
+      if (param_value == "true")
+	config->write_layers = true;
+      else if (param_value == "false")
+	config->write_layers = false;
+      else {
+	std::cerr<<"Invalid option: output_layers must be true or false. \n";
+	abort();
+      }
+    }
+    else if (param_key == "output_layers_interval") {
+      config->layers_interval_steps = output_interval_steps(param_key, param_value, param_unit, timestep_s);
+    }
+  }
+
+  config->aggregation.clear();
+  for (size_t j=0; j<aggregation_names.size(); j++)
+    config->aggregation.push_back(aggregation_names[j].empty() ? default_aggregation
+				  : parse_aggregation("output_variables", aggregation_names[j]));
+
+  if (config->layers_interval_steps == 0)
+    config->layers_interval_steps = config->interval_steps;
+}
@@ -0,0 +1,143 @@
+#include "../include/all.hxx"
+
+//#####################################################################################
+/* - The file contains the quadrature rules used for the numeric capillary drive Geff
+     (calc_Geff() in soil_funcs.cxx), besides the original adaptive trapezoid rule.
+   - Both rules integrate f(h) dh over u = ln(h), i.e. f(e^u) e^u du. For f = K(h) this
+     is a smooth bump in u (rising like e^u for small h and decaying like a power of h
+     for large h), so the integrand no longer varies over orders of magnitude of h.
+   - Below h = b*2^QUAD_LOG_H_RANGE (b the upper limit), f is taken as constant; for
+     K(h) that part is at most a 2^QUAD_LOG_H_RANGE fraction of the integral.
+   - The number of evaluations of f is added to *num_evals (may be NULL).            */
+//#####################################################################################
+
+#define QUAD_LOG_H_RANGE      -50   // lower end of the ln(h) range, as a power of 2 of the upper limit
+#define QUAD_GL_PANEL_WIDTH   1.0   // width of the Gauss-Legendre panels in ln(h)
+#define QUAD_TS_MAX_LEVEL     8     // number of times the tanh-sinh step is halved at most
+#define QUAD_TS_T_MAX         3.2   // tanh-sinh abscissas |t| <= QUAD_TS_T_MAX; 1-tanh(pi/2 sinh(3.2)) ~ 1E-16
+
+
+/* splits [a, b] into the part integrated over ln(h), [u_lo, ln(b)], and the part below it, which is returned */
+static double quad_log_h_limits(double (*f)(double, const void*), const void *context, double a, double b,
+				double *u_lo, double *u_hi, long *num_evals)
+{
+  double h_floor = ldexp(b, QUAD_LOG_H_RANGE);
+  double below = 0.0;
+
+  if (a < h_floor) {
+    below = (h_floor - a)*f(0.5*(a + h_floor), context);
+    if (num_evals != NULL)
+      (*num_evals)++;
+    a = h_floor;
+  }
+
+  *u_lo = log(a);
+  *u_hi = log(b);
+
+  return below;
+}
+
+
+/*#################################################################*/
+/* quad_gauss_legendre_log_h() - integral of f(h) from a to b,     */
+/* composite 6 point Gauss-Legendre in ln(h) with panels at most   */
+/* QUAD_GL_PANEL_WIDTH wide                                         */
+/*#################################################################*/
+extern double quad_gauss_legendre_log_h(double (*f)(double, const void*), const void *context, double a, double b,
+					long *num_evals)
+{
+  const double abscissa[3] = {0.2386191860831969, 0.6612093864662645, 0.9324695142031521};
+  const double weight[3]   = {0.4679139345726910, 0.3607615730481386, 0.1713244923791704};
+
+  if (!(b > a))
+    return 0.0;
+
+  double u_lo, u_hi;
+  double integral = quad_log_h_limits(f, context, a, b, &u_lo, &u_hi, num_evals);
+
+  int num_panels = (int)ceil((u_hi - u_lo)/QUAD_GL_PANEL_WIDTH);
+  if (num_panels < 1)
+    num_panels = 1;
+  double half_width = 0.5*(u_hi - u_lo)/num_panels;
+
+  for (int panel = 0; panel < num_panels; panel++) {
+    double u_mid = u_lo + (2*panel + 1)*half_width;
+    double sum = 0.0;
+
+    for (int k = 0; k < 3; k++) {
+      double h_left  = exp(u_mid - half_width*abscissa[k]);
+      double h_right = exp(u_mid + half_width*abscissa[k]);
+      sum += weight[k]*(f(h_left, context)*h_left + f(h_right, context)*h_right);
+    }
+
+    integral += half_width*sum;
+  }
+
+  if (num_evals != NULL)
+    *num_evals += 6*num_panels;
+
+  return integral;
+}
+
+
+/* weighted sum of the integrand at the tanh-sinh abscissa pair +-t on [u_lo, u_hi] in ln(h) */
+static double quad_tanh_sinh_pair(double (*f)(double, const void*), const void *context, double u_lo, double u_hi,
+				  double t)
+{
+  double half_range = 0.5*(u_hi - u_lo);
+  double s  = M_PI_2*sinh(t);
+  double cs = cosh(s);
+  double distance = half_range/(exp(s)*cs);  // distance of the abscissas from the ends, (1-tanh(s))*half_range
+  double weight   = M_PI_2*cosh(t)/(cs*cs);
+  double h_left   = exp(u_lo + distance);
+  double h_right  = exp(u_hi - distance);
+
+  return weight*(f(h_left, context)*h_left + f(h_right, context)*h_right);
+}
+
+
+/*#################################################################*/
+/* quad_tanh_sinh_log_h() - integral of f(h) from a to b, tanh-sinh */
+/* in ln(h); the step is halved until two successive estimates      */
+/* agree to the relative tolerance                                  */
+/*#################################################################*/
+extern double quad_tanh_sinh_log_h(double (*f)(double, const void*), const void *context, double a, double b,
+				   double tolerance, long *num_evals)
+{
+  if (!(b > a))
+    return 0.0;
+
+  double u_lo, u_hi;
+  double below = quad_log_h_limits(f, context, a, b, &u_lo, &u_hi, num_evals);
+  double half_range = 0.5*(u_hi - u_lo);
+  double h_mid = exp(0.5*(u_lo + u_hi));
+  long evals = 1;
+
+  double step = 1.0;
+  double sum = M_PI_2*f(h_mid, context)*h_mid;
+  for (double t = step; t <= QUAD_TS_T_MAX; t += step) {
+    sum += quad_tanh_sinh_pair(f, context, u_lo, u_hi, t);
+    evals += 2;
+  }
+
+  double integral = half_range*step*sum;
+
+  for (int level = 1; level <= QUAD_TS_MAX_LEVEL; level++) {
+    step *= 0.5;
+    for (double t = step; t <= QUAD_TS_T_MAX; t += 2.0*step) { // the new abscissas are halfway between the old ones
+      sum += quad_tanh_sinh_pair(f, context, u_lo, u_hi, t);
+      evals += 2;
+    }
+
+    double previous = integral;
+    integral = half_range*step*sum;
+
+    if (level >= 2 && fabs(integral - previous) <= tolerance*fabs(integral))
+      break;
+  }
+
+  if (num_evals != NULL)
+    *num_evals += evals;
+
+  return below + integral;
+}
@@ -31,8 +31,41 @@
 //This really helps when the limits of integration in terms of psi are quite far apart, and also helps to save runtime.
 /***********************************************************************************************/
 
+#define GEFF_QUADRATURE_TOLERANCE 1.E-9  // relative tolerance of the tanh-sinh rule
+
+/* van Genuchten parameters of the relative conductivity K(h)/Ksat integrated by the quadrature rules */
+struct Geff_integrand_params {
+  double vg_alpha, vg_m, vg_n;
+};
+
+static double Geff_integrand(double h, const void *context)
+{
+  const struct Geff_integrand_params *params = (const struct Geff_integrand_params *) context;
+  return calc_K_from_Se(calc_Se_from_h(h, params->vg_alpha, params->vg_m, params->vg_n), 1.0, params->vg_m);
+}
+
+/* closed form Geff of the Brooks-Corey model, given H_c and the exponent 3+1/lambda (see calc_Geff) */
+static double calc_Geff_closed_form(double theta1, double theta2, double theta_e, double theta_r, double H_c,
+				    double exponent)
+{
+  double Se_f = calc_Se_from_theta(theta1,theta_e,theta_r);    // the scaled moisture content of the wetting front
+  double Se_i = calc_Se_from_theta(theta2,theta_e,theta_r);    // the scaled moisture content below the wetting front
+  double Se_f_pow = pow(Se_f,exponent);
+  double Geff = H_c*(pow(Se_i,exponent)-Se_f_pow)/(1-Se_f_pow);
+
+  if (isinf(Geff)){
+    Geff = H_c;
+  }
+  if (isnan(Geff)){
+    Geff = H_c;
+  }
+
+  return Geff;
+}
+
 extern double calc_Geff(bool use_closed_form_G, double theta1, double theta2, double theta_e, double theta_r,
-                        double vg_alpha, double vg_n, double vg_m, double h_min, double Ksat, int nint, double lambda, double bc_psib_cm)
+                        double vg_alpha, double vg_n, double vg_m, double h_min, double Ksat, int nint, double lambda, double bc_psib_cm,
+                        struct Geff_quadrature *quadrature)
 
 {
   double Geff;       // this is the result to be returned.
@@ -57,7 +90,7 @@ extern double calc_Geff(bool use_closed_form_G, double theta1, double theta2, do
       //return h_min; // commenting out as this is not used in the Python version
     }
 
-    if (verbosity.compare("high") == 0) {
+    if (LGAR_LOG_HIGH) {
       // debug statements to see if calc_Se_from_h function is working properly
       Se = calc_Se_from_h(h_i,vg_alpha,vg_m,vg_n);
       printf("Se_i = %8.6lf,  Se_inverse = %8.6lf\n", Se_i, Se);
@@ -66,6 +99,28 @@ extern double calc_Geff(bool use_closed_form_G, double theta1, double theta2, do
       printf("Se_f = %8.6lf,  Se_inverse = %8.6lf\n", Se_f, Se);
     }
 
+    if (quadrature != NULL && quadrature->rule != GEFF_QUADRATURE_TRAPEZOID) {
+      // K/Ksat is integrated, so Ksat cancels
+      struct Geff_integrand_params params = {vg_alpha, vg_m, vg_n};
+      double h_lo = fmin(h_i, h_f);
+      double h_hi = fmax(h_i, h_f);
+
+      if (quadrature->rule == GEFF_QUADRATURE_GAUSS_LEGENDRE)
+        Geff = quad_gauss_legendre_log_h(Geff_integrand, &params, h_lo, h_hi, &quadrature->num_evals);
+      else
+        Geff = quad_tanh_sinh_log_h(Geff_integrand, &params, h_lo, h_hi, GEFF_QUADRATURE_TOLERANCE,
+                                    &quadrature->num_evals);
+      quadrature->num_integrals++;
+
+      Geff = fabs(Geff);
+
+      if (LGAR_LOG_HIGH){
+        printf ("Capillary suction (G) = %8.6lf \n", Geff);
+      }
+
+      return Geff;
+    }
+
     dh = (h_i-h_f)/(double)nint;
     dh = dh*0.01; //factor used to make dh small to begin with; dh begins small and is adaptively changed
 
@@ -77,6 +132,7 @@ extern double calc_Geff(bool use_closed_form_G, double theta1, double theta2, do
     Se1 = Se_i;  // could just use Se_i in next statement.  Done 4 completeness.
     K1  = calc_K_from_Se(Se1, Ksat, vg_m);
     h2  = h_f + dh;
+    long num_evals = 1;
 
     while(h2<h_i) {
 
@@ -84,6 +140,7 @@ extern double calc_Geff(bool use_closed_form_G, double theta1, double theta2, do
 
       Se2 = calc_Se_from_h(h2, vg_alpha, vg_m, vg_n);
       K2  = calc_K_from_Se(Se2, Ksat, vg_m);
+      num_evals++;
 
       //dh is the trapezoid width for numerical integration. dh becomes smaller if the percent difference between K1 and K2 is too large, and dh becomes bigger if K1 and K2 are sufficiently close.
       //In the case that (K1-K2)/K2 > 0.02, K1 and K2 differ by more than 2 percent. The factor of 2 percent seemed to offer the optimal intersection of accuracy and speed. 
@@ -102,6 +159,7 @@ extern double calc_Geff(bool use_closed_form_G, double theta1, double theta2, do
         Se2 = calc_Se_from_h(h_i, vg_alpha, vg_m, vg_n);
         K2  = calc_K_from_Se(Se2, Ksat, vg_m);
         Geff += (K1+K2)*dh/2.0;  
+        num_evals++;
       }
 
       // reset for next time through loop
@@ -110,10 +168,15 @@ extern double calc_Geff(bool use_closed_form_G, double theta1, double theta2, do
 
     }
 
+    if (quadrature != NULL) {
+      quadrature->num_integrals++;
+      quadrature->num_evals += num_evals;
+    }
+
     //std::cerr<<"Integral = "<< Geff<<" "<<Ksat<<"\n";
     Geff = fabs(Geff/Ksat);       // by convention Geff is a positive quantity
 
-    if (verbosity.compare("high") == 0){
+    if (LGAR_LOG_HIGH){
       printf ("Capillary suction (G) = %8.6lf \n", Geff);
     }
 
@@ -122,18 +185,9 @@ extern double calc_Geff(bool use_closed_form_G, double theta1, double theta2, do
   }
    else {
 
-     double Se_f = calc_Se_from_theta(theta1,theta_e,theta_r);    // the scaled moisture content of the wetting front
-     double Se_i = calc_Se_from_theta(theta2,theta_e,theta_r);    // the scaled moisture content below the wetting front
      double H_c = bc_psib_cm*((2+3*lambda)/(1+3*lambda));            // Green ampt capillary drive parameter, which can be used in the approximation of G with the Brooks-Corey model (See Ogden and Saghafian, 1997)
-     Geff = H_c*(pow(Se_i,(3+1/lambda))-pow(Se_f,(3+1/lambda)))/(1-pow(Se_f,(3+1/lambda)));
-     if (isinf(Geff)){
-       Geff = H_c;
-     }
-     if (isnan(Geff)){
-       Geff = H_c;
-     }
 
-     return Geff;
+     return calc_Geff_closed_form(theta1, theta2, theta_e, theta_r, H_c, 3+1/lambda);
 
   }
 
@@ -149,6 +203,16 @@ double calc_theta_from_h(double h,double alpha, double m, double n, double theta
   return(1.0/(pow(1.0+pow(alpha*h,n),m))*(theta_e-theta_r)+theta_r);
 }
 
+/*****************************************************/
+/* function to calculate d(theta)/dh from h; theta  */
+/* decreases with h, so the derivative is <= 0       */
+/*****************************************************/
+double calc_dtheta_dh_from_h(double h,double alpha, double m, double n, double theta_e, double theta_r)
+{
+  double ah_n = pow(alpha*h,n);
+  return(-(theta_e-theta_r)*m*n*alpha*pow(alpha*h,n-1.0)*pow(1.0+ah_n,-m-1.0));
+}
+
 /***********************************/
 /* function to calculate Se from h */
 /***********************************/
@@ -185,3 +249,500 @@ double calc_Se_from_theta(double theta,double e,double r)
 {
   return((theta-r)/(e-r));
 }
+
+
+
+/*****************************************************************/
+/* computes the constants of a soil derived from its parameters; */
+/* must be called again whenever the soil's parameters change    */
+/*****************************************************************/
+extern void lgar_calc_soil_constants(struct soil_properties_ *soil)
+{
+  double lambda = soil->bc_lambda;
+
+  soil->vg_m_inv         = 1.0/soil->vg_m;
+  soil->vg_n_inv         = 1.0/soil->vg_n;
+  soil->vg_alpha_inv_cm  = 1.0/soil->vg_alpha_per_cm;
+  soil->bc_Geff_exponent = 3+1/lambda;
+  soil->bc_H_c_cm        = soil->bc_psib_cm*((2+3*lambda)/(1+3*lambda));
+}
+
+
+
+/***********************************************************************************************/
+/* Tabulated van Genuchten relations.                                                          */
+/* If use_vG_tables is set in the config file, Se(h), K(Se)/Ksat and h(Se) of the soils in use  */
+/* are tabulated once (and again whenever calibration changes a soil's parameters). Between the */
+/* nodes a cubic Hermite polynomial is evaluated, so a lookup costs a frexp() and a few         */
+/* multiply-adds instead of the pow() calls of the closed forms.                               */
+/* The tables are over a piecewise linear log2 coordinate: of h for Se(h), and of Se (Se<=0.5)  */
+/* or 1-Se (Se>0.5) for K(Se) and h(Se), in which the power law behaviour of the relations near */
+/* saturation and near residual water content is smooth. The number of nodes is increased until */
+/* the interpolation error, checked against the closed form inside every interval, is below    */
+/* the tolerance. Outside the tabulated ranges the closed forms are used.                      */
+/***********************************************************************************************/
+
+#define VG_TABLE_MAX_INTERVALS_PER_OCTAVE 1024 // the table is dropped (closed form used) if the tolerance needs more
+#define VG_TABLE_LOG2_H_MIN  -12               // Se(h) is tabulated for 2^VG_TABLE_LOG2_H_MIN <= h <= 2^VG_TABLE_LOG2_H_MAX [cm]
+#define VG_TABLE_LOG2_H_MAX   24
+#define VG_TABLE_LOG2_SE_MIN -40               // K(Se) and h(Se) are tabulated for 2^VG_TABLE_LOG2_SE_MIN <= Se, 1-Se <= 0.5
+
+/* piecewise linear approximation of log2(y), exact at powers of 2; computed from the binary exponent, so without a
+   log() call. The tables are smooth inside each octave, so the powers of 2 are always nodes */
+static inline double vG_table_log2(double y)
+{
+  int e;
+  double mant = frexp(y, &e); // y = mant*2^e, 0.5 <= mant < 1
+  return (double)(e - 1) + (2.0*mant - 1.0);
+}
+
+static double vG_table_exp2(double x)
+{
+  double e = floor(x);
+  return ldexp(1.0 + (x - e), (int)e);
+}
+
+/* the relations in the coordinates of the tables. Near Se = 0 and Se = 1 the closed forms lose digits to cancellation,
+   so the nodes are computed from expm1/log1p forms of the same expressions */
+static double vG_table_Se_from_h(double x, const struct soil_properties_ *soil)
+{
+  return calc_Se_from_h(vG_table_exp2(x), soil->vg_alpha_per_cm, soil->vg_m, soil->vg_n);
+}
+
+static double vG_table_K_dry(double x, const struct soil_properties_ *soil) // x = log2(Se)
+{
+  double Se = vG_table_exp2(x);
+  double a = -expm1(soil->vg_m * log1p(-pow(Se, 1.0/soil->vg_m)));  // 1 - (1 - Se^(1/m))^m
+  return sqrt(Se) * a * a;
+}
+
+static double vG_table_K_wet(double x, const struct soil_properties_ *soil) // x = log2(1-Se)
+{
+  double one_minus_Se = vG_table_exp2(x);
+  double a = -expm1(log1p(-one_minus_Se) / soil->vg_m);              // 1 - Se^(1/m)
+  double b = 1.0 - pow(a, soil->vg_m);
+  return sqrt(1.0 - one_minus_Se) * b * b;
+}
+
+static double vG_table_h_dry(double x, const struct soil_properties_ *soil) // x = log2(Se)
+{
+  return calc_h_from_Se(vG_table_exp2(x), soil->vg_alpha_per_cm, soil->vg_m, soil->vg_n);
+}
+
+static double vG_table_h_wet(double x, const struct soil_properties_ *soil) // x = log2(1-Se)
+{
+  double b = expm1(-log1p(-vG_table_exp2(x)) / soil->vg_m);         // Se^(-1/m) - 1
+  return pow(b, 1.0/soil->vg_n) / soil->vg_alpha_per_cm;
+}
+
+/* evaluates the table at x, x_lo <= x <= x_hi */
+static inline double vG_table_eval(const struct vG_table *table, double x)
+{
+  double u = (x - table->x_lo) * table->dx_inv;
+  int i = (int)u;
+  if (i >= table->num_intervals)
+    i = table->num_intervals - 1;
+  double t = u - i;
+
+  double y0 = table->y[i];
+  double y1 = table->y[i+1];
+  double m0 = table->dydx_lo[i];
+  double m1 = table->dydx_hi[i];
+  double c2 = 3.0*(y1 - y0) - 2.0*m0 - m1;
+  double c3 = 2.0*(y0 - y1) + m0 + m1;
+
+  return y0 + t*(m0 + t*(c2 + t*c3));
+}
+
+/* limits the slopes of each interval so that its cubic stays monotone between the node values (Fritsch-Carlson):
+   a slope against the direction of the interval is set to zero, and both slopes are scaled back onto the circle of
+   radius 3 (in units of the node difference) if they lie outside it. The two slopes at a node are stored per
+   interval, so each interval is limited on its own */
+static void vG_table_limit_slopes(struct vG_table *table)
+{
+  for (int i = 0; i < table->num_intervals; i++) {
+    double delta = table->y[i+1] - table->y[i];
+
+    if (delta == 0.0) {
+      table->dydx_lo[i] = 0.0;
+      table->dydx_hi[i] = 0.0;
+      continue;
+    }
+
+    double a = table->dydx_lo[i] / delta;
+    double b = table->dydx_hi[i] / delta;
+    if (a < 0.0)
+      a = 0.0;
+    if (b < 0.0)
+      b = 0.0;
+
+    double radius_sq = a*a + b*b;
+    if (radius_sq > 9.0) {
+      double tau = 3.0 / sqrt(radius_sq);
+      a *= tau;
+      b *= tau;
+    }
+
+    table->dydx_lo[i] = a * delta;
+    table->dydx_hi[i] = b * delta;
+  }
+}
+
+/* fills the table with per_octave intervals per octave on [x_lo, x_hi]. The node slopes are derivatives of the
+   relation (central differences over a step much smaller than the node spacing); at a power of 2 the slope of the
+   coordinate halves from the octave above to the one below, so the step below the node is twice as long in x and
+   the slope on that side half as large */
+static void vG_table_fill(struct vG_table *table, double (*relation)(double, const struct soil_properties_*),
+			  const struct soil_properties_ *soil, int x_lo, int x_hi, int per_octave)
+{
+  const double step = 1.0/(1 << 18);
+  int n = per_octave * (x_hi - x_lo);
+  double dx = 1.0 / per_octave;
+
+  table->num_intervals = n;
+  table->x_lo = x_lo;
+  table->x_hi = x_hi;
+  table->dx_inv = per_octave;
+  table->y.resize(n + 1);
+  table->dydx_lo.resize(n);
+  table->dydx_hi.resize(n);
+
+  for (int i = 0; i <= n; i++) {
+    double x = x_lo + i*dx;
+    double r = (i % per_octave == 0) ? 2.0 : 1.0;
+    double slope_above = (relation(x + step, soil) - relation(x - r*step, soil)) / (2.0*step);
+
+    table->y[i] = relation(x, soil);
+    if (i < n)
+      table->dydx_lo[i] = slope_above * dx;
+    if (i > 0)
+      table->dydx_hi[i-1] = slope_above / r * dx;
+  }
+
+  vG_table_limit_slopes(table);
+}
+
+/* largest interpolation error of the table relative to the tolerance (absolute, or relative to |y|); the error of a
+   cubic Hermite interpolant peaks mid-interval, so it is checked there */
+static double vG_table_error_ratio(const struct vG_table *table, double (*relation)(double, const struct soil_properties_*),
+				   const struct soil_properties_ *soil, double tolerance, bool relative)
+{
+  double max_ratio = 0.0;
+
+  for (int i = 0; i < table->num_intervals; i++) {
+    double x = table->x_lo + (i + 0.5)/table->dx_inv;
+    double exact = relation(x, soil);
+    double allowed = relative ? tolerance*fabs(exact) + DBL_MIN : tolerance;
+    double ratio = fabs(vG_table_eval(table, x) - exact) / allowed;
+
+    if (!(ratio <= max_ratio)) {
+      if (isnan(ratio))
+	return ratio;
+      max_ratio = ratio;
+    }
+  }
+
+  return max_ratio;
+}
+
+/* builds a table over the octaves [x_lo, x_hi] with an interpolation error below tolerance. The node spacing is
+   predicted from the error of a coarse table (the error decreases with the fourth power of the spacing) and doubled
+   until the tolerance is met; the table is left empty if that needs more than VG_TABLE_MAX_INTERVALS_PER_OCTAVE */
+static void vG_table_build(struct vG_table *table, double (*relation)(double, const struct soil_properties_*),
+			   const struct soil_properties_ *soil, int x_lo, int x_hi, double tolerance, bool relative)
+{
+  if (x_hi > x_lo) {
+    int per_octave = 4;
+
+    while (per_octave <= VG_TABLE_MAX_INTERVALS_PER_OCTAVE) {
+      vG_table_fill(table, relation, soil, x_lo, x_hi, per_octave);
+
+      double error_ratio = vG_table_error_ratio(table, relation, soil, tolerance, relative);
+      if (error_ratio <= 1.0)
+	return;
+
+      int next = 2*per_octave;
+      if (error_ratio < HUGE_VAL) { // not nan or inf
+	double predicted = per_octave * pow(error_ratio, 0.25);
+	while (next < predicted && next < VG_TABLE_MAX_INTERVALS_PER_OCTAVE)
+	  next *= 2;
+      }
+      per_octave = next;
+    }
+
+    if (LGAR_LOG_HIGH)
+      std::cerr<<"Lookup table for soil "<< soil->soil_name <<" does not meet the tolerance; closed form is used. \n";
+  }
+
+  table->num_intervals = 0;
+  table->y.clear();
+  table->dydx_lo.clear();
+  table->dydx_hi.clear();
+}
+
+/*************************************************************/
+/* builds (or rebuilds) the lookup tables of a soil; must be  */
+/* called again whenever the soil's vG parameters change      */
+/*************************************************************/
+extern void lgar_build_vG_tables(struct soil_properties_ *soil, double tolerance)
+{
+  vG_table_build(&soil->Se_from_h_table, vG_table_Se_from_h, soil, VG_TABLE_LOG2_H_MIN, VG_TABLE_LOG2_H_MAX,
+		 tolerance, false);
+
+  // the Se tables cover the range of Se(h) tabulated above: they start at the octave of Se (dry) or 1-Se (wet) at the
+  // largest or smallest tabulated h
+  double Se_dry = calc_Se_from_h(ldexp(1.0, VG_TABLE_LOG2_H_MAX), soil->vg_alpha_per_cm, soil->vg_m, soil->vg_n);
+  double Se_wet = vG_table_Se_from_h(VG_TABLE_LOG2_H_MIN, soil);
+  int log2_Se_dry = (Se_dry > 0.0) ? (int)floor(log2(Se_dry)) : VG_TABLE_LOG2_SE_MIN;
+  int log2_Se_wet = (Se_wet < 1.0) ? (int)floor(log2(1.0 - Se_wet)) : VG_TABLE_LOG2_SE_MIN;
+  log2_Se_dry = std::max(VG_TABLE_LOG2_SE_MIN, std::min(log2_Se_dry, -1));
+  log2_Se_wet = std::max(VG_TABLE_LOG2_SE_MIN, std::min(log2_Se_wet, -1));
+
+  vG_table_build(&soil->K_from_Se_table[0], vG_table_K_dry, soil, log2_Se_dry, -1, tolerance, true);
+  vG_table_build(&soil->K_from_Se_table[1], vG_table_K_wet, soil, log2_Se_wet, -1, tolerance, true);
+  vG_table_build(&soil->h_from_Se_table[0], vG_table_h_dry, soil, log2_Se_dry, -1, tolerance, true);
+  vG_table_build(&soil->h_from_Se_table[1], vG_table_h_wet, soil, log2_Se_wet, -1, tolerance, true);
+
+  if (LGAR_LOG_HIGH) {
+    std::cerr<<"Lookup tables for soil "<< soil->soil_name <<" (number of intervals): Se(h) "
+	     << soil->Se_from_h_table.num_intervals <<", K(Se) "
+	     << soil->K_from_Se_table[0].num_intervals <<" + "<< soil->K_from_Se_table[1].num_intervals <<", h(Se) "
+	     << soil->h_from_Se_table[0].num_intervals <<" + "<< soil->h_from_Se_table[1].num_intervals <<"\n";
+  }
+}
+
+/* looks up y(Se) in the dry (Se <= 0.5) or wet half of a pair of tables; returns false if Se is not tabulated */
+static inline bool vG_table_lookup_Se(const struct vG_table *tables, double Se, double *y)
+{
+  int wet = (Se > 0.5);
+  const struct vG_table *table = &tables[wet];
+  double Se_or_dry = wet ? 1.0 - Se : Se;
+
+  if (table->num_intervals == 0 || !(Se_or_dry > 0.0))
+    return false;
+
+  double x = vG_table_log2(Se_or_dry);
+  if (x < table->x_lo || x > table->x_hi)
+    return false;
+
+  *y = vG_table_eval(table, x);
+  return true;
+}
+
+/********************************************************/
+/* theta from h of a soil, tabulated if available        */
+/********************************************************/
+extern double soil_theta_from_h(const struct soil_properties_ *soil, double h)
+{
+  const struct vG_table *table = &soil->Se_from_h_table;
+
+  if (table->num_intervals > 0 && h > 0.0) {
+    double x = vG_table_log2(h);
+    if (x >= table->x_lo && x <= table->x_hi)
+      return soil->theta_r + vG_table_eval(table, x)*(soil->theta_e - soil->theta_r);
+  }
+
+  return calc_theta_from_h(h, soil->vg_alpha_per_cm, soil->vg_m, soil->vg_n, soil->theta_e, soil->theta_r);
+}
+
+/********************************************************/
+/* h from Se of a soil, tabulated if available           */
+/********************************************************/
+extern double soil_h_from_Se(const struct soil_properties_ *soil, double Se)
+{
+  double h;
+
+  if (vG_table_lookup_Se(soil->h_from_Se_table, Se, &h))
+    return h;
+
+  // calc_h_from_Se() with the precomputed inverses of the parameters
+  h = soil->vg_alpha_inv_cm*pow(pow(Se,-soil->vg_m_inv)-1.0,soil->vg_n_inv);
+  if (h > 1.E20){
+    h = 1.E20;
+  }
+  return h;
+}
+
+/********************************************************/
+/* K from Se of a soil, tabulated if available; Ksat     */
+/* is passed so that it can include the frozen factor    */
+/********************************************************/
+extern double soil_K_from_Se(const struct soil_properties_ *soil, double Se, double Ksat)
+{
+  double K_relative;
+
+  if (vG_table_lookup_Se(soil->K_from_Se_table, Se, &K_relative))
+    return Ksat * K_relative;
+
+  // calc_K_from_Se() with the precomputed inverse of m
+  return (Ksat * sqrt(Se) * pow(1.0 - pow(1.0 - pow(Se,soil->vg_m_inv), soil->vg_m), 2.0));
+}
+
+
+/***********************************************************************************************/
+/* Precomputed numeric Geff.                                                                   */
+/* The numeric Geff(theta1, theta2) is the integral of K(h)/Ksat between h(theta1) and          */
+/* h(theta2), i.e. F(h1) - F(h2) for the cumulative integral F(h) = int_0^h K/Ksat dh', which  */
+/* only depends on the soil's vG parameters. If use_Geff_table is set in the config file, F is  */
+/* tabulated once per soil over the same piecewise linear log2(h) coordinate as the vG tables   */
+/* (node values by Gauss-Legendre quadrature, node slopes K(h)/Ksat dh/dx exactly) and Geff is  */
+/* read off as a difference instead of being integrated on every call.                         */
+/***********************************************************************************************/
+
+#define GEFF_TABLE_LOG2_H_MIN  -40   // F(h) is tabulated for 2^GEFF_TABLE_LOG2_H_MIN <= h <= 2^GEFF_TABLE_LOG2_H_MAX [cm]
+#define GEFF_TABLE_LOG2_H_MAX   67   // calc_h_from_Se() caps h at 1.E20 cm < 2^67 cm
+#define GEFF_TABLE_TOLERANCE  1.E-9  // interpolation error bound relative to the integral over the whole table
+
+/* K/Ksat at h */
+static inline double Geff_K_relative(const struct soil_properties_ *soil, double h)
+{
+  return calc_K_from_Se(calc_Se_from_h(h, soil->vg_alpha_per_cm, soil->vg_m, soil->vg_n), 1.0, soil->vg_m);
+}
+
+/* integral of K/Ksat from h1 to h2, 3 point Gauss-Legendre (sixth order; the intervals are a small fraction of an
+   octave of h) */
+static double Geff_integral(const struct soil_properties_ *soil, double h1, double h2)
+{
+  const double abscissa = 0.7745966692414834; // sqrt(3/5)
+  double h_mid  = 0.5*(h1 + h2);
+  double h_half = 0.5*(h2 - h1);
+
+  return h_half/9.0 * (8.0*Geff_K_relative(soil, h_mid) + 5.0*(Geff_K_relative(soil, h_mid - h_half*abscissa) +
+								 Geff_K_relative(soil, h_mid + h_half*abscissa)));
+}
+
+/* fills the table of F with per_octave intervals per octave on [x_lo, x_hi]; h is linear in x inside an interval, so
+   the node slopes scaled by the interval width are K/Ksat times the interval width in h */
+static void Geff_table_fill(struct vG_table *table, const struct soil_properties_ *soil, int x_lo, int x_hi, int per_octave)
+{
+  int n = per_octave * (x_hi - x_lo);
+  double dx = 1.0 / per_octave;
+
+  table->num_intervals = n;
+  table->x_lo = x_lo;
+  table->x_hi = x_hi;
+  table->dx_inv = per_octave;
+  table->y.resize(n + 1);
+  table->dydx_lo.resize(n);
+  table->dydx_hi.resize(n);
+
+  double h_lower = vG_table_exp2(x_lo);
+  double K_lower = Geff_K_relative(soil, h_lower);
+  table->y[0] = Geff_integral(soil, 0.0, h_lower);
+
+  for (int i = 0; i < n; i++) {
+    double h_upper = vG_table_exp2(x_lo + (i+1)*dx);
+    double K_upper = Geff_K_relative(soil, h_upper);
+    double dh = h_upper - h_lower;
+
+    table->y[i+1] = table->y[i] + Geff_integral(soil, h_lower, h_upper);
+    table->dydx_lo[i] = K_lower*dh;
+    table->dydx_hi[i] = K_upper*dh;
+
+    h_lower = h_upper;
+    K_lower = K_upper;
+  }
+
+  vG_table_limit_slopes(table);
+}
+
+/*************************************************************/
+/* builds (or rebuilds) the table of the cumulative integral */
+/* of K/Ksat of a soil; must be called again whenever the    */
+/* soil's vG parameters change                               */
+/*************************************************************/
+extern void lgar_build_Geff_table(struct soil_properties_ *soil)
+{
+  struct vG_table *table = &soil->Geff_F_table;
+  int x_lo = GEFF_TABLE_LOG2_H_MIN;
+  int x_hi = GEFF_TABLE_LOG2_H_MAX;
+  int per_octave = 4;
+
+  while (per_octave <= VG_TABLE_MAX_INTERVALS_PER_OCTAVE) {
+    Geff_table_fill(table, soil, x_lo, x_hi, per_octave);
+
+    // the error is checked mid-interval against the integral from the lower node
+    double allowed = GEFF_TABLE_TOLERANCE * table->y[table->num_intervals];
+    double max_ratio = 0.0;
+    for (int i = 0; i < table->num_intervals && !isnan(max_ratio); i++) {
+      double x = x_lo + (i + 0.5)/per_octave;
+      double exact = table->y[i] + Geff_integral(soil, vG_table_exp2(x_lo + (double)i/per_octave), vG_table_exp2(x));
+      max_ratio = fmax(max_ratio, fabs(vG_table_eval(table, x) - exact)/allowed);
+      if (isnan(exact))
+	max_ratio = exact;
+    }
+
+    if (max_ratio <= 1.0) {
+      if (LGAR_LOG_HIGH)
+	std::cerr<<"Geff table for soil "<< soil->soil_name <<" (number of intervals): "<< table->num_intervals <<"\n";
+      return;
+    }
+
+    // the error decreases with the fourth power of the node spacing
+    int next = 2*per_octave;
+    if (max_ratio < HUGE_VAL) {
+      double predicted = per_octave * pow(max_ratio, 0.25);
+      while (next < predicted && next < VG_TABLE_MAX_INTERVALS_PER_OCTAVE)
+	next *= 2;
+    }
+    per_octave = next;
+  }
+
+  if (LGAR_LOG_HIGH)
+    std::cerr<<"Geff table for soil "<< soil->soil_name <<" does not meet the tolerance; numeric integration is used. \n";
+
+  table->num_intervals = 0;
+  table->y.clear();
+  table->dydx_lo.clear();
+  table->dydx_hi.clear();
+}
+
+/* looks up F(h). Below the table F is linear (K/Ksat is 1 there); above it (beyond the cap of h) F is constant.
+   Returns false for invalid h */
+static inline bool Geff_F_lookup(const struct vG_table *table, double h, double *F)
+{
+  if (h == 0.0) {
+    *F = 0.0;
+    return true;
+  }
+  if (!(h > 0.0))
+    return false;
+
+  double x = vG_table_log2(h);
+  if (x < table->x_lo)
+    *F = table->y[0] * h / vG_table_exp2(table->x_lo);
+  else if (x > table->x_hi)
+    *F = table->y[table->num_intervals];
+  else
+    *F = vG_table_eval(table, x);
+
+  return true;
+}
+
+/***********************************************************/
+/* Geff of a soil between theta1 and theta2; the closed     */
+/* form uses the soil's derived constants, the numeric Geff */
+/* is read off the precomputed cumulative integral if it    */
+/* has been built, calc_Geff() otherwise. Ksat is passed so */
+/* that it can include the frozen factor                    */
+/***********************************************************/
+extern double soil_Geff(const struct soil_properties_ *soil, bool use_closed_form_G, double theta1, double theta2,
+			double Ksat, int nint, struct Geff_quadrature *quadrature)
+{
+  const struct vG_table *table = &soil->Geff_F_table;
+
+  if (use_closed_form_G)
+    return calc_Geff_closed_form(theta1, theta2, soil->theta_e, soil->theta_r, soil->bc_H_c_cm, soil->bc_Geff_exponent);
+
+  if (table->num_intervals > 0) {
+    double h1 = soil_h_from_Se(soil, calc_Se_from_theta(theta1, soil->theta_e, soil->theta_r));
+    double h2 = soil_h_from_Se(soil, calc_Se_from_theta(theta2, soil->theta_e, soil->theta_r));
+    double F1, F2;
+
+    if (Geff_F_lookup(table, h1, &F1) && Geff_F_lookup(table, h2, &F2))
+      return fabs(F1 - F2);  // by convention Geff is a positive quantity
+  }
+
+  return calc_Geff(use_closed_form_G, theta1, theta2, soil->theta_e, soil->theta_r, soil->vg_alpha_per_cm, soil->vg_n,
+		   soil->vg_m, soil->h_min_cm, Ksat, nint, soil->bc_lambda, soil->bc_psib_cm, quadrature);
+}
@@ -0,0 +1,129 @@
+/*
+  - Accuracy and speed benchmark of the quadrature rules for the numeric capillary drive Geff (calc_Geff)
+  - for every soil in the van Genuchten parameter file, Geff is computed over a grid of (theta1, theta2) pairs
+    with each rule and compared against a dense reference integral (composite 3 point Gauss-Legendre, in ln(h))
+  - reports the maximum relative error, the mean number of K evaluations and the time per call of each rule,
+    and the fastest rule that meets the target relative error
+  - usage: lasam_Geff_benchmark [vG parameter file] [target relative error]
+           defaults: ../data/vG_default_params.dat 1.E-6
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include "../include/all.hxx"
+
+#define NUM_RULES        3
+#define NINT             120      // as set in InitFromConfigFile
+#define REFERENCE_PANELS 20000    // number of panels of the reference integral
+#define REFERENCE_H_MIN  1.E-14   // [cm], K(h) is taken as Ksat below it in the reference integral
+
+static double reference_K_relative(double h, double vg_alpha, double vg_m, double vg_n)
+{
+  return calc_K_from_Se(calc_Se_from_h(h, vg_alpha, vg_m, vg_n), 1.0, vg_m);
+}
+
+static double reference_Geff(const struct soil_properties_ *soil, double theta1, double theta2)
+{
+  const double abscissa[3] = {-0.7745966692414834, 0.0, 0.7745966692414834};
+  const double weight[3]   = {5.0/9.0, 8.0/9.0, 5.0/9.0};
+
+  double h1 = calc_h_from_Se(calc_Se_from_theta(theta1, soil->theta_e, soil->theta_r), soil->vg_alpha_per_cm,
+			     soil->vg_m, soil->vg_n);
+  double h2 = calc_h_from_Se(calc_Se_from_theta(theta2, soil->theta_e, soil->theta_r), soil->vg_alpha_per_cm,
+			     soil->vg_m, soil->vg_n);
+  double h_lo = fmin(h1, h2);
+  double h_hi = fmax(h1, h2);
+  double integral = 0.0;
+
+  if (h_lo < REFERENCE_H_MIN) {
+    integral += REFERENCE_H_MIN - h_lo;
+    h_lo = REFERENCE_H_MIN;
+  }
+
+  double u_lo = log(h_lo);
+  double du = (log(h_hi) - u_lo)/REFERENCE_PANELS;
+
+  for (int panel = 0; panel < REFERENCE_PANELS; panel++) {
+    double u_mid = u_lo + (panel + 0.5)*du;
+    for (int k = 0; k < 3; k++) {
+      double h = exp(u_mid + 0.5*du*abscissa[k]);
+      integral += 0.5*du*weight[k]*reference_K_relative(h, soil->vg_alpha_per_cm, soil->vg_m, soil->vg_n)*h;
+    }
+  }
+
+  return integral;
+}
+
+
+int main(int argc, char *argv[])
+{
+  const char *vG_param_file = (argc > 1) ? argv[1] : "../data/vG_default_params.dat";
+  double target_error       = (argc > 2) ? atof(argv[2]) : 1.E-6;
+
+  const char *rule_name[NUM_RULES] = {"trapezoid", "gauss_legendre", "tanh_sinh"};
+  double max_error[NUM_RULES] = {0.0};
+  double time_us[NUM_RULES] = {0.0};
+  long num_calls = 0;
+  struct Geff_quadrature quadrature[NUM_RULES];
+
+  for (int rule = 0; rule < NUM_RULES; rule++)
+    quadrature[rule].rule = rule;
+
+  struct soil_properties_ *soil_properties = new soil_properties_[MAX_NUM_SOIL_TYPES+1];
+  int num_soils = lgar_read_vG_param_file(vG_param_file, MAX_NUM_SOIL_TYPES, -15495.0, soil_properties, false);
+
+  printf("%-20s", "soil");
+  for (int rule = 0; rule < NUM_RULES; rule++)
+    printf(" %16s", rule_name[rule]);
+  printf("   (max. relative error)\n");
+
+  for (int soil = 1; soil <= num_soils; soil++) {
+    struct soil_properties_ *properties = &soil_properties[soil];
+    double soil_error[NUM_RULES] = {0.0};
+
+    for (double theta1 = properties->theta_r + 0.01; theta1 < properties->theta_e; theta1 += 0.03) {
+      for (double theta2 = theta1 + 0.005; theta2 <= properties->theta_e; theta2 += 0.041) {
+	double reference = reference_Geff(properties, theta1, theta2);
+	num_calls++;
+
+	for (int rule = 0; rule < NUM_RULES; rule++) {
+	  auto start = std::chrono::steady_clock::now();
+	  double Geff = soil_Geff(properties, false, theta1, theta2, properties->Ksat_cm_per_h, NINT, &quadrature[rule]);
+	  auto end = std::chrono::steady_clock::now();
+
+	  time_us[rule] += std::chrono::duration<double, std::micro>(end - start).count();
+	  soil_error[rule] = fmax(soil_error[rule], fabs(Geff - reference)/reference);
+	}
+      }
+    }
+
+    printf("%-20s", properties->soil_name);
+    for (int rule = 0; rule < NUM_RULES; rule++) {
+      printf(" %16.2e", soil_error[rule]);
+      max_error[rule] = fmax(max_error[rule], soil_error[rule]);
+    }
+    printf("\n");
+  }
+
+  printf("\n%-16s %16s %16s %16s\n", "rule", "max. rel. error", "mean K evals", "time/call [us]");
+
+  int fastest = -1;
+  for (int rule = 0; rule < NUM_RULES; rule++) {
+    double time_per_call = time_us[rule]/num_calls;
+    printf("%-16s %16.2e %16.1f %16.3f\n", rule_name[rule], max_error[rule],
+	   (double)quadrature[rule].num_evals/quadrature[rule].num_integrals, time_per_call);
+
+    if (max_error[rule] <= target_error && (fastest < 0 || time_per_call < time_us[fastest]/num_calls))
+      fastest = rule;
+  }
+
+  if (fastest < 0)
+    printf("\nNo rule meets the target relative error %.2e\n", target_error);
+  else
+    printf("\nFastest rule meeting the target relative error %.2e: Geff_quadrature=%s\n", target_error, rule_name[fastest]);
+
+  delete [] soil_properties;
+
+  return 0;
+}
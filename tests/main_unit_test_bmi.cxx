@@ -12,8 +12,12 @@
 #include <iostream>
 #include <cmath>
 #include <iomanip> // std::setw
+#include <thread>
+#include <fstream>
 #include "../bmi/bmi.hxx"
 #include "../include/bmi_lgar.hxx"
+#include "../include/lasam_ensemble.hxx"
+#include "../include/output_writer.hxx"
 
 #define FAILURE 0
 #define VERBOSITY 1
@@ -417,6 +421,12 @@ int main(int argc, char *argv[])
     double *var_ptr = static_cast<double*>(model.GetValuePtr(var_name));
     std::cout<<" Get value ptr: "<<*var_ptr<<"\n";
 
+    //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++/
+    // Test variable handles (same storage as the name based access)
+    int handle = model.GetVarHandle(var_name);
+    test_status &= (handle >= 0) && (model.GetValuePtrByHandle(handle) == var_ptr);
+    std::cout<<" Get value ptr by handle ("<<handle<<"): "<<*static_cast<double*>(model.GetValuePtrByHandle(handle))<<"\n";
+
     //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++/
     // Test BMI set_value_at_indices()
     double dest_new = 0.0;
@@ -899,5 +909,1059 @@ int main(int argc, char *argv[])
   model_calib.Update();
   
   model_calib.Finalize();
+
+  // UpdateUntil over a forcing series supplied in advance must give the same states as stepping with Update, and the
+  // output fluxes accumulated over the span
+  BmiLGAR model_step, model_span;
+  model_step.Initialize(argv[1]);
+  model_span.Initialize(argv[1]);
+
+  const int num_span_steps = 6;
+  // the unittest config ends after the first forcing timestep, extend it so that the span covers several timesteps
+  model_step.get_model()->lgar_bmi_params.endtime_s = num_span_steps * model_step.GetTimeStep();
+  model_span.get_model()->lgar_bmi_params.endtime_s = num_span_steps * model_span.GetTimeStep();
+
+  double precip_series[num_span_steps] = {0.0, 2.5, 6.0, 0.4, 0.0, 0.0}; // mm/hr
+  double PET_series[num_span_steps]    = {0.1, 0.0, 0.0, 0.2, 0.3, 0.3}; // mm/hr
+  double AET_step_m = 0.0, infiltration_step_m = 0.0;
+
+  for (int i=0; i<num_span_steps; i++) {
+    double value = 0.0;
+    model_step.SetValue("precipitation_rate", &precip_series[i]);
+    model_step.SetValue("potential_evapotranspiration_rate", &PET_series[i]);
+    model_step.Update();
+    model_step.GetValue("actual_evapotranspiration", &value);
+    AET_step_m += value;
+    model_step.GetValue("infiltration", &value);
+    infiltration_step_m += value;
+  }
+
+  // the span model reads the same forcing from an interleaved (time, precip, PET) table through strides
+  double forcing_table[3 * num_span_steps];
+  for (int i=0; i<num_span_steps; i++) {
+    forcing_table[3*i]   = i * model_span.GetTimeStep();
+    forcing_table[3*i+1] = precip_series[i];
+    forcing_table[3*i+2] = PET_series[i];
+  }
+  model_span.SetForcingSeries(&forcing_table[1], &forcing_table[2], num_span_steps, 3, 3);
+
+  // the wetting front outputs are allocated once, pointers taken before the run must stay valid
+  void *theta_wf_ptr = model_span.GetValuePtr("soil_moisture_wetting_fronts");
+  void *depth_wf_ptr = model_span.GetValuePtr("soil_depth_wetting_fronts");
+  model_span.UpdateUntil(model_span.GetCurrentTime() + num_span_steps * model_span.GetTimeStep());
+
+  double AET_span_m = 0.0, infiltration_span_m = 0.0, storage_step_m = 0.0, storage_span_m = 0.0;
+  model_span.GetValue("actual_evapotranspiration", &AET_span_m);
+  model_span.GetValue("infiltration", &infiltration_span_m);
+  model_step.GetValue("soil_storage", &storage_step_m);
+  model_span.GetValue("soil_storage", &storage_span_m);
+
+  int num_wf_step = model_step.get_model()->lgar_bmi_params.num_wetting_fronts;
+  int num_wf_span = model_span.get_model()->lgar_bmi_params.num_wetting_fronts;
+  bool span_status = (model_span.GetForcingSeriesRemaining() == 0) && (num_wf_step == num_wf_span)
+    && theta_wf_ptr == model_span.GetValuePtr("soil_moisture_wetting_fronts")
+    && depth_wf_ptr == model_span.GetValuePtr("soil_depth_wetting_fronts") && (model_step.GetCurrentTime() == model_span.GetCurrentTime())
+    && fabs(AET_step_m - AET_span_m) < 1.E-12 && fabs(infiltration_step_m - infiltration_span_m) < 1.E-12
+    && fabs(storage_step_m - storage_span_m) < 1.E-12;
+
+  if (num_wf_step == num_wf_span) {
+    std::vector<double> depth_step(num_wf_step), depth_span(num_wf_span);
+    model_step.GetValue("soil_depth_wetting_fronts", depth_step.data());
+    model_span.GetValue("soil_depth_wetting_fronts", depth_span.data());
+    for (int k=0; k<num_wf_step; k++)
+      span_status &= fabs(depth_step[k] - depth_span[k]) < 1.E-12;
+  }
+
+  std::cout<<GREEN<<"\n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<"| UpdateUntil test \n";
+  std::cout<<"| AET [mm]          : (Update vs UpdateUntil) | "<< AET_step_m * m_to_mm <<" vs "<< AET_span_m * m_to_mm <<"\n";
+  std::cout<<"| Infiltration [mm] : (Update vs UpdateUntil) | "<< infiltration_step_m * m_to_mm <<" vs "<< infiltration_span_m * m_to_mm <<"\n";
+  std::cout<<"| UpdateUntil test passed? "<< (span_status ? "YES" : "NO") <<" \n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<RESET<<"\n";
+
+  model_step.Finalize();
+  model_span.Finalize();
+
+  if (!span_status) {
+    std::stringstream errMsg;
+    errMsg << "UpdateUntil over a forcing series does not match stepping with Update. \n";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  // two instances running Update concurrently on different threads must give the same results as running them one
+  // after the other (the model keeps no shared mutable state)
+  const int num_thread_steps = 48;
+  std::vector<std::vector<double>> thread_precip(2, std::vector<double>(num_thread_steps));
+  std::vector<std::vector<double>> thread_PET(2, std::vector<double>(num_thread_steps));
+  for (int i=0; i<num_thread_steps; i++) {
+    thread_precip[0][i] = (i % 12 < 3) ? 4.0 : 0.0;
+    thread_precip[1][i] = (i % 8 == 0) ? 10.0 : 0.0;
+    thread_PET[0][i]    = 0.2;
+    thread_PET[1][i]    = 0.4;
+  }
+
+  auto run_instance = [&](BmiLGAR *instance, int series, double *AET_m, double *storage_m) {
+    instance->SetForcingSeries(thread_precip[series].data(), thread_PET[series].data(), num_thread_steps);
+    *AET_m = 0.0;
+    for (int i=0; i<num_thread_steps; i++) {
+      double value = 0.0;
+      instance->Update();
+      instance->GetValue("actual_evapotranspiration", &value);
+      *AET_m += value;
+    }
+    instance->GetValue("soil_storage", storage_m);
+  };
+
+  BmiLGAR model_seq[2], model_thr[2];
+  double AET_seq_m[2], AET_thr_m[2], storage_seq_m[2], storage_thr_m[2];
+  for (int k=0; k<2; k++) {
+    model_seq[k].Initialize(argv[1]);
+    model_thr[k].Initialize(argv[1]);
+    model_seq[k].get_model()->lgar_bmi_params.endtime_s = num_thread_steps * model_seq[k].GetTimeStep();
+    model_thr[k].get_model()->lgar_bmi_params.endtime_s = num_thread_steps * model_thr[k].GetTimeStep();
+    run_instance(&model_seq[k], k, &AET_seq_m[k], &storage_seq_m[k]);
+  }
+
+  std::thread worker(run_instance, &model_thr[1], 1, &AET_thr_m[1], &storage_thr_m[1]);
+  run_instance(&model_thr[0], 0, &AET_thr_m[0], &storage_thr_m[0]);
+  worker.join();
+
+  bool thread_status = true;
+  for (int k=0; k<2; k++)
+    thread_status &= (AET_seq_m[k] == AET_thr_m[k]) && (storage_seq_m[k] == storage_thr_m[k])
+      && (model_seq[k].get_model()->lgar_bmi_params.num_wetting_fronts == model_thr[k].get_model()->lgar_bmi_params.num_wetting_fronts);
+
+  std::cout<<GREEN<<"\n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<"| Concurrent instances test \n";
+  for (int k=0; k<2; k++)
+    std::cout<<"| Instance "<< k <<" AET [mm] : (sequential vs threaded) | "<< AET_seq_m[k] * m_to_mm <<" vs "<< AET_thr_m[k] * m_to_mm <<"\n";
+  std::cout<<"| Concurrent instances test passed? "<< (thread_status ? "YES" : "NO") <<" \n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<RESET<<"\n";
+
+  for (int k=0; k<2; k++) {
+    model_seq[k].Finalize();
+    model_thr[k].Finalize();
+  }
+
+  if (!thread_status) {
+    std::stringstream errMsg;
+    errMsg << "Instances running concurrently on different threads do not match the sequential runs. \n";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  // the ensemble runner must give the same results for any number of threads; the catchments take different parts of
+  // the forcing file so that their costs differ
+  const int num_catchments = 6, num_ensemble_steps = 96;
+  struct forcing_data forcing;
+  ReadForcingData(argv[1], &forcing);
+  std::vector<double> &forcing_precip = forcing.precipitation_mm_per_h;
+  std::vector<double> &forcing_PET = forcing.PET_mm_per_h;
+
+  std::vector<double> ensemble_storage_m[2];
+  long ensemble_steals = 0;
+  int thread_counts[2] = {1, 4};
+  for (int run=0; run<2; run++) {
+    LasamEnsemble ensemble(thread_counts[run]);
+    for (int k=0; k<num_catchments; k++) {
+      int c = ensemble.AddCatchment(argv[1], false);
+      BmiLGAR *catchment = ensemble.GetCatchment(c);
+      catchment->get_model()->lgar_bmi_params.endtime_s = num_ensemble_steps * catchment->GetTimeStep();
+      int offset = (1000 * k) % ((int)forcing_precip.size() - num_ensemble_steps);
+      catchment->SetForcingSeries(&forcing_precip[offset], &forcing_PET[offset], num_ensemble_steps);
+    }
+
+    // advance in chunks of a day, the later chunks are scheduled with the costs measured in the earlier ones
+    double dt = ensemble.GetCatchment(0)->GetTimeStep();
+    for (int day=1; day<=num_ensemble_steps/24; day++)
+      ensemble.UpdateUntil(day * 24 * dt);
+
+    for (int k=0; k<num_catchments; k++) {
+      double storage_m = 0.0;
+      ensemble.GetCatchment(k)->GetValue("soil_storage", &storage_m);
+      ensemble_storage_m[run].push_back(storage_m);
+      ensemble_storage_m[run].push_back(ensemble.GetCatchment(k)->get_model()->lgar_mass_balance.volAET_cm);
+      ensemble_storage_m[run].push_back(ensemble.GetCatchment(k)->get_model()->lgar_mass_balance.volrunoff_cm);
+    }
+    if (run == 1)
+      ensemble_steals = ensemble.GetNumSteals();
+  }
+
+  bool ensemble_status = (ensemble_storage_m[0] == ensemble_storage_m[1]);
+
+  std::cout<<GREEN<<"\n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<"| Ensemble test ("<< num_catchments <<" catchments, 1 vs 4 threads, "<< ensemble_steals <<" steals) \n";
+  std::cout<<"| Ensemble test passed? "<< (ensemble_status ? "YES" : "NO") <<" \n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<RESET<<"\n";
+
+  if (!ensemble_status) {
+    std::stringstream errMsg;
+    errMsg << "The ensemble results depend on the number of threads. \n";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  // a parameter ensemble (shared forcing, recorded outputs) must match a model with the same parameters run on its own
+  const int num_members = 3, num_member_steps = 120;
+  std::vector<std::string> member_names = {"smcmax_1", "van_genuchten_n_1", "hydraulic_conductivity_1"};
+  std::vector<std::vector<double>> member_sets = {{0.3513, 1.4426, 0.446}, {0.40, 1.25, 0.10}, {0.45, 1.60, 1.20}};
+
+  LasamEnsemble members(2);
+  members.AddParameterEnsemble(argv[1], member_names, member_sets);
+  for (int k=0; k<num_members; k++)
+    members.GetCatchment(k)->get_model()->lgar_bmi_params.endtime_s = num_member_steps * members.GetCatchment(k)->GetTimeStep();
+  members.RecordOutputs({"actual_evapotranspiration", "total_discharge"});
+  members.UpdateUntil(num_member_steps * members.GetCatchment(0)->GetTimeStep());
+
+  BmiLGAR model_member;
+  model_member.Initialize(argv[1]);
+  model_member.get_model()->lgar_bmi_params.endtime_s = num_member_steps * model_member.GetTimeStep();
+  for (size_t i=0; i<member_names.size(); i++)
+    model_member.SetValue(member_names[i], &member_sets[1][i]);
+  model_member.SetForcingSeries(forcing_precip.data(), forcing_PET.data(), (int)forcing_precip.size());
+
+  std::vector<double> member_AET_m;
+  double member_Q_m = 0.0;
+  for (int i=0; i<num_member_steps; i++) {
+    double value = 0.0;
+    model_member.Update();
+    model_member.GetValue("actual_evapotranspiration", &value);
+    member_AET_m.push_back(value);
+    model_member.GetValue("total_discharge", &value);
+    member_Q_m += value;
+  }
+
+  bool members_status = (members.GetRecordedSeries(1, "actual_evapotranspiration") == member_AET_m)
+    && (members.GetRecordedSum(1, "total_discharge") == member_Q_m)
+    && (members.GetRecordedSum(0, "actual_evapotranspiration") != members.GetRecordedSum(2, "actual_evapotranspiration"));
+
+  std::cout<<GREEN<<"\n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<"| Parameter ensemble test \n";
+  for (int k=0; k<num_members; k++)
+    std::cout<<"| Member "<< k <<" AET [mm] : "<< members.GetRecordedSum(k, "actual_evapotranspiration") * m_to_mm <<"\n";
+  std::cout<<"| Parameter ensemble test passed? "<< (members_status ? "YES" : "NO") <<" \n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<RESET<<"\n";
+
+  members.Finalize();
+  model_member.Finalize();
+
+  if (!members_status) {
+    std::stringstream errMsg;
+    errMsg << "The parameter ensemble members do not match models run on their own. \n";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  // a model restored from a checkpoint (through the BMI serialization variables) must continue exactly as the model
+  // that wrote it
+  const int num_checkpoint_steps = 48, checkpoint_offset = 2000;
+  BmiLGAR model_saved, model_restored;
+  model_saved.Initialize(argv[1]);
+  model_restored.Initialize(argv[1]);
+  model_saved.get_model()->lgar_bmi_params.endtime_s = num_checkpoint_steps * model_saved.GetTimeStep();
+  model_restored.get_model()->lgar_bmi_params.endtime_s = num_checkpoint_steps * model_restored.GetTimeStep();
+
+  model_saved.SetForcingSeries(&forcing_precip[checkpoint_offset], &forcing_PET[checkpoint_offset], num_checkpoint_steps);
+  model_saved.UpdateUntil(num_checkpoint_steps / 2 * model_saved.GetTimeStep());
+
+  int serialization_request = 1, serialization_size = 0;
+  model_saved.SetValue("serialization_create", &serialization_request);
+  model_saved.GetValue("serialization_size", &serialization_size);
+  std::vector<char> checkpoint((char*)model_saved.GetValuePtr("serialization_state"),
+			       (char*)model_saved.GetValuePtr("serialization_state") + serialization_size);
+  model_saved.SetValue("serialization_free", &serialization_request);
+  int num_fronts_checkpoint = model_saved.get_model()->lgar_bmi_params.num_wetting_fronts;
+
+  model_restored.SetValue("serialization_state", checkpoint.data());
+  bool checkpoint_status = (model_restored.GetCurrentTime() == model_saved.GetCurrentTime())
+    && (model_saved.GetVarType("serialization_state") == "char") && (model_saved.GetVarNbytes("serialization_state") == 0);
+
+  model_saved.UpdateUntil(num_checkpoint_steps * model_saved.GetTimeStep());
+  model_restored.SetForcingSeries(&forcing_precip[checkpoint_offset + num_checkpoint_steps / 2],
+				  &forcing_PET[checkpoint_offset + num_checkpoint_steps / 2], num_checkpoint_steps / 2);
+  model_restored.UpdateUntil(num_checkpoint_steps * model_restored.GetTimeStep());
+
+  struct lgar_mass_balance_variables *mb_saved = &model_saved.get_model()->lgar_mass_balance;
+  struct lgar_mass_balance_variables *mb_restored = &model_restored.get_model()->lgar_mass_balance;
+  int num_fronts_saved = model_saved.get_model()->lgar_bmi_params.num_wetting_fronts;
+  checkpoint_status &= (mb_saved->volAET_cm == mb_restored->volAET_cm) && (mb_saved->volin_cm == mb_restored->volin_cm)
+    && (mb_saved->volrunoff_giuh_cm == mb_restored->volrunoff_giuh_cm)
+    && (num_fronts_saved == model_restored.get_model()->lgar_bmi_params.num_wetting_fronts)
+    && std::equal(model_saved.get_model()->lgar_bmi_params.soil_moisture_wetting_fronts,
+		  model_saved.get_model()->lgar_bmi_params.soil_moisture_wetting_fronts + num_fronts_saved,
+		  model_restored.get_model()->lgar_bmi_params.soil_moisture_wetting_fronts);
+
+  // a corrupted checkpoint is rejected, and a checkpoint whose last field (the wetting front speeds) has a wrong size
+  // leaves the model it was restored into unchanged
+  std::vector<char> bad_field_checkpoint = checkpoint, state_before, state_after;
+  uint32_t last_field_nbytes = num_fronts_checkpoint * sizeof(double) + 1;
+  memcpy(&bad_field_checkpoint[bad_field_checkpoint.size() - num_fronts_checkpoint * sizeof(double) - sizeof(uint32_t)],
+	 &last_field_nbytes, sizeof(uint32_t));
+  model_restored.SaveState(state_before);
+
+  int corrupted_rejected = 0;
+  checkpoint[0] = 'X';
+  for (std::vector<char> *corrupted : {&checkpoint, &bad_field_checkpoint}) {
+    try {
+      model_restored.RestoreState(corrupted->data(), corrupted->size());
+    }
+    catch (const std::runtime_error &) {
+      corrupted_rejected++;
+    }
+  }
+  model_restored.SaveState(state_after);
+  checkpoint_status &= (corrupted_rejected == 2) && (state_before == state_after)
+    && (model_restored.GetCurrentTime() == model_saved.GetCurrentTime());
+
+  std::cout<<GREEN<<"\n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<"| Checkpoint test ("<< serialization_size <<" bytes) \n";
+  std::cout<<"| AET [cm] : (continued vs restored) | "<< mb_saved->volAET_cm <<" vs "<< mb_restored->volAET_cm <<"\n";
+  std::cout<<"| Checkpoint test passed? "<< (checkpoint_status ? "YES" : "NO") <<" \n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<RESET<<"\n";
+
+  model_saved.Finalize();
+  model_restored.Finalize();
+
+  if (!checkpoint_status) {
+    std::stringstream errMsg;
+    errMsg << "The model restored from a checkpoint does not continue as the model that wrote it. \n";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  // the forcing reader must give the values of a line-by-line stod parse of the forcing file, and the time stamps must
+  // format back to the strings of the file
+  std::ifstream forcing_file(GetForcingFile(argv[1]));
+  std::vector<std::string> reference_time;
+  std::vector<double> reference_precip, reference_PET;
+  std::string forcing_line;
+  std::getline(forcing_file, forcing_line); // header
+  while (std::getline(forcing_file, forcing_line)) {
+    std::stringstream line_stream(forcing_line);
+    std::string cell;
+    std::getline(line_stream, cell, ',');
+    reference_time.push_back(cell);
+    std::getline(line_stream, cell, ',');
+    reference_precip.push_back(stod(cell));
+    std::getline(line_stream, cell, ',');
+    reference_PET.push_back(stod(cell));
+  }
+
+  bool forcing_status = (forcing.time_s.size() == reference_time.size());
+  int forcing_mismatches = 0;
+  for (size_t i=0; i<reference_time.size() && forcing_status; i++) {
+    if (forcing_precip[i] != reference_precip[i] || forcing_PET[i] != reference_PET[i]
+	|| forcing_time_string(forcing.time_s[i]) != reference_time[i])
+      forcing_mismatches++;
+  }
+  forcing_status = forcing_status && forcing_mismatches == 0 && forcing_time_string(forcing.time_s[0]) == "2016-10-01 00:00:00";
+
+  std::cout<<GREEN<<"\n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<"| Forcing reader test ("<< forcing.time_s.size() <<" rows, first "<< forcing_time_string(forcing.time_s[0]) <<") \n";
+  std::cout<<"| Forcing reader test passed? "<< (forcing_status ? "YES" : "NO") <<" \n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<RESET<<"\n";
+
+  if (!forcing_status) {
+    std::stringstream errMsg;
+    errMsg << "The forcing reader does not match a line-by-line parse of the forcing file (" << forcing_mismatches
+	   << " rows differ). \n";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  // a binary forcing file is mapped with the values and time stamps of the csv file it was converted from; forcing with
+  // a gap or a negative rate is rejected at conversion, a truncated binary file at load
+  std::string binary_forcing_file = "forcing_unittest.bin";
+  WriteBinaryForcingFile(binary_forcing_file, &forcing);
+  struct forcing_series mapped;
+  OpenForcingSeries(binary_forcing_file, &mapped);
+
+  bool binary_status = IsBinaryForcingFile(binary_forcing_file) && mapped.time_s == NULL
+    && mapped.num_steps == (long)forcing.time_s.size() && mapped.timestep_s == 3600.0;
+  for (long i=0; i<mapped.num_steps && binary_status; i++)
+    binary_status = mapped.precipitation_mm_per_h[i] == forcing_precip[i] && mapped.PET_mm_per_h[i] == forcing_PET[i]
+      && forcing_series_time(&mapped, i) == forcing.time_s[i];
+  CloseForcingSeries(&mapped);
+
+  int invalid_rejected = 0;
+  struct forcing_data invalid_forcing[2] = {forcing, forcing};
+  invalid_forcing[0].time_s[100] += 3600.0;
+  invalid_forcing[1].PET_mm_per_h[100] = -0.1;
+  for (int k=0; k<2; k++) {
+    try {
+      WriteBinaryForcingFile(binary_forcing_file, &invalid_forcing[k]);
+    }
+    catch (const std::runtime_error &) {
+      invalid_rejected++;
+    }
+  }
+
+  FILE *binary_fp = fopen(binary_forcing_file.c_str(), "wb");
+  fwrite("LASAMFRC", 1, 8, binary_fp);
+  fclose(binary_fp);
+  try {
+    OpenForcingSeries(binary_forcing_file, &mapped);
+  }
+  catch (const std::runtime_error &) {
+    invalid_rejected++;
+  }
+
+  // a header whose entry count wraps the expected byte size back to the true file size (num_steps at byte 16)
+  WriteBinaryForcingFile(binary_forcing_file, &forcing);
+  uint64_t wrapped_num_steps = (uint64_t)forcing.time_s.size() + ((uint64_t)1 << 60);
+  binary_fp = fopen(binary_forcing_file.c_str(), "r+b");
+  fseek(binary_fp, 16, SEEK_SET);
+  fwrite(&wrapped_num_steps, sizeof(wrapped_num_steps), 1, binary_fp);
+  fclose(binary_fp);
+  try {
+    OpenForcingSeries(binary_forcing_file, &mapped);
+    CloseForcingSeries(&mapped);
+  }
+  catch (const std::runtime_error &) {
+    invalid_rejected++;
+  }
+  remove(binary_forcing_file.c_str());
+  binary_status &= (invalid_rejected == 4);
+
+  std::cout<<GREEN<<"\n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<"| Binary forcing test ("<< invalid_rejected <<" of 4 invalid files rejected) \n";
+  std::cout<<"| Binary forcing test passed? "<< (binary_status ? "YES" : "NO") <<" \n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<RESET<<"\n";
+
+  if (!binary_status) {
+    std::stringstream errMsg;
+    errMsg << "The binary forcing file does not match the csv forcing file it was converted from. \n";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  // format_fixed must give the printf digits (rounding ties to even, e.g. 1/65536 and 1/128, negative zero, values
+  // rounding to zero), and the output writer the files of fprintf, also when the ring (4 rows here) is full
+  std::vector<double> format_values = {0.0, -0.0, 1.0 / 65536, 3.0 / 65536, 1.0 / 128, -3.0 / 128, 0.5, 2.5, -1e-20,
+				       123456.789, 1e19, 3e19, 9.99e19, 5e-7, -4e-16, std::nan(""), INFINITY, 1e300};
+  unsigned long long random_bits = 88172645463325252ULL;
+  for (int k=0; k<20000; k++) {
+    random_bits ^= random_bits << 13;
+    random_bits ^= random_bits >> 7;
+    random_bits ^= random_bits << 17;
+    double mantissa = (double)(random_bits >> 11) / (double)(1ULL << 53);
+    format_values.push_back((k % 2 ? -1.0 : 1.0) * ldexp(mantissa, (int)(random_bits % 100) - 60));
+  }
+
+  int format_mismatches = 0;
+  for (double value : format_values) {
+    for (int precision : {6, 15}) {
+      char fast[400], reference[400];
+      *format_fixed(fast, value, precision) = '\0';
+      snprintf(reference, sizeof(reference), "%.*f", precision, value);
+      format_mismatches += (strcmp(fast, reference) != 0);
+    }
+  }
+
+  struct wetting_front output_fronts[3];
+  for (int k=0; k<3; k++) {
+    output_fronts[k].depth_cm  = 12.3456789 * (k + 1);
+    output_fronts[k].theta     = 0.1 + 0.05 * k;
+    output_fronts[k].psi_cm    = -1234.5678 / (k + 1);
+    output_fronts[k].layer_num = k + 1;
+    output_fronts[k].front_num = k + 1;
+    output_fronts[k].next      = (k < 2) ? &output_fronts[k+1] : NULL;
+  }
+
+  std::vector<std::string> output_names = {"a", "b", "c"};
+  std::string reference_variables = "Time,a,b,c\n", reference_layers;
+  {
+    OutputWriter output_writer("output_unittest_variables.csv", "output_unittest_layers.csv", output_names, OUTPUT_TEXT, 4);
+    char line[512];
+    for (int i=0; i<50; i++) {
+      double values[3] = {format_values[3 * i + 18], format_values[3 * i + 19], i * 0.1};
+      double time_s = forcing.time_s[i];
+      output_fronts[0].depth_cm = 1.5 * i;
+      output_writer.WriteStep(i, time_s, values, time_s, i % 3 ? output_fronts : &output_fronts[2]);
+
+      snprintf(line, sizeof(line), "%s,%6.15f,%6.15f,%6.15f\n", forcing_time_string(time_s).c_str(), values[0], values[1],
+	       values[2]);
+      reference_variables += line;
+      snprintf(line, sizeof(line), "# Timestep = %d, %s \n[", i, forcing_time_string(time_s).c_str());
+      reference_layers += line;
+      for (struct wetting_front *current = i % 3 ? output_fronts : &output_fronts[2]; current; current = current->next) {
+	snprintf(line, sizeof(line), "%s(%lf,%lf,%d,%d,%lf)", current == output_fronts || (i % 3 == 0) ? "" : "|",
+		 current->depth_cm * 10., current->theta, current->layer_num, current->front_num, current->psi_cm * 10.);
+	reference_layers += line;
+      }
+      reference_layers += "]\n";
+    }
+    output_writer.Close();
+  }
+
+  std::ifstream variables_output("output_unittest_variables.csv"), layers_output("output_unittest_layers.csv");
+  std::string written_variables((std::istreambuf_iterator<char>(variables_output)), std::istreambuf_iterator<char>());
+  std::string written_layers((std::istreambuf_iterator<char>(layers_output)), std::istreambuf_iterator<char>());
+  remove("output_unittest_variables.csv");
+  remove("output_unittest_layers.csv");
+
+  bool output_status = (format_mismatches == 0) && written_variables == reference_variables
+    && written_layers == reference_layers;
+
+  std::cout<<GREEN<<"\n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<"| Output writer test ("<< format_values.size() <<" values, "<< format_mismatches <<" formatted differently) \n";
+  std::cout<<"| Output writer test passed? "<< (output_status ? "YES" : "NO") <<" \n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<RESET<<"\n";
+
+  if (!output_status) {
+    std::stringstream errMsg;
+    errMsg << "The output writer does not write the fprintf output. \n";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  // output options of the standalone driver: defaults without output_* keys, and the keys of a daily output of
+  // discharge and storage without the layers file
+  struct output_config default_output, daily_output;
+  ReadOutputConfig(argv[1], 3600.0, &default_output);
+
+  std::ofstream output_config_file("output_unittest_config.txt");
+  output_config_file << "output_variables=total_discharge:sum,soil_storage\n" << "output_interval=1[d]\n"
+		     << "output_aggregation=last\n" << "output_layers=false\n";
+  output_config_file.close();
+  ReadOutputConfig("output_unittest_config.txt", 3600.0, &daily_output);
+  remove("output_unittest_config.txt");
+
+  bool output_config_status = default_output.variable_names.size() == 11 && default_output.interval_steps == 1
+    && default_output.write_layers && default_output.layers_interval_steps == 1
+    && default_output.aggregation[0] == AGGREGATE_MEAN
+    && daily_output.variable_names == std::vector<std::string>({"total_discharge", "soil_storage"})
+    && daily_output.aggregation[0] == AGGREGATE_SUM && daily_output.aggregation[1] == AGGREGATE_LAST
+    && daily_output.interval_steps == 24 && !daily_output.write_layers;
+
+  std::cout<<GREEN<<"\n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<"| Output options test passed? "<< (output_config_status ? "YES" : "NO") <<" \n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<RESET<<"\n";
+
+  if (!output_config_status) {
+    std::stringstream errMsg;
+    errMsg << "The output options are not read from the config file as expected. \n";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  // with the soil freeze-thaw coupling, the frozen factor of a layer scales the Ksat of that layer only: the
+  // infiltration capacity of a free drainage front in the second layer under a thawed surface layer is that of unfrozen
+  // soils with their Ksat scaled by the frozen factors
+  BmiLGAR model_frozen, model_thawed;
+  model_frozen.Initialize(argv[1]);
+  model_thawed.Initialize(argv[1]);
+  struct model_state *frozen_states[2] = {model_frozen.get_model(), model_thawed.get_model()};
+  double frozen_factors[4] = {1.0, 1.0, 0.1, 0.5};
+
+  for (int layer=1; layer<=frozen_states[0]->lgar_bmi_params.num_layers; layer++) {
+    frozen_states[0]->lgar_bmi_params.frozen_factor[layer] = frozen_factors[layer];
+    frozen_states[1]->soil_properties[frozen_states[1]->lgar_bmi_params.layer_soil_type[layer]].Ksat_cm_per_h *= frozen_factors[layer];
+  }
+
+  // fronts 1-2 in the surface layer, the free drainage front 3 in the second layer
+  struct wetting_front frozen_fronts[5];
+  double frozen_depths_cm[5] = {20.0, 44.0, 60.0, 175.0, 200.0};
+  double frozen_thetas[5]    = {0.30, 0.20, 0.28, 0.15, 0.15};
+  int frozen_layers[5]       = {1, 1, 2, 2, 3};
+  for (int k=0; k<5; k++) {
+    frozen_fronts[k].depth_cm  = frozen_depths_cm[k];
+    frozen_fronts[k].theta     = frozen_thetas[k];
+    frozen_fronts[k].layer_num = frozen_layers[k];
+    frozen_fronts[k].front_num = k + 1;
+    frozen_fronts[k].to_bottom = (k != 0 && k != 2);
+    frozen_fronts[k].next      = (k < 4) ? &frozen_fronts[k+1] : NULL;
+  }
+
+  double frozen_infiltration_cm[2];
+  for (int k=0; k<2; k++) {
+    struct model_state *s = frozen_states[k];
+    lgar_update_derived_constants(&s->lgar_bmi_params, s->soil_properties, &s->derived);
+    double ponded_depth_cm = 10.0, volin_cm = 0.0;
+    lgar_insert_water(s->lgar_bmi_params.use_closed_form_G, s->lgar_bmi_params.nint, &s->Geff_quadrature,
+		      s->lgar_bmi_params.timestep_h, 0.0, 0.0, &ponded_depth_cm, &volin_cm, 0.0, 3,
+		      s->lgar_bmi_params.num_layers, 0.0, s->lgar_bmi_params.layer_soil_type,
+		      s->lgar_bmi_params.cum_layer_thickness_cm, &s->derived, frozen_fronts, s->soil_properties);
+    frozen_infiltration_cm[k] = volin_cm;
+  }
+
+  bool frozen_status = frozen_infiltration_cm[0] > 0.0 && frozen_infiltration_cm[0] < 10.0
+    && fabs(frozen_infiltration_cm[0] - frozen_infiltration_cm[1]) <= 1e-12 * frozen_infiltration_cm[1];
+
+  std::cout<<GREEN<<"\n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<"| Frozen soil infiltration [cm] : (frozen factors vs scaled Ksat) | "<< frozen_infiltration_cm[0] <<" vs "
+	   << frozen_infiltration_cm[1] <<"\n";
+  std::cout<<"| Frozen soil test passed? "<< (frozen_status ? "YES" : "NO") <<" \n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<RESET<<"\n";
+
+  model_frozen.Finalize();
+  model_thawed.Finalize();
+
+  if (!frozen_status) {
+    std::stringstream errMsg;
+    errMsg << "The frozen factor of a layer does not scale the Ksat of that layer in the infiltration capacity. \n";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  // error control of the adaptive timestep: the error of a substep is the larger of the mass balance error and the
+  // trapezoid vs Euler displacement of each front not at a layer bottom, relative to the tolerances; a substep with an
+  // error above 1 is rejected and retried with a smaller size, an accepted one proposes a larger next size
+  struct wetting_front substep_fronts[3];
+  static struct wetting_front_store substep_start;
+  for (int k=0; k<3; k++) {
+    substep_fronts[k].depth_cm      = 10.0 * (k + 1);
+    substep_fronts[k].theta         = 0.3 - 0.05 * k;
+    substep_fronts[k].layer_num     = 1;
+    substep_fronts[k].front_num     = k + 1;
+    substep_fronts[k].to_bottom     = (k == 1);
+    substep_fronts[k].dzdt_cm_per_h = 2.0 * (k + 1);
+    substep_fronts[k].next          = (k < 2) ? &substep_fronts[k+1] : NULL;
+  }
+  storeFromList(substep_fronts, &substep_start);
+
+  const double substep_h = 0.25, substep_front_tol_cm = 0.1, substep_mbal_tol_cm = 1.0e-4;
+  const double substep_min_h = 1.0 / 3600.0, substep_max_h = 0.75;
+
+  substep_fronts[0].dzdt_cm_per_h += 2.0;   // 0.5 * 0.25 h * 2 cm/h = 0.25 cm, 2.5 times the tolerance
+  substep_fronts[1].dzdt_cm_per_h += 100.0; // at the layer bottom, not an error indicator
+  double rejected_error = lgar_substep_error(&substep_start, substep_fronts, substep_h, 0.0, substep_front_tol_cm,
+					     substep_mbal_tol_cm);
+  double rejected_next_h = lgar_substep_next_size(substep_h, rejected_error, substep_min_h, substep_max_h);
+
+  substep_fronts[0].dzdt_cm_per_h = 2.0;
+  substep_fronts[2].dzdt_cm_per_h += 0.4;   // 0.5 times the tolerance
+  double accepted_error = lgar_substep_error(&substep_start, substep_fronts, substep_h, 0.2e-4, substep_front_tol_cm,
+					     substep_mbal_tol_cm);
+  double accepted_next_h = lgar_substep_next_size(substep_h, accepted_error, substep_min_h, substep_max_h);
+
+  // a substep that created or removed fronts is judged by its mass balance error only
+  substep_fronts[1].next = NULL;
+  double mbal_error = lgar_substep_error(&substep_start, substep_fronts, substep_h, 3.0e-4, substep_front_tol_cm,
+					 substep_mbal_tol_cm);
+
+  bool substep_status = fabs(rejected_error - 2.5) < 1e-12 && rejected_next_h < substep_h
+    && rejected_next_h >= 0.25 * substep_h && fabs(accepted_error - 0.5) < 1e-12 && accepted_next_h > substep_h
+    && fabs(mbal_error - 3.0) < 1e-12
+    && lgar_substep_next_size(substep_h, 0.0, substep_min_h, substep_max_h) == 2.0 * substep_h
+    && lgar_substep_next_size(0.5, 0.0, substep_min_h, substep_max_h) == substep_max_h
+    && lgar_substep_next_size(substep_min_h, INFINITY, substep_min_h, substep_max_h) == substep_min_h;
+
+  std::cout<<GREEN<<"\n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<"| Substep error control : (rejected, accepted) error | "<< rejected_error <<", "<< accepted_error
+	   <<" ; next substep [s] | "<< rejected_next_h * 3600 <<", "<< accepted_next_h * 3600 <<"\n";
+  std::cout<<"| Substep error control test passed? "<< (substep_status ? "YES" : "NO") <<" \n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<RESET<<"\n";
+
+  if (!substep_status) {
+    std::stringstream errMsg;
+    errMsg << "The substep error control does not reject and resize substeps as expected. \n";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  // fast-forwarded flux caching (flux_caching_method=fast_forward) must fast-forward the dry steps of the forcing file
+  // and stay within 0.3% of a run without flux caching
+  std::ifstream unittest_config(argv[1]);
+  std::ofstream fast_forward_config("fast_forward_unittest_config.txt");
+  fast_forward_config << unittest_config.rdbuf() << "\nallow_flux_caching=true\n" << "flux_caching_method=fast_forward\n";
+  fast_forward_config.close();
+
+  const int num_fast_forward_steps = (int)forcing_precip.size();
+  BmiLGAR model_uncached, model_fast_forward;
+  model_uncached.Initialize(argv[1]);
+  model_fast_forward.Initialize("fast_forward_unittest_config.txt");
+  remove("fast_forward_unittest_config.txt");
+
+  BmiLGAR *fast_forward_models[2] = {&model_uncached, &model_fast_forward};
+  for (BmiLGAR *m : fast_forward_models) {
+    m->get_model()->lgar_bmi_params.endtime_s = num_fast_forward_steps * m->GetTimeStep();
+    m->SetForcingSeries(forcing_precip.data(), forcing_PET.data(), num_fast_forward_steps);
+    m->UpdateUntil(num_fast_forward_steps * m->GetTimeStep());
+  }
+
+  struct lgar_mass_balance_variables *mb_uncached = &model_uncached.get_model()->lgar_mass_balance;
+  struct lgar_mass_balance_variables *mb_fast_forward = &model_fast_forward.get_model()->lgar_mass_balance;
+  auto within_tolerance = [](double value, double reference) {
+    return fabs(value - reference) <= 0.003 * fabs(reference);
+  };
+  long num_fast_forwarded = model_fast_forward.get_model()->flux_caching.num_cached_steps;
+
+  bool fast_forward_status = model_fast_forward.get_model()->lgar_bmi_params.flux_caching_fast_forward
+    && num_fast_forwarded > 0 && model_uncached.get_model()->flux_caching.num_cached_steps == 0
+    && mb_uncached->volprecip_cm > 0.0
+    && within_tolerance(mb_fast_forward->volAET_cm, mb_uncached->volAET_cm)
+    && within_tolerance(mb_fast_forward->volin_cm, mb_uncached->volin_cm)
+    && within_tolerance(mb_fast_forward->volend_cm, mb_uncached->volend_cm);
+
+  std::cout<<GREEN<<"\n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<"| Fast-forward caching test ("<< num_fast_forwarded <<" of "<< num_fast_forward_steps <<" steps fast-forwarded) \n";
+  std::cout<<"| AET [cm] : (uncached vs fast_forward) | "<< mb_uncached->volAET_cm <<" vs "<< mb_fast_forward->volAET_cm <<"\n";
+  std::cout<<"| Storage [cm] : (uncached vs fast_forward) | "<< mb_uncached->volend_cm <<" vs "<< mb_fast_forward->volend_cm <<"\n";
+  std::cout<<"| Fast-forward caching test passed? "<< (fast_forward_status ? "YES" : "NO") <<" \n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<RESET<<"\n";
+
+  model_uncached.Finalize();
+  model_fast_forward.Finalize();
+
+  if (!fast_forward_status) {
+    std::stringstream errMsg;
+    errMsg << "The fast-forwarded flux caching does not match a run without flux caching. \n";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  // adaptive flux caching horizon: halved when the storage or the top wetting front speed drifted more than tolerated
+  // over a cache window, doubled when both drifted less than half of that, kept otherwise, within its bounds
+  struct flux_caching_policy horizon_policy;
+  horizon_policy.window_storage_cm    = 10.0;
+  horizon_policy.window_dzdt_cm_per_h = 1.0;
+  int initial_horizon = horizon_policy.horizon;
+
+  lgar_adapt_flux_caching_horizon(&horizon_policy, 10.1, 1.0);   // drifts of 0.2 and 0 of the tolerances
+  bool horizon_status = horizon_policy.horizon == 2 * initial_horizon;
+  lgar_adapt_flux_caching_horizon(&horizon_policy, 11.0, 1.0);   // storage drift of 2 tolerances
+  horizon_status &= horizon_policy.horizon == initial_horizon;
+  lgar_adapt_flux_caching_horizon(&horizon_policy, 10.0, 0.2);   // dzdt drift of 1.6 tolerances
+  horizon_status &= horizon_policy.horizon == initial_horizon / 2;
+  lgar_adapt_flux_caching_horizon(&horizon_policy, 10.3, 0.9);   // drift of 0.6 tolerances
+  horizon_status &= horizon_policy.horizon == initial_horizon / 2;
+
+  horizon_policy.horizon = horizon_policy.max_horizon - 1;
+  lgar_adapt_flux_caching_horizon(&horizon_policy, 10.0, 1.0);
+  horizon_status &= horizon_policy.horizon == horizon_policy.max_horizon;
+  horizon_policy.horizon = horizon_policy.min_horizon + 1;
+  lgar_adapt_flux_caching_horizon(&horizon_policy, 20.0, 1.0);
+  horizon_status &= horizon_policy.horizon == horizon_policy.min_horizon;
+
+  // over the forcing file (adaptive timestep, so that dry steps are one substep and their fluxes can be cached), each
+  // forcing step is counted as cached or computed, and the horizon adapts within its bounds
+  std::ifstream horizon_base_config(argv[1]);
+  std::ofstream horizon_config("horizon_unittest_config.txt");
+  horizon_config << horizon_base_config.rdbuf() << "\nadaptive_timestep=true\n" << "allow_flux_caching=true\n"
+		 << "flux_caching_adaptive_horizon=true\n";
+  horizon_config.close();
+
+  BmiLGAR model_horizon;
+  model_horizon.Initialize("horizon_unittest_config.txt");
+  remove("horizon_unittest_config.txt");
+  const int num_horizon_steps = (int)forcing_precip.size();
+  model_horizon.get_model()->lgar_bmi_params.endtime_s = num_horizon_steps * model_horizon.GetTimeStep();
+  model_horizon.SetForcingSeries(forcing_precip.data(), forcing_PET.data(), num_horizon_steps);
+  model_horizon.UpdateUntil(num_horizon_steps * model_horizon.GetTimeStep());
+
+  struct flux_caching_policy *run_policy = &model_horizon.get_model()->flux_caching;
+  horizon_status &= run_policy->num_cached_steps > 0 && run_policy->num_computed_steps > 0
+    && run_policy->num_cached_steps + run_policy->num_computed_steps == num_horizon_steps
+    && run_policy->horizon != initial_horizon
+    && run_policy->horizon >= run_policy->min_horizon && run_policy->horizon <= run_policy->max_horizon;
+
+  std::cout<<GREEN<<"\n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<"| Flux caching horizon test ("<< run_policy->num_cached_steps <<" cached, "<< run_policy->num_computed_steps
+	   <<" computed steps, final horizon "<< run_policy->horizon <<") \n";
+  std::cout<<"| Flux caching horizon test passed? "<< (horizon_status ? "YES" : "NO") <<" \n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<RESET<<"\n";
+
+  model_horizon.Finalize();
+
+  if (!horizon_status) {
+    std::stringstream errMsg;
+    errMsg << "The flux caching horizon or counters do not adapt as expected. \n";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  // a copied forcing series (here from an interleaved precipitation/PET table) does not depend on the caller's buffer:
+  // overwriting the table after the copy gives the results of the forcing that was copied
+  const int num_copied_steps = 96, copied_offset = 4500;
+  std::vector<double> copied_table(2 * num_copied_steps);
+  for (int i=0; i<num_copied_steps; i++) {
+    copied_table[2 * i]     = forcing_precip[copied_offset + i];
+    copied_table[2 * i + 1] = forcing_PET[copied_offset + i];
+  }
+
+  BmiLGAR model_referenced, model_copied;
+  model_referenced.Initialize(argv[1]);
+  model_copied.Initialize(argv[1]);
+  model_referenced.get_model()->lgar_bmi_params.endtime_s = num_copied_steps * model_referenced.GetTimeStep();
+  model_copied.get_model()->lgar_bmi_params.endtime_s = num_copied_steps * model_copied.GetTimeStep();
+
+  model_referenced.SetForcingSeries(&forcing_precip[copied_offset], &forcing_PET[copied_offset], num_copied_steps);
+  model_copied.CopyForcingSeries(&copied_table[0], &copied_table[1], num_copied_steps, 2, 2);
+  std::fill(copied_table.begin(), copied_table.end(), 50.0);
+  copied_table.clear();
+  copied_table.shrink_to_fit();
+
+  model_referenced.UpdateUntil(num_copied_steps * model_referenced.GetTimeStep());
+  model_copied.UpdateUntil(num_copied_steps * model_copied.GetTimeStep());
+
+  struct lgar_mass_balance_variables *mb_referenced = &model_referenced.get_model()->lgar_mass_balance;
+  struct lgar_mass_balance_variables *mb_copied = &model_copied.get_model()->lgar_mass_balance;
+  bool copy_status = model_copied.GetForcingSeriesRemaining() == 0 && mb_referenced->volprecip_cm > 0.0
+    && mb_copied->volprecip_cm == mb_referenced->volprecip_cm && mb_copied->volPET_cm == mb_referenced->volPET_cm
+    && mb_copied->volAET_cm == mb_referenced->volAET_cm && mb_copied->volin_cm == mb_referenced->volin_cm
+    && mb_copied->volend_cm == mb_referenced->volend_cm;
+
+  std::cout<<GREEN<<"\n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<"| Copied forcing test ("<< num_copied_steps <<" steps, strided table overwritten after the copy) \n";
+  std::cout<<"| AET [cm] : (referenced vs copied) | "<< mb_referenced->volAET_cm <<" vs "<< mb_copied->volAET_cm <<"\n";
+  std::cout<<"| Copied forcing test passed? "<< (copy_status ? "YES" : "NO") <<" \n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<RESET<<"\n";
+
+  model_referenced.Finalize();
+  model_copied.Finalize();
+
+  if (!copy_status) {
+    std::stringstream errMsg;
+    errMsg << "The copied forcing series depends on the buffer it was copied from. \n";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  // the wetting front outputs are allocated once: views taken through GetValuePtr before a run stay valid and hold the
+  // current fronts after every Update, also when fronts are created and merged
+  const int num_view_steps = 96, view_offset = 4500;
+  BmiLGAR model_views;
+  model_views.Initialize(argv[1]);
+  model_views.get_model()->lgar_bmi_params.endtime_s = num_view_steps * model_views.GetTimeStep();
+
+  const double *theta_wf_view = (const double*)model_views.GetValuePtr("soil_moisture_wetting_fronts");
+  const double *depth_wf_view = (const double*)model_views.GetValuePtr("soil_depth_wetting_fronts");
+  int num_wf_previous = model_views.get_model()->lgar_bmi_params.num_wetting_fronts;
+  int num_fronts_added = 0, num_fronts_removed = 0, num_view_mismatches = 0;
+
+  for (int i=0; i<num_view_steps; i++) {
+    model_views.SetValue("precipitation_rate", &forcing_precip[view_offset + i]);
+    model_views.SetValue("potential_evapotranspiration_rate", &forcing_PET[view_offset + i]);
+    model_views.Update();
+
+    int num_wf = model_views.get_model()->lgar_bmi_params.num_wetting_fronts;
+    num_fronts_added   += (num_wf > num_wf_previous);
+    num_fronts_removed += (num_wf < num_wf_previous);
+    num_wf_previous = num_wf;
+
+    std::vector<double> theta_wf(num_wf), depth_wf(num_wf);
+    model_views.GetValue("soil_moisture_wetting_fronts", theta_wf.data());
+    model_views.GetValue("soil_depth_wetting_fronts", depth_wf.data());
+    num_view_mismatches += (theta_wf_view != model_views.GetValuePtr("soil_moisture_wetting_fronts"))
+      || (depth_wf_view != model_views.GetValuePtr("soil_depth_wetting_fronts"))
+      || !std::equal(theta_wf.begin(), theta_wf.end(), theta_wf_view)
+      || !std::equal(depth_wf.begin(), depth_wf.end(), depth_wf_view);
+  }
+
+  bool views_status = num_view_mismatches == 0 && num_fronts_added > 0 && num_fronts_removed > 0;
+
+  std::cout<<GREEN<<"\n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<"| Wetting front views test ("<< num_view_steps <<" updates, fronts added in "<< num_fronts_added
+	   <<" and removed in "<< num_fronts_removed <<") \n";
+  std::cout<<"| Wetting front views test passed? "<< (views_status ? "YES" : "NO") <<" \n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<RESET<<"\n";
+
+  model_views.Finalize();
+
+  if (!views_status) {
+    std::stringstream errMsg;
+    errMsg << "The wetting front outputs moved or went stale across updates (" << num_view_mismatches << " updates). \n";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  // output aggregation over intervals of 3 timesteps, the last interval of the run (2 timesteps) being shorter: each
+  // row holds the mean, sum, max, min and last value of its timesteps, with the time of the first of them
+  std::vector<enum output_aggregation> aggregations = {AGGREGATE_MEAN, AGGREGATE_SUM, AGGREGATE_MAX, AGGREGATE_MIN,
+							AGGREGATE_LAST};
+  OutputAggregator aggregator(aggregations);
+  double aggregated_series[8] = {1.0, -2.0, 4.0, 0.5, 3.0, 2.0, -1.0, 6.0};
+  double expected_rows[3][5] = {{1.0, 3.0, 4.0, -2.0, 4.0}, {5.5 / 3, 5.5, 3.0, 0.5, 2.0}, {2.5, 5.0, 6.0, -1.0, 6.0}};
+  double expected_row_times_s[3] = {0.0, 10800.0, 21600.0};
+
+  double interval_time_s = -1.0;
+  bool aggregation_status = aggregator.CompleteRow(&interval_time_s) == NULL && interval_time_s == -1.0;
+  int num_rows = 0;
+  for (int i=0; i<8; i++) {
+    double values[5];
+    std::fill(values, values + 5, aggregated_series[i]);
+    aggregator.Add(values, i * 3600.0);
+
+    if ((i + 1) % 3 == 0 || i == 7) {
+      const double *row = aggregator.CompleteRow(&interval_time_s);
+      aggregation_status &= row != NULL && interval_time_s == expected_row_times_s[num_rows];
+      for (int j=0; j<5 && row != NULL; j++)
+	aggregation_status &= fabs(row[j] - expected_rows[num_rows][j]) < 1e-15;
+      num_rows++;
+    }
+  }
+  aggregation_status &= (num_rows == 3);
+
+  std::cout<<GREEN<<"\n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<"| Output aggregation test passed? "<< (aggregation_status ? "YES" : "NO") <<" \n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<RESET<<"\n";
+
+  if (!aggregation_status) {
+    std::stringstream errMsg;
+    errMsg << "The output variables are not aggregated over the output intervals as expected. \n";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  // the lookup tables of theta(h), K(Se) and h(Se) stay monotone between the nodes (the interval slopes are limited),
+  // on a sweep much finer than the node spacing, also for the steep retention curves of soils with a large vg_n
+  BmiLGAR model_tables;
+  model_tables.Initialize(argv[1]);
+  struct model_state *tables_state = model_tables.get_model();
+
+  int tables_violations = 0, tables_built = 0;
+  double tables_vg_n[3] = {1.5, 3.0, 8.0};
+  for (int j=0; j<3; j++) {
+    struct soil_properties_ soil = tables_state->soil_properties[tables_state->lgar_bmi_params.layer_soil_type[1]];
+    soil.vg_n = tables_vg_n[j];
+    soil.vg_m = 1.0 - 1.0/soil.vg_n;
+    lgar_calc_soil_constants(&soil);
+    lgar_build_vG_tables(&soil, tables_state->lgar_bmi_params.vG_table_tolerance);
+    tables_built += (soil.Se_from_h_table.num_intervals > 0);
+
+    double theta_previous = soil_theta_from_h(&soil, pow(2.0, -12.0));
+    for (int k=1; k<=36*512; k++) {
+      double theta = soil_theta_from_h(&soil, pow(2.0, -12.0 + k/512.0));
+      tables_violations += (theta > theta_previous);
+      theta_previous = theta;
+    }
+    double K_previous = soil_K_from_Se(&soil, 1e-6, 1.0);
+    double h_previous = soil_h_from_Se(&soil, 1e-6);
+    for (int k=1; k<20000; k++) {
+      double Se = 1e-6 + k*(1.0 - 2e-6)/20000;
+      double K = soil_K_from_Se(&soil, Se, 1.0);
+      double h = soil_h_from_Se(&soil, Se);
+      tables_violations += (K < K_previous) + (h > h_previous);
+      K_previous = K;
+      h_previous = h;
+    }
+  }
+  bool tables_status = (tables_built == 3) && (tables_violations == 0);
+  model_tables.Finalize();
+
+  std::cout<<GREEN<<"\n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<"| Lookup tables (non-monotone steps) : "<< tables_violations <<"\n";
+  std::cout<<"| Lookup table monotonicity test passed? "<< (tables_status ? "YES" : "NO") <<" \n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<RESET<<"\n";
+
+  if (!tables_status) {
+    std::stringstream errMsg;
+    errMsg << "The tabulated van Genuchten relations are not monotone. \n";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  // the mass balance solve of a wetting front keeps psi below PSI_UPPER_LIM (1.E7 cm) unless the front is already
+  // drier than that: a dry front closes the mass balance beyond the limit, a moist one returns the dry-limit theta
+  BmiLGAR model_dry;
+  model_dry.Initialize(argv[1]);
+  struct model_state *dry_state = model_dry.get_model();
+  int dry_soil = dry_state->lgar_bmi_params.layer_soil_type[1];
+  struct soil_properties_ *dry_props = &dry_state->soil_properties[dry_soil];
+  double dry_delta_theta[2] = {0.0, 0.0};
+  double dry_delta_thickness[2] = {0.0, 10.0};
+  double dry_prior_mass = 10.0 * soil_theta_from_h(dry_props, 5.E7);
+
+  double dry_AET_cm[2] = {0.0, 0.0};
+  double dry_theta[2];
+  double dry_psi_start_cm[2] = {2.E7, 1.E3};
+  for (int k=0; k<2; k++) {
+    double new_mass = 10.0 * soil_theta_from_h(dry_props, dry_psi_start_cm[k]);
+    dry_theta[k] = lgar_theta_mass_balance(1, dry_soil, dry_psi_start_cm[k], new_mass, dry_prior_mass, &dry_AET_cm[k],
+					   dry_delta_theta, dry_delta_thickness, dry_state->lgar_bmi_params.layer_soil_type,
+					   dry_state->soil_properties);
+  }
+  model_dry.Finalize();
+
+  bool dry_status = fabs(10.0 * dry_theta[0] - dry_prior_mass) <= 1.E-10 && dry_AET_cm[0] == 0.0
+    && dry_theta[1] == soil_theta_from_h(dry_props, 1.E7) && dry_AET_cm[1] < 0.0;
+
+  std::cout<<GREEN<<"\n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<"| Dry front theta (dry start, moist start) : "<< dry_theta[0] <<", "<< dry_theta[1] <<"\n";
+  std::cout<<"| Dry front mass balance test passed? "<< (dry_status ? "YES" : "NO") <<" \n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<RESET<<"\n";
+
+  if (!dry_status) {
+    std::stringstream errMsg;
+    errMsg << "The mass balance of a wetting front drier than PSI_UPPER_LIM is not closed as expected. \n";
+    throw std::runtime_error(errMsg.str());
+  }
+
+  // the error-controlled adaptive timestep with allow_flux_caching=true (freeze) must stay within 0.3% of the same run
+  // without flux caching: the catch-up substep after a cache window is not compatible with substeps that are shortened
+  // or rejected, so freeze caching must not distort the fluxes when the error control is on
+  const char *error_control_configs[2] = {"error_control_unittest_config.txt", "error_control_cached_unittest_config.txt"};
+  for (int k=0; k<2; k++) {
+    std::ifstream base(argv[1]);
+    std::ofstream cfg(error_control_configs[k]);
+    cfg << base.rdbuf() << "\nadaptive_timestep=true\nadaptive_timestep_method=error_control\n"
+	<< (k == 1 ? "allow_flux_caching=true\n" : "");
+  }
+
+  const int num_error_control_steps = (int)forcing_precip.size();
+  BmiLGAR model_error_control, model_error_control_cached;
+  model_error_control.Initialize(error_control_configs[0]);
+  model_error_control_cached.Initialize(error_control_configs[1]);
+  remove(error_control_configs[0]);
+  remove(error_control_configs[1]);
+
+  BmiLGAR *error_control_models[2] = {&model_error_control, &model_error_control_cached};
+  for (BmiLGAR *m : error_control_models) {
+    m->get_model()->lgar_bmi_params.endtime_s = num_error_control_steps * m->GetTimeStep();
+    m->SetForcingSeries(forcing_precip.data(), forcing_PET.data(), num_error_control_steps);
+    m->UpdateUntil(num_error_control_steps * m->GetTimeStep());
+  }
+
+  struct lgar_mass_balance_variables *mb_error_control = &model_error_control.get_model()->lgar_mass_balance;
+  struct lgar_mass_balance_variables *mb_error_control_cached = &model_error_control_cached.get_model()->lgar_mass_balance;
+
+  bool error_control_caching_status = model_error_control_cached.get_model()->lgar_bmi_params.allow_flux_caching
+    && mb_error_control->volprecip_cm > 0.0
+    && within_tolerance(mb_error_control_cached->volAET_cm, mb_error_control->volAET_cm)
+    && within_tolerance(mb_error_control_cached->volrunoff_cm, mb_error_control->volrunoff_cm)
+    && within_tolerance(mb_error_control_cached->volend_cm, mb_error_control->volend_cm);
+
+  std::cout<<GREEN<<"\n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<"| AET [cm] : (error control, with flux caching) | "<< mb_error_control->volAET_cm <<" vs "
+	   << mb_error_control_cached->volAET_cm <<"\n";
+  std::cout<<"| Runoff [cm] : (error control, with flux caching) | "<< mb_error_control->volrunoff_cm <<" vs "
+	   << mb_error_control_cached->volrunoff_cm <<"\n";
+  std::cout<<"| Storage [cm] : (error control, with flux caching) | "<< mb_error_control->volend_cm <<" vs "
+	   << mb_error_control_cached->volend_cm <<"\n";
+  std::cout<<"| Error control with flux caching test passed? "<< (error_control_caching_status ? "YES" : "NO") <<" \n";
+  std::cout<<"| *************************************** \n";
+  std::cout<<RESET<<"\n";
+
+  model_error_control.Finalize();
+  model_error_control_cached.Finalize();
+
+  if (!error_control_caching_status) {
+    std::stringstream errMsg;
+    errMsg << "Flux caching changes the fluxes of the error-controlled adaptive timestep. \n";
+    throw std::runtime_error(errMsg.str());
+  }
+
   return FAILURE;
 }